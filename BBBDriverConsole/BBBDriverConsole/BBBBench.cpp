@@ -0,0 +1,1270 @@
+// banco de pruebas de filtros sin camara ni Spinnaker
+// nubes sinteticas con outliers marcados para medir tiempo y precision a la vez
+//
+// bbb_bench [puntos] [repeticiones]          todas las secciones y la suite
+// bbb_bench --suite [opciones]               solo la suite de filtros
+//   --sizes 10000,100000,1000000  tamanos de nube
+//   --reps N                      repeticiones por medida, nos quedamos con la mejor
+//   --json fichero                resultados en JSON, una medida por linea
+//   --baseline fichero            JSON de otra pasada para sacar la mejora
+// bbb_bench --check                          solo las comprobaciones, sale con 1 si alguna falla
+
+#include "BBBPointCloudFilters.h"
+#include "BBBKdTree.h"
+#include "BBBParallel.h"
+#include "BBBCameraFilters.h"
+#include "BBBCameraWorker.h"
+#include "BBBCoord3D.h"
+#include "BBBLatencyHistogram.h"
+#include "BBBMeasurement.h"
+#include "BBBMetrics.h"
+#include "BBBPerfCounters.h"
+#include "BBBProfiler.h"
+#include "BBBTrace.h"
+#include "BBBReprojection.h"
+#include "BBBVisionMath.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <new>
+#include <map>
+#include <set>
+
+using BBB::Pt;
+
+// contamos reservas de todo el proceso, tambien las de los hilos de Parallel
+static std::atomic<uint64_t> gAllocCount{ 0 };
+static std::atomic<uint64_t> gAllocBytes{ 0 };
+
+void* operator new(std::size_t n)
+{
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    gAllocBytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// escena parecida a la del arco, caja delante y suelo alrededor a varias distancias
+// el ruido en z crece con z al cuadrado como en estereo y el paso entre puntos con z
+// los outliers llevan r = 255 para poder contarlos despues de filtrar
+static std::vector<Pt> MakeScene(int nTarget, float outlierFrac, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+    std::normal_distribution<float> n01(0.0f, 1.0f);
+
+    const float ranges[3] = { 1.5f, 4.0f, 7.0f };
+    const float sigmaZ2 = 0.002f;
+
+    std::vector<Pt> pts;
+    pts.reserve(nTarget + 16);
+
+    const int nIn = (int)(nTarget * (1.0f - outlierFrac));
+    const int perRange = nIn / 3;
+
+    for (float z0 : ranges)
+    {
+        for (int i = 0; i < perRange; ++i)
+        {
+            Pt p;
+            float a = u01(rng), b = u01(rng);
+
+            // mitad caja frontal 0.6 x 0.4, mitad suelo 2 x 1.5
+            if (i & 1)
+            {
+                p.x = (a - 0.5f) * 0.6f;
+                p.y = -b * 0.4f;
+                p.z = z0;
+            }
+            else
+            {
+                p.x = (a - 0.5f) * 2.0f;
+                p.y = 0.0f;
+                p.z = z0 - 0.5f + b * 1.5f;
+            }
+
+            p.z += n01(rng) * sigmaZ2 * p.z * p.z;
+            pts.push_back(p);
+        }
+    }
+
+    const int nOut = nTarget - (int)pts.size();
+    for (int i = 0; i < nOut; ++i)
+    {
+        Pt p;
+        p.x = (u01(rng) - 0.5f) * 2.4f;
+        p.y = -u01(rng) * 1.0f;
+        p.z = 0.8f + u01(rng) * 7.5f;
+        p.r = 255;
+        pts.push_back(p);
+    }
+
+    std::shuffle(pts.begin(), pts.end(), rng);
+    return pts;
+}
+
+struct Score
+{
+    double ms = 0.0;
+    size_t kept = 0;
+    float inlierKept = 0.0f;
+    float outlierRemoved = 0.0f;
+
+    // media de las dos tasas, 1 es perfecto
+    float Balanced() const { return 0.5f * (inlierKept + outlierRemoved); }
+};
+
+static Score Run(const std::vector<Pt>& in, int reps, const std::function<std::vector<Pt>(const std::vector<Pt>&)>& fn)
+{
+    size_t inTot = 0, outTot = 0;
+    for (const auto& p : in) (p.r ? outTot : inTot)++;
+
+    Score s;
+    std::vector<Pt> res;
+
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        res = fn(in);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        best = (std::min)(best, ms);
+    }
+
+    size_t inKept = 0, outKept = 0;
+    for (const auto& p : res) (p.r ? outKept : inKept)++;
+
+    s.ms = best;
+    s.kept = res.size();
+    s.inlierKept = inTot ? (float)inKept / inTot : 1.0f;
+    s.outlierRemoved = outTot ? 1.0f - (float)outKept / outTot : 1.0f;
+    return s;
+}
+
+static void Print(const std::string& name, const Score& s)
+{
+    std::cout << std::left << std::setw(34) << name << std::right
+        << std::fixed << std::setprecision(2)
+        << std::setw(10) << s.ms << " ms"
+        << std::setw(10) << s.kept
+        << std::setw(10) << s.inlierKept * 100.0f << " %"
+        << std::setw(10) << s.outlierRemoved * 100.0f << " %"
+        << std::setw(10) << s.Balanced() * 100.0f << " %"
+        << "\n";
+}
+
+// disparidad sintetica de la escena del arco, suelo inclinado y caja delante
+// huecos a 0 y un 2 % con el valor invalido de la camara, como llega del SDK
+struct SynthDisparity
+{
+    int width = 0, height = 0, bpp = 16;
+    std::vector<uint8_t> bytes;
+    BBB::ReprojectParams prm;
+
+    BBB::DisparityView View() const
+    {
+        BBB::DisparityView v;
+        v.data = bytes.data();
+        v.width = width;
+        v.height = height;
+        v.strideBytes = width * (bpp / 8);
+        v.bpp = bpp;
+        return v;
+    }
+};
+
+static SynthDisparity MakeDisparity(int w, int h, int bpp, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+
+    SynthDisparity s;
+    s.width = w;
+    s.height = h;
+    s.bpp = bpp;
+    s.bytes.assign((size_t)w * h * (bpp / 8), 0);
+
+    BBB::ReprojectParams& p = s.prm;
+    p.roi = { w / 10, w - w / 10, h / 10, h - h / 10 };
+    p.focal = 800.0f;
+    p.baselineM = 0.12f;
+    p.principalU = w * 0.5f;
+    p.principalV = h * 0.5f;
+    p.scale = bpp == 16 ? 1.0f / 64.0f : 0.5f;
+    p.invalidValue = bpp == 16 ? 0xFFFF : 0xFF;
+    p.minZ = 0.3f;
+    p.maxZ = 6.0f;
+    p.camHeightM = 1.2f;
+    p.pitchDownDeg = 20.0f;
+    p.groundMinHeightM = 0.08f;
+
+    const float fB = p.focal * p.baselineM;
+    const float maxRaw = bpp == 16 ? 65534.0f : 254.0f;
+
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            // caja a 2 m en el centro, fuera suelo que se aleja hacia arriba de la imagen
+            bool box = std::abs(x - w / 2) < w / 6 && std::abs(y - h / 2) < h / 5;
+            float z = box ? 2.0f : 1.0f + 6.0f * (float)(h - y) / (float)h;
+
+            float d = fB / z + (u01(rng) - 0.5f) * 0.3f;
+            int raw = (int)std::lround(std::clamp(d / p.scale, 1.0f, maxRaw));
+
+            float r = u01(rng);
+            if (r < 0.08f) raw = 0;
+            else if (r < 0.10f) raw = (int)p.invalidValue;
+
+            if (bpp == 16) ((uint16_t*)s.bytes.data())[(size_t)y * w + x] = (uint16_t)raw;
+            else s.bytes[(size_t)y * w + x] = (uint8_t)raw;
+        }
+    }
+
+    return s;
+}
+
+// el bucle como estaba en el driver, con las ramas de configuracion dentro de cada pixel
+static size_t ReprojectGeneric(const BBB::DisparityView& view, const BBB::ReprojectParams& p, std::vector<Pt>& pts)
+{
+    pts.clear();
+
+    auto IsInvalidRaw = [&](uint16_t raw) -> bool
+        {
+            if (raw == 0) return true;
+            if (p.invalidFlag && raw == p.invalidValue) return true;
+            return false;
+        };
+
+    auto ReadRawAt = [&](int x, int y) -> uint16_t
+        {
+            if (view.bpp <= 8) return (uint16_t)view.data[y * view.strideBytes + x];
+            return ((const uint16_t*)view.data)[y * (view.strideBytes / 2) + x];
+        };
+
+    auto MedianRaw3x3 = [&](int x, int y) -> uint16_t
+        {
+            if (!p.median3x3) return ReadRawAt(x, y);
+
+            uint16_t vals[9];
+            int n = 0;
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                int yy = y + dy;
+                if (yy < 0 || yy >= view.height) continue;
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    int xx = x + dx;
+                    if (xx < 0 || xx >= view.width) continue;
+                    uint16_t r = ReadRawAt(xx, yy);
+                    if (IsInvalidRaw(r)) continue;
+
+                    // insercion como en BBBReprojection, std::sort con 9 valores avisa de array-bounds en gcc
+                    int j = n++;
+                    while (j > 0 && vals[j - 1] > r)
+                    {
+                        vals[j] = vals[j - 1];
+                        --j;
+                    }
+                    vals[j] = r;
+                }
+            }
+
+            return n > 0 ? vals[n / 2] : 0;
+        };
+
+    for (int y = p.roi.y0; y < p.roi.y1; y += p.step)
+    {
+        for (int x = p.roi.x0; x < p.roi.x1; x += p.step)
+        {
+            uint16_t raw = MedianRaw3x3(x, y);
+            if (IsInvalidRaw(raw)) continue;
+
+            float d = (float)raw * p.scale + p.offset;
+            if (d <= 1e-6f) continue;
+
+            float z = (p.focal * p.baselineM) / d;
+            if (!std::isfinite(z)) continue;
+            if (z < p.minZ || z > p.maxZ) continue;
+
+            float X = ((float)x - p.principalU) * z / p.focal;
+            float Y = ((float)y - p.principalV) * z / p.focal;
+
+            if (p.groundFilter)
+            {
+                float hAG = BBB::VisionMath::HeightAboveGroundM(X, Y, z, p.camHeightM, p.pitchDownDeg);
+                if (!std::isfinite(hAG)) continue;
+                if (hAG < p.groundMinHeightM) continue;
+            }
+
+            Pt q;
+            q.x = X; q.y = Y; q.z = z;
+            q.pix = y * view.width + x;
+            pts.push_back(q);
+        }
+    }
+
+    return pts.size();
+}
+
+// todas las combinaciones del bucle de reproyeccion, generico frente a la variante compilada
+static void BenchReprojection(int reps)
+{
+    std::cout << "\nreproyeccion 1280 x 960 ROI 80 %\n";
+    std::cout << std::left << std::setw(34) << "variante" << std::right
+        << std::setw(13) << "generico" << std::setw(13) << "compilada"
+        << std::setw(10) << "mejora" << std::setw(10) << "puntos" << "\n";
+
+    const SynthDisparity imgs[2] = { MakeDisparity(1280, 960, 8, 7), MakeDisparity(1280, 960, 16, 7) };
+
+    std::vector<Pt> ptsA, ptsB;
+    std::vector<int> cells;
+
+    for (const SynthDisparity& img : imgs)
+    {
+        const BBB::DisparityView view = img.View();
+
+        for (int flags = 0; flags < 8; ++flags)
+        {
+            BBB::ReprojectParams p = img.prm;
+            p.median3x3 = (flags & 4) != 0;
+            p.invalidFlag = (flags & 2) != 0;
+            p.groundFilter = (flags & 1) != 0;
+
+            double bestA = 1e30, bestB = 1e30;
+            for (int r = 0; r < reps; ++r)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                ReprojectGeneric(view, p, ptsA);
+                auto t1 = std::chrono::steady_clock::now();
+                BBB::Reprojection::Run(view, p, ptsB, cells);
+                auto t2 = std::chrono::steady_clock::now();
+
+                bestA = (std::min)(bestA, std::chrono::duration<double, std::milli>(t1 - t0).count());
+                bestB = (std::min)(bestB, std::chrono::duration<double, std::milli>(t2 - t1).count());
+            }
+
+            // mismos puntos en el mismo orden, si no la variante esta mal
+            bool same = ptsA.size() == ptsB.size();
+            for (size_t i = 0; same && i < ptsA.size(); ++i)
+                same = ptsA[i].pix == ptsB[i].pix && ptsA[i].z == ptsB[i].z;
+
+            std::string name = std::to_string(img.bpp) + " bits" +
+                (p.median3x3 ? " mediana" : "") +
+                (p.invalidFlag ? " invalido" : "") +
+                (p.groundFilter ? " suelo" : "");
+
+            std::cout << std::left << std::setw(34) << name << std::right
+                << std::fixed << std::setprecision(2)
+                << std::setw(10) << bestA << " ms"
+                << std::setw(10) << bestB << " ms"
+                << std::setw(9) << bestA / (std::max)(1e-6, bestB) << "x"
+                << std::setw(10) << ptsB.size()
+                << (same ? "" : "  DISTINTOS")
+                << "\n";
+        }
+    }
+}
+
+// la misma escena como Coord3D ABC en mm que calcularia la camara, NaN donde no hay dato
+// comparamos con reproyectar la disparidad en el host con suelo y valor invalido
+static void BenchCoord3D(int reps)
+{
+    const SynthDisparity img = MakeDisparity(1280, 960, 16, 7);
+    const BBB::ReprojectParams& rp0 = img.prm;
+    const BBB::DisparityView view = img.View();
+
+    BBB::ReprojectParams rp = rp0;
+    rp.invalidFlag = true;
+    rp.groundFilter = true;
+
+    const int w = img.width, h = img.height;
+    std::vector<float> abc((size_t)w * h * 3, std::numeric_limits<float>::quiet_NaN());
+    const float fB = rp.focal * rp.baselineM;
+
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            uint16_t raw = view.RawAt(x, y);
+            if (raw == 0 || raw == rp.invalidValue) continue;
+
+            float z = fB / ((float)raw * rp.scale + rp.offset);
+            float* px = abc.data() + ((size_t)y * w + x) * 3;
+            px[0] = ((float)x - rp.principalU) * z / rp.focal * 1000.0f;
+            px[1] = ((float)y - rp.principalV) * z / rp.focal * 1000.0f;
+            px[2] = z * 1000.0f;
+        }
+    }
+
+    BBB::Coord3DView cv;
+    cv.data = (const uint8_t*)abc.data();
+    cv.width = w;
+    cv.height = h;
+    cv.strideBytes = w * 3 * (int)sizeof(float);
+    cv.channels = 3;
+
+    BBB::Coord3DParams cp;
+    cp.roi = rp.roi;
+    cp.unitToM = 0.001f;
+    cp.minZ = rp.minZ;
+    cp.maxZ = rp.maxZ;
+    cp.groundFilter = true;
+    cp.camHeightM = rp.camHeightM;
+    cp.pitchDownDeg = rp.pitchDownDeg;
+    cp.groundMinHeightM = rp.groundMinHeightM;
+
+    std::vector<Pt> ptsA, ptsB;
+    std::vector<int> cells;
+
+    double bestA = 1e30, bestB = 1e30;
+    for (int r = 0; r < reps; ++r)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        BBB::Reprojection::Run(view, rp, ptsA, cells);
+        auto t1 = std::chrono::steady_clock::now();
+        BBB::Coord3D::Run(cv, cp, ptsB, cells);
+        auto t2 = std::chrono::steady_clock::now();
+
+        bestA = (std::min)(bestA, std::chrono::duration<double, std::milli>(t1 - t0).count());
+        bestB = (std::min)(bestB, std::chrono::duration<double, std::milli>(t2 - t1).count());
+    }
+
+    // los pocos puntos de diferencia son los que caen justo en maxZ, al pasar por mm redondean fuera
+    std::cout << "\nCoord3D de la camara frente a reproyectar en el host, 16 bits invalido suelo\n";
+    std::cout << std::fixed << std::setprecision(2)
+        << "  disparidad " << bestA << " ms " << ptsA.size() << " puntos\n"
+        << "  Coord3D ABC " << bestB << " ms " << ptsB.size() << " puntos\n";
+}
+
+// camaras simuladas, cada frame espera la transferencia y luego reproyecta y voxeliza
+// en serie como antes frente a un hilo por camara, cada camara con sus propios buffers
+static void BenchCameraScaling(int reps)
+{
+    const SynthDisparity img = MakeDisparity(1280, 960, 16, 7);
+    const BBB::DisparityView view = img.View();
+
+    BBB::ReprojectParams rp = img.prm;
+    rp.invalidFlag = true;
+    rp.groundFilter = true;
+    rp.step = 2;
+
+    const auto transfer = std::chrono::milliseconds(15);
+    const int rounds = (std::max)(5, reps * 3);
+
+    struct SimCam
+    {
+        std::vector<Pt> pts;
+        std::vector<int> cells;
+        size_t kept = 0;
+    };
+
+    auto Frame = [&](SimCam& cam)
+        {
+            std::this_thread::sleep_for(transfer);
+            BBB::Reprojection::Run(view, rp, cam.pts, cam.cells);
+            cam.kept = BBB::CloudFilters::VoxelDownsample(cam.pts, 0.01f).size();
+        };
+
+    auto Stats = [](std::vector<double>& v, double& p50, double& worst)
+        {
+            std::sort(v.begin(), v.end());
+            p50 = v[v.size() / 2];
+            worst = v.back();
+        };
+
+    std::cout << "\ncamaras simuladas, transferencia " << transfer.count() << " ms por frame, "
+        << rounds << " rondas\n";
+    std::cout << std::setw(8) << "camaras" << std::setw(16) << "serie p50" << std::setw(13) << "max"
+        << std::setw(16) << "hilos p50" << std::setw(13) << "max" << "\n";
+
+    for (int n = 1; n <= 6; ++n)
+    {
+        std::vector<SimCam> cams(n);
+        std::vector<std::unique_ptr<BBB::CameraWorker>> workers;
+        for (int i = 0; i < n; ++i)
+            workers.push_back(std::make_unique<BBB::CameraWorker>("sim" + std::to_string(i), -1));
+
+        std::vector<double> serial, threaded;
+        for (int r = 0; r < rounds; ++r)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            for (auto& cam : cams) Frame(cam);
+            auto t1 = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < n; ++i) workers[i]->Submit([&, i]() { Frame(cams[i]); });
+            for (auto& w : workers) w->Wait();
+            auto t2 = std::chrono::steady_clock::now();
+
+            serial.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+            threaded.push_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+        }
+
+        double sP50, sMax, tP50, tMax;
+        Stats(serial, sP50, sMax);
+        Stats(threaded, tP50, tMax);
+
+        std::cout << std::fixed << std::setprecision(1)
+            << std::setw(8) << n
+            << std::setw(13) << sP50 << " ms" << std::setw(10) << sMax << " ms"
+            << std::setw(13) << tP50 << " ms" << std::setw(10) << tMax << " ms\n";
+    }
+}
+
+// hilo de adquisicion que despierta cada 5 ms como llegarian los frames, con dos hilos
+// de proceso compitiendo en su nucleo, medimos el retraso de cada despertar
+// tiempo compartido frente a SCHED_FIFO, sin permisos solo sale la primera fila
+static void BenchRealtimeJitter(int reps)
+{
+    const SynthDisparity img = MakeDisparity(1280, 960, 16, 9);
+    const BBB::DisparityView view = img.View();
+    const BBB::ReprojectParams rp = img.prm;
+
+    const auto period = std::chrono::milliseconds(5);
+    const int samples = (std::max)(200, reps * 200);
+
+    auto Measure = [&](const BBB::ThreadTuning& tuning, BBB::LatencyHistogram& hist, bool& applied)
+        {
+            std::atomic<bool> stop{ false };
+            std::vector<std::thread> load;
+            for (int i = 0; i < 2; ++i)
+                load.emplace_back([&]()
+                    {
+                        BBB::CameraWorker::PinCurrentThread(0);
+                        std::vector<Pt> pts;
+                        std::vector<int> cells;
+                        while (!stop) BBB::Reprojection::Run(view, rp, pts, cells);
+                    });
+
+            BBB::CameraWorker acq("acq", BBB::ThreadTuning{});
+            acq.Run([&]()
+                {
+                    BBB::CameraWorker::PinCurrentThread(tuning.core);
+                    applied = tuning.rtPriority <= 0 || BBB::CameraWorker::SetRealtimePriority(tuning.rtPriority);
+
+                    auto next = std::chrono::steady_clock::now() + period;
+                    for (int i = 0; i < samples; ++i)
+                    {
+                        std::this_thread::sleep_until(next);
+                        hist.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - next).count());
+                        next += period;
+                    }
+                });
+
+            stop = true;
+            for (auto& t : load) t.join();
+        };
+
+    std::cout << "\nretraso al despertar cada " << period.count() << " ms con 2 hilos de carga en el nucleo 0, "
+        << samples << " muestras\n";
+
+    BBB::LatencyHistogram normal, fifo;
+    bool ok = false;
+    Measure(BBB::ThreadTuning{ 0, 0 }, normal, ok);
+    normal.Print(std::cout, "tiempo compartido", false);
+
+    Measure(BBB::ThreadTuning{ 0, 50 }, fifo, ok);
+    if (ok)
+        fifo.Print(std::cout, "SCHED_FIFO 50     ", false);
+    else
+        std::cout << "SCHED_FIFO sin permisos, no medido\n";
+}
+
+// coste de un ScopedStage y resumen con varios hilos escribiendo a la vez
+static void BenchProfiler(int reps)
+{
+    // tres camaras simuladas con sus etapas de nube, el resumen junta los hilos
+    const SynthDisparity img = MakeDisparity(1280, 960, 16, 11);
+    const BBB::DisparityView view = img.View();
+    BBB::ReprojectParams rp = img.prm;
+    rp.step = 2;
+
+    std::vector<std::unique_ptr<BBB::CameraWorker>> workers;
+    for (int c = 0; c < 3; ++c)
+        workers.push_back(std::make_unique<BBB::CameraWorker>("sim" + std::to_string(c), -1));
+
+    for (int r = 0; r < (std::max)(3, reps * 3); ++r)
+    {
+        for (auto& w : workers)
+            w->Submit([&]()
+                {
+                    std::vector<Pt> pts;
+                    std::vector<int> cells;
+                    {
+                        BBB::ScopedStage s(BBB::Stage::Reprojection);
+                        BBB::Reprojection::Run(view, rp, pts, cells);
+                        s.PointsOut(pts.size());
+                    }
+                    {
+                        BBB::ScopedStage s(BBB::Stage::Voxel, pts.size());
+                        pts = BBB::CloudFilters::VoxelDownsample(pts, 0.01f);
+                        s.PointsOut(pts.size());
+                    }
+                });
+        for (auto& w : workers) w->Wait();
+    }
+
+    std::cout << "\n";
+    BBB::Profiler::Print(std::cout);
+
+    // despues del resumen para no meter estas llamadas vacias en la tabla
+    const int calls = 1000000;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        BBB::ScopedStage s(BBB::Stage::Speckle, (size_t)i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / calls;
+
+    std::cout << "ScopedStage " << std::fixed << std::setprecision(1) << ns << " ns por etapa\n";
+}
+
+// coste de la traza encendida y apagada, y una traza de tres camaras simuladas
+// con captura, reproyeccion y voxel para abrir en ui.perfetto.dev
+static void BenchTrace(int reps)
+{
+    const int calls = 1000000;
+
+    auto Cost = [&]()
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < calls; ++i)
+            {
+                BBB::ScopedStage s(BBB::Stage::Cluster, (size_t)i);
+            }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / calls;
+        };
+
+    BBB::Trace::SetEnabled(true);
+
+    const SynthDisparity img = MakeDisparity(1280, 960, 16, 13);
+    const BBB::DisparityView view = img.View();
+    BBB::ReprojectParams rp = img.prm;
+    rp.step = 2;
+
+    std::vector<std::unique_ptr<BBB::CameraWorker>> workers;
+    for (int c = 0; c < 3; ++c)
+    {
+        workers.push_back(std::make_unique<BBB::CameraWorker>("sim" + std::to_string(c), -1));
+        workers.back()->Submit([c]() { BBB::Trace::SetThreadName("sim" + std::to_string(c) + " proceso"); BBB::Trace::SetCamera(c, "sim" + std::to_string(c)); });
+    }
+    BBB::Trace::SetThreadName("bench");
+
+    for (int r = 0; r < (std::max)(2, reps); ++r)
+    {
+        BBB::TraceScope round("ronda");
+        for (auto& w : workers)
+            w->Submit([&]()
+                {
+                    BBB::TraceScope frame("frame");
+                    std::vector<Pt> pts;
+                    std::vector<int> cells;
+                    {
+                        BBB::ScopedStage s(BBB::Stage::Capture);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+                    }
+                    {
+                        BBB::ScopedStage s(BBB::Stage::Reprojection);
+                        BBB::Reprojection::Run(view, rp, pts, cells);
+                    }
+                    {
+                        BBB::ScopedStage s(BBB::Stage::Voxel, pts.size());
+                        pts = BBB::CloudFilters::VoxelDownsample(pts, 0.01f);
+                    }
+                });
+        for (auto& w : workers) w->Wait();
+    }
+
+    BBB::Trace::SetEnabled(false);
+
+    const std::string path = "bbb_bench_trace.json";
+    std::cout << "\ntraza " << (BBB::Trace::WriteChromeJson(path) ? "guardada en " : "no se pudo guardar en ") << path << "\n";
+
+    // despues de volcar para no llenar la traza con estas llamadas vacias
+    const double off = Cost();
+    BBB::Trace::SetEnabled(true);
+    const double on = Cost();
+    BBB::Trace::SetEnabled(false);
+
+    std::cout << "ScopedStage traza apagada " << std::fixed << std::setprecision(1) << off
+        << " ns encendida " << on << " ns\n";
+}
+
+// contadores de CPU por etapa en los filtros de nube, ciclos y fallos por punto
+// sin PMU o sin permisos sale lo que haya, como minimo fallos de pagina
+static void BenchPerfCounters(const std::vector<Pt>& cloud, int reps)
+{
+    BBB::PerfCounters::SetEnabled(true);
+    std::cout << "\n" << BBB::PerfCounters::Describe() << "\n";
+
+    for (int r = 0; r < reps; ++r)
+    {
+        std::vector<Pt> pts;
+        {
+            BBB::ScopedStage s(BBB::Stage::Voxel, cloud.size());
+            pts = BBB::CloudFilters::VoxelDownsample(cloud, 0.01f);
+            s.PointsOut(pts.size());
+        }
+        {
+            BBB::ScopedStage s(BBB::Stage::Outlier, pts.size());
+            pts = BBB::CloudFilters::RadiusOutlierRemoval(pts, 0.04f, 10);
+            s.PointsOut(pts.size());
+        }
+        {
+            BBB::ScopedStage s(BBB::Stage::Cluster, pts.size());
+            pts = BBB::CloudFilters::KeepLargestCluster(pts, 0.08f);
+            s.PointsOut(pts.size());
+        }
+    }
+
+    BBB::PerfCounters::SetEnabled(false);
+    BBB::Profiler::PrintCounters(std::cout);
+}
+
+// coste de un contador en el ciclo y fichero de metricas de dos camaras simuladas
+static void BenchMetrics()
+{
+    BBB::CameraMetrics* cams[2] = { BBB::Metrics::Camera("sim0"), BBB::Metrics::Camera("sim1 \"der\"") };
+
+    BBB::CameraWorker worker("sim0", -1);
+    BBB::Metrics::AddGauge("bbb_worker_queue_depth", "Trabajos en cola o corriendo por hilo de camara",
+        "sim0", "worker", "proceso", [&worker]() { return (double)worker.Pending(); });
+
+    const int calls = 10000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) BBB::Metrics::Inc(cams[i & 1]->framesCaptured);
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / calls;
+
+    BBB::Metrics::Inc(cams[1]->framesDropped, 3);
+    BBB::Metrics::Inc(cams[0]->measureOk, 7);
+    BBB::Metrics::Inc(cams[0]->bytesWritten, 123456);
+
+    const std::string path = "bbb_bench_metrics.prom";
+    std::cout << "\nMetrics::Inc " << std::fixed << std::setprecision(1) << ns << " ns, metricas "
+        << (BBB::Metrics::WriteTextfile(path) ? "guardadas en " : "no se pudieron guardar en ") << path << "\n";
+}
+
+// area del rectangulo minimo mirando todo el casco en cada lado, sin calibres
+static float BruteMinArea(const std::vector<BBB::P2>& hull)
+{
+    float best = -1.0f;
+    const size_t n = hull.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const BBB::P2& a = hull[i];
+        const BBB::P2& b = hull[(i + 1) % n];
+        float ex = b.x - a.x, ez = b.z - a.z;
+        float len = std::sqrt(ex * ex + ez * ez);
+        if (len < 1e-9f) continue;
+        ex /= len; ez /= len;
+
+        float eMin = 1e30f, eMax = -1e30f, nMin = 1e30f, nMax = -1e30f;
+        for (const auto& q : hull)
+        {
+            float e = q.x * ex + q.z * ez;
+            float m = -q.x * ez + q.z * ex;
+            eMin = (std::min)(eMin, e); eMax = (std::max)(eMax, e);
+            nMin = (std::min)(nMin, m); nMax = (std::max)(nMax, m);
+        }
+        float area = (eMax - eMin) * (nMax - nMin);
+        if (best < 0.0f || area < best) best = area;
+    }
+    return best;
+}
+
+// caja minima con vertices agudos, el triangulo rectangulo daba area 0
+static bool CheckMinAreaRect()
+{
+    bool ok = true;
+
+    BBB::OrientedBox box;
+    std::vector<BBB::P2> tri = { { 0.0f, 0.0f }, { 4.0f, 0.0f }, { 0.0f, 1.0f } };
+    if (!BBB::Measurement::MinAreaRect(tri, box) || std::fabs(box.lengthM * box.widthM - 4.0f) > 1e-3f)
+    {
+        std::cout << "MinAreaRect triangulo 4x1 area " << box.lengthM * box.widthM << " esperaba 4\n";
+        ok = false;
+    }
+
+    // cascos al azar frente a la busqueda completa
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    int bad = 0;
+    for (int t = 0; t < 2000; ++t)
+    {
+        std::vector<BBB::P2> pts(3 + t % 40);
+        for (auto& q : pts) { q.x = u(rng) * (1.0f + t % 5); q.z = u(rng); }
+
+        std::vector<BBB::P2> hull;
+        BBB::Measurement::ConvexHull(pts, hull);
+        if (hull.size() < 3) continue;
+
+        const float ref = BruteMinArea(hull);
+        if (!BBB::Measurement::MinAreaRect(hull, box) || std::fabs(box.lengthM * box.widthM - ref) > 1e-4f * (1.0f + ref)) bad++;
+    }
+    if (bad > 0)
+    {
+        std::cout << "MinAreaRect " << bad << " cascos al azar distintos de la busqueda completa\n";
+        ok = false;
+    }
+
+    std::cout << "MinAreaRect " << (ok ? "ok" : "FALLA") << "\n";
+    return ok;
+}
+
+// mapa de nodos en memoria en lugar de GenApi, los de fail existen pero no aceptan escritura
+class MapNodes : public BBB::NodeAccess
+{
+public:
+    std::set<std::string> nodes;
+    std::set<std::string> fail;
+    std::map<std::string, double> values;
+
+    bool Writable(const char* name) const override { return nodes.count(name) > 0; }
+
+    bool SetBool(const char* name, bool value) override { return SetNumber(name, value ? 1.0 : 0.0); }
+
+    bool SetNumber(const char* name, double value) override
+    {
+        if (!nodes.count(name) || fail.count(name)) return false;
+        values[name] = value;
+        return true;
+    }
+
+    double Get(const std::string& name) const
+    {
+        auto it = values.find(name);
+        return it == values.end() ? -1.0 : it->second;
+    }
+};
+
+// seleccion de filtros en camara contra un mapa de nodos
+static bool CheckCameraFilters()
+{
+    bool ok = true;
+    auto Expect = [&](bool cond, const char* what)
+        {
+            if (!cond) std::cout << "CameraFilters " << what << "\n";
+            ok = ok && cond;
+        };
+
+    BBBParams p;
+    p.maxSpeckleSize = 500;
+    p.speckleThreshold = 12;
+
+    const std::set<std::string> primary = { "SpeckleFilterEnable", "SpeckleFilterMaxSpeckleSize", "SpeckleFilterMaxDifference", "MedianFilterEnable" };
+    const std::set<std::string> alternative = { "DisparitySpeckleFilterEnable", "DisparitySpeckleFilterSize", "DisparitySpeckleFilterThreshold", "DisparityMedianFilterEnable" };
+
+    // sin nodos todo en el host y no escribimos nada
+    {
+        MapNodes n;
+        BBB::CameraFilterCaps caps = BBB::CameraFilters::Probe(n);
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, caps, p);
+        Expect(!caps.HasSpeckle() && !caps.HasMedian(), "sin nodos encuentra filtros");
+        Expect(!plan.speckleOnCamera && !plan.medianOnCamera, "sin nodos deja etapas en la camara");
+        Expect(n.values.empty(), "sin nodos escribe algo");
+    }
+
+    // con todos los nodos las dos etapas pasan a la camara con los valores de BBBParams
+    {
+        MapNodes n;
+        n.nodes = primary;
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, BBB::CameraFilters::Probe(n), p);
+        Expect(plan.speckleOnCamera && plan.medianOnCamera, "con todos los nodos no usa la camara");
+        Expect(n.Get("SpeckleFilterMaxSpeckleSize") == 500.0 && n.Get("SpeckleFilterMaxDifference") == 12.0, "tamano o umbral de speckle mal escritos");
+        Expect(n.Get("SpeckleFilterEnable") == 1.0 && n.Get("MedianFilterEnable") == 1.0, "filtros de la camara sin activar");
+    }
+
+    // cameraFilters apagado, la camara no filtra y el host hace las dos etapas
+    {
+        MapNodes n;
+        n.nodes = primary;
+        BBBParams q = p;
+        q.cameraFilters = false;
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, BBB::CameraFilters::Probe(n), q);
+        Expect(!plan.speckleOnCamera && !plan.medianOnCamera, "cameraFilters apagado usa la camara");
+        Expect(n.Get("SpeckleFilterEnable") == 0.0 && n.Get("MedianFilterEnable") == 0.0, "cameraFilters apagado no apaga la camara");
+    }
+
+    // nombres de otro firmware
+    {
+        MapNodes n;
+        n.nodes = alternative;
+        BBB::CameraFilterCaps caps = BBB::CameraFilters::Probe(n);
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, caps, p);
+        Expect(caps.speckleSize && std::string(caps.speckleSize) == "DisparitySpeckleFilterSize", "no encuentra los nombres alternativos");
+        Expect(plan.speckleOnCamera && plan.medianOnCamera, "con nombres alternativos no usa la camara");
+        Expect(n.Get("DisparitySpeckleFilterSize") == 500.0 && n.Get("DisparityMedianFilterEnable") == 1.0, "nombres alternativos mal escritos");
+    }
+
+    // una escritura que falla deja la etapa en el host y el filtro de la camara apagado
+    {
+        MapNodes n;
+        n.nodes = primary;
+        n.fail = { "SpeckleFilterMaxSpeckleSize" };
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, BBB::CameraFilters::Probe(n), p);
+        Expect(!plan.speckleOnCamera && plan.medianOnCamera, "fallo de escritura mal repartido");
+        Expect(n.Get("SpeckleFilterEnable") == 0.0, "fallo de escritura deja el speckle de la camara activo");
+    }
+
+    // con el relleno guiado la mediana no va a la camara
+    {
+        MapNodes n;
+        n.nodes = primary;
+        BBBParams q = p;
+        q.enableGuidedFill = true;
+        BBB::CameraFilterPlan plan = BBB::CameraFilters::Configure(n, BBB::CameraFilters::Probe(n), q);
+        Expect(plan.speckleOnCamera && !plan.medianOnCamera, "con relleno guiado pide la mediana a la camara");
+        Expect(n.Get("MedianFilterEnable") == 0.0, "con relleno guiado no apaga la mediana de la camara");
+    }
+
+    std::cout << "CameraFilters " << (ok ? "ok" : "FALLA") << "\n";
+    return ok;
+}
+
+static bool RunChecks()
+{
+    bool ok = true;
+    ok = CheckMinAreaRect() && ok;
+    ok = CheckCameraFilters() && ok;
+    return ok;
+}
+
+// una medida de la suite, tiempos de la mejor y la mediana de las repeticiones
+struct SuiteResult
+{
+    std::string name;
+    int points = 0;
+    double bestMs = 0.0;
+    double medianMs = 0.0;
+    double allocs = 0.0;
+    double allocBytes = 0.0;
+    size_t kept = 0;
+
+    double NsPerPoint() const { return points > 0 ? bestMs * 1e6 / points : 0.0; }
+    double MPtsPerSec() const { return bestMs > 0.0 ? points / (bestMs * 1e3) : 0.0; }
+};
+
+// prep fuera del tiempo para copiar la entrada de los que la modifican
+// fn devuelve los puntos que quedan, las reservas son las de una llamada
+static SuiteResult Measure(const std::string& name, int points, int reps,
+    const std::function<void()>& prep, const std::function<size_t()>& fn)
+{
+    SuiteResult r;
+    r.name = name;
+    r.points = points;
+
+    std::vector<double> ms;
+    uint64_t allocs = 0, bytes = 0;
+
+    for (int i = 0; i < reps; ++i)
+    {
+        if (prep) prep();
+
+        const uint64_t a0 = gAllocCount.load(std::memory_order_relaxed);
+        const uint64_t b0 = gAllocBytes.load(std::memory_order_relaxed);
+        auto t0 = std::chrono::steady_clock::now();
+
+        r.kept = fn();
+
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        allocs += gAllocCount.load(std::memory_order_relaxed) - a0;
+        bytes += gAllocBytes.load(std::memory_order_relaxed) - b0;
+    }
+
+    std::sort(ms.begin(), ms.end());
+    r.bestMs = ms.front();
+    r.medianMs = ms[ms.size() / 2];
+    r.allocs = (double)allocs / reps;
+    r.allocBytes = (double)bytes / reps;
+    return r;
+}
+
+static std::vector<SuiteResult> RunSuite(const std::vector<int>& sizes, int reps)
+{
+    std::vector<SuiteResult> out;
+
+    for (int n : sizes)
+    {
+        const std::vector<Pt> cloud = MakeScene(n, 0.05f, 4321);
+
+        out.push_back(Measure("VoxelDownsample", n, reps, nullptr, [&]()
+            {
+                return BBB::CloudFilters::VoxelDownsample(cloud, 0.01f).size();
+            }));
+
+        out.push_back(Measure("RadiusOutlierRemoval", n, reps, nullptr, [&]()
+            {
+                return BBB::CloudFilters::RadiusOutlierRemoval(cloud, 0.04f, 10).size();
+            }));
+
+        out.push_back(Measure("StatisticalOutlierRemoval", n, reps, nullptr, [&]()
+            {
+                return BBB::CloudFilters::StatisticalOutlierRemoval(cloud, 16, 1.0f).size();
+            }));
+
+        out.push_back(Measure("KeepLargestCluster", n, reps, nullptr, [&]()
+            {
+                return BBB::CloudFilters::KeepLargestCluster(cloud, 0.08f).size();
+            }));
+
+        // candidatos de la parte baja como hace el driver, suelo en y = 0 con y hacia abajo
+        std::vector<BBB::V3> candidates;
+        for (const auto& p : cloud)
+            if (p.y > -0.05f) candidates.push_back(BBB::V3{ p.x, p.y, p.z });
+
+        BBB::Plane ground;
+        out.push_back(Measure("FitGroundPlaneRANSAC", n, reps, nullptr, [&]()
+            {
+                return BBB::CloudFilters::FitGroundPlaneRANSAC(candidates, 200, 0.01f, 0.0f, ground) ? candidates.size() : 0;
+            }));
+
+        std::vector<Pt> work;
+        out.push_back(Measure("RemoveGroundByPlane", n, reps, [&]() { work = cloud; }, [&]()
+            {
+                BBB::CloudFilters::RemoveGroundByPlane(work, ground, 0.02f);
+                return work.size();
+            }));
+
+        std::vector<float> zs;
+        out.push_back(Measure("Percentile", n, reps, [&]()
+            {
+                zs.clear();
+                zs.reserve(cloud.size());
+                for (const auto& p : cloud) zs.push_back(p.z);
+            }, [&]()
+            {
+                return std::isfinite(BBB::VisionMath::Percentile(zs, 0.5f)) ? zs.size() : 0;
+            }));
+    }
+
+    return out;
+}
+
+// lectura minima de nuestro propio JSON, una medida por linea
+static bool FindNumber(const std::string& line, const std::string& key, double& v)
+{
+    const std::string k = "\"" + key + "\":";
+    size_t p = line.find(k);
+    if (p == std::string::npos) return false;
+    v = std::atof(line.c_str() + p + k.size());
+    return true;
+}
+
+static bool FindString(const std::string& line, const std::string& key, std::string& v)
+{
+    const std::string k = "\"" + key + "\":\"";
+    size_t p = line.find(k);
+    if (p == std::string::npos) return false;
+    size_t e = line.find('"', p + k.size());
+    if (e == std::string::npos) return false;
+    v = line.substr(p + k.size(), e - p - k.size());
+    return true;
+}
+
+static std::vector<SuiteResult> LoadBaseline(const std::string& path)
+{
+    std::vector<SuiteResult> out;
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        SuiteResult r;
+        double pts = 0.0;
+        if (!FindString(line, "name", r.name) || !FindNumber(line, "points", pts) || !FindNumber(line, "best_ms", r.bestMs)) continue;
+        r.points = (int)pts;
+        out.push_back(r);
+    }
+    return out;
+}
+
+static void PrintSuite(const std::vector<SuiteResult>& res, const std::vector<SuiteResult>& base)
+{
+    std::cout << "\nsuite de filtros, mejor de las repeticiones, reservas por llamada\n";
+    std::cout << std::left << std::setw(28) << "filtro" << std::right << std::setw(9) << "puntos"
+        << std::setw(11) << "mejor ms" << std::setw(11) << "mediana" << std::setw(10) << "ns/punto"
+        << std::setw(10) << "Mpts/s" << std::setw(10) << "reservas" << std::setw(11) << "MB" << std::setw(10) << "quedan";
+    if (!base.empty()) std::cout << std::setw(10) << "mejora";
+    std::cout << "\n";
+
+    for (const auto& r : res)
+    {
+        std::cout << std::left << std::setw(28) << r.name << std::right << std::fixed
+            << std::setw(9) << r.points
+            << std::setprecision(3) << std::setw(11) << r.bestMs << std::setw(11) << r.medianMs
+            << std::setprecision(1) << std::setw(10) << r.NsPerPoint()
+            << std::setprecision(2) << std::setw(10) << r.MPtsPerSec()
+            << std::setprecision(0) << std::setw(10) << r.allocs
+            << std::setprecision(2) << std::setw(11) << r.allocBytes / (1024.0 * 1024.0)
+            << std::setw(10) << r.kept;
+
+        if (!base.empty())
+        {
+            auto it = std::find_if(base.begin(), base.end(), [&](const SuiteResult& b) { return b.name == r.name && b.points == r.points; });
+            if (it != base.end() && r.bestMs > 0.0) std::cout << std::setw(9) << std::setprecision(2) << it->bestMs / r.bestMs << "x";
+            else std::cout << std::setw(10) << "-";
+        }
+        std::cout << "\n";
+    }
+}
+
+static bool WriteSuiteJson(const std::string& path, const std::vector<SuiteResult>& res, int reps)
+{
+    std::ofstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+
+    f << std::fixed << std::setprecision(4);
+    f << "{\"bench\":\"bbb_bench\",\"threads\":" << BBB::Parallel::ThreadCount() << ",\"reps\":" << reps << ",\"results\":[\n";
+    for (size_t i = 0; i < res.size(); ++i)
+    {
+        const SuiteResult& r = res[i];
+        f << "{\"name\":\"" << r.name << "\",\"points\":" << r.points
+            << ",\"best_ms\":" << r.bestMs << ",\"median_ms\":" << r.medianMs
+            << ",\"ns_per_point\":" << r.NsPerPoint() << ",\"mpts_per_s\":" << r.MPtsPerSec()
+            << ",\"allocs\":" << r.allocs << ",\"alloc_bytes\":" << r.allocBytes
+            << ",\"kept\":" << r.kept << "}" << (i + 1 < res.size() ? "," : "") << "\n";
+    }
+    f << "]}\n";
+    return f.good();
+}
+
+int main(int argc, char** argv)
+{
+    int nPts = 200000;
+    int reps = 3;
+    bool suiteOnly = false;
+    std::vector<int> sizes = { 10000, 100000, 1000000 };
+    std::string jsonPath, baselinePath;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        if (a == "--suite") suiteOnly = true;
+        else if (a == "--check") return RunChecks() ? 0 : 1;
+        else if (a == "--reps" && i + 1 < argc) reps = (std::max)(1, std::atoi(argv[++i]));
+        else if (a == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else if (a == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+        else if (a == "--sizes" && i + 1 < argc)
+        {
+            sizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string tok;
+            while (std::getline(ss, tok, ','))
+                if (std::atoi(tok.c_str()) > 0) sizes.push_back((std::max)(1000, std::atoi(tok.c_str())));
+        }
+        else if (positional == 0) { nPts = (std::max)(1000, std::atoi(argv[i])); positional++; }
+        else if (positional == 1) { reps = (std::max)(1, std::atoi(argv[i])); positional++; }
+    }
+
+    if (suiteOnly)
+    {
+        std::cout << "bbb_bench suite repeticiones " << reps << " hilos " << BBB::Parallel::ThreadCount() << "\n";
+
+        const std::vector<SuiteResult> res = RunSuite(sizes, reps);
+        PrintSuite(res, baselinePath.empty() ? std::vector<SuiteResult>{} : LoadBaseline(baselinePath));
+
+        if (!jsonPath.empty())
+            std::cout << "JSON " << (WriteSuiteJson(jsonPath, res, reps) ? "guardado en " : "no se pudo guardar en ") << jsonPath << "\n";
+        return 0;
+    }
+
+    std::cout << "bbb_bench puntos " << nPts << " repeticiones " << reps
+        << " hilos " << BBB::Parallel::ThreadCount() << "\n";
+
+    const bool checksOk = RunChecks();
+
+    std::vector<Pt> cloud = MakeScene(nPts, 0.05f, 1234);
+
+    std::cout << std::left << std::setw(34) << "filtro" << std::right
+        << std::setw(13) << "tiempo" << std::setw(10) << "quedan"
+        << std::setw(12) << "inliers" << std::setw(12) << "outliers"
+        << std::setw(12) << "balance" << "\n";
+
+    // estadistico con los valores por defecto de BBBParams
+    Score sor = Run(cloud, reps, [](const std::vector<Pt>& in)
+        {
+            return BBB::CloudFilters::StatisticalOutlierRemoval(in, 16, 1.0f);
+        });
+    Print("estadistico k 16 a 1.0", sor);
+
+    // radio con varios radios, nos quedamos con el de precision mas parecida al estadistico
+    const float radii[] = { 0.01f, 0.02f, 0.04f, 0.06f, 0.08f, 0.12f };
+    Score bestRad;
+    float bestR = 0.0f;
+    float bestGap = 1e9f;
+
+    for (float r : radii)
+    {
+        Score s = Run(cloud, reps, [r](const std::vector<Pt>& in)
+            {
+                return BBB::CloudFilters::RadiusOutlierRemoval(in, r, 10);
+            });
+        Print("radio " + std::to_string((int)std::lround(r * 1000)) + " mm vecinos 10", s);
+
+        float gap = std::fabs(s.Balanced() - sor.Balanced());
+        if (gap < bestGap)
+        {
+            bestGap = gap;
+            bestRad = s;
+            bestR = r;
+        }
+    }
+
+    std::cout << "a igual precision radio " << (int)std::lround(bestR * 1000) << " mm "
+        << bestRad.ms << " ms frente a estadistico " << sor.ms << " ms"
+        << " balance " << bestRad.Balanced() * 100.0f << " % vs " << sor.Balanced() * 100.0f << " %\n";
+
+    // cadena outlier y cluster como en el driver, copiando la nube entre filtros o con una sola mascara
+    Score sep = Run(cloud, reps, [bestR](const std::vector<Pt>& in)
+        {
+            auto tmp = BBB::CloudFilters::RadiusOutlierRemoval(in, bestR, 10);
+            return BBB::CloudFilters::KeepLargestCluster(tmp, 0.08f);
+        });
+    Print("outlier y cluster con copias", sep);
+
+    Score shared = Run(cloud, reps, [bestR](const std::vector<Pt>& in)
+        {
+            BBB::KdTree index;
+            index.Build(in);
+
+            std::vector<uint8_t> keep(in.size(), 1);
+            BBB::CloudFilters::RadiusOutlierMask(index, bestR, 10, keep);
+            BBB::CloudFilters::LargestClusterMask(in, 0.08f, keep);
+            return BBB::CloudFilters::Compact(in, keep);
+        });
+    Print("outlier y cluster con mascara", shared);
+
+    BenchReprojection(reps);
+    BenchCoord3D(reps);
+    BenchCameraScaling(reps);
+    BenchRealtimeJitter(reps);
+    BenchProfiler(reps);
+    BenchTrace(reps);
+    BenchPerfCounters(cloud, reps);
+    BenchMetrics();
+
+    const std::vector<SuiteResult> res = RunSuite(sizes, reps);
+    PrintSuite(res, baselinePath.empty() ? std::vector<SuiteResult>{} : LoadBaseline(baselinePath));
+    if (!jsonPath.empty())
+        std::cout << "JSON " << (WriteSuiteJson(jsonPath, res, reps) ? "guardado en " : "no se pudo guardar en ") << jsonPath << "\n";
+
+    return checksOk ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "BBBCameraFilters.h"
+
+namespace BBB
+{
+    static const char* const kSpeckleEnable[] = { "SpeckleFilterEnable", "DisparitySpeckleFilterEnable", "PostProcessDisparity" };
+    static const char* const kSpeckleSize[] = { "SpeckleFilterMaxSpeckleSize", "DisparitySpeckleFilterSize", "MaxSpeckleSize" };
+    static const char* const kSpeckleThreshold[] = { "SpeckleFilterMaxDifference", "DisparitySpeckleFilterThreshold", "SpeckleThreshold" };
+    static const char* const kMedianEnable[] = { "MedianFilterEnable", "DisparityMedianFilterEnable" };
+
+    template <int N>
+    static const char* FirstWritable(const NodeAccess& nodes, const char* const (&names)[N])
+    {
+        for (int i = 0; i < N; ++i)
+            if (nodes.Writable(names[i])) return names[i];
+        return nullptr;
+    }
+
+    CameraFilterCaps CameraFilters::Probe(const NodeAccess& nodes)
+    {
+        CameraFilterCaps caps;
+        caps.speckleEnable = FirstWritable(nodes, kSpeckleEnable);
+        caps.speckleSize = FirstWritable(nodes, kSpeckleSize);
+        caps.speckleThreshold = FirstWritable(nodes, kSpeckleThreshold);
+        caps.medianEnable = FirstWritable(nodes, kMedianEnable);
+        return caps;
+    }
+
+    CameraFilterPlan CameraFilters::Configure(NodeAccess& nodes, const CameraFilterCaps& caps, const BBBParams& p)
+    {
+        CameraFilterPlan plan;
+
+        // speckle, el umbral en pixeles de disparidad como ImageUtilityStereo
+        if (p.applySpeckleFilter && p.cameraFilters && caps.HasSpeckle())
+        {
+            bool ok = nodes.SetNumber(caps.speckleSize, (double)p.maxSpeckleSize);
+            if (ok && caps.speckleThreshold) ok = nodes.SetNumber(caps.speckleThreshold, (double)p.speckleThreshold);
+            if (ok) ok = nodes.SetBool(caps.speckleEnable, true);
+            plan.speckleOnCamera = ok;
+        }
+
+        if (!plan.speckleOnCamera && caps.speckleEnable)
+            nodes.SetBool(caps.speckleEnable, false);
+
+        // el relleno guiado sustituye a la mediana en el host, con el no la pedimos a la camara
+        const bool wantMedian = p.applyMedian3x3 && !p.enableGuidedFill;
+        if (wantMedian && p.cameraFilters && caps.HasMedian())
+            plan.medianOnCamera = nodes.SetBool(caps.medianEnable, true);
+
+        if (!plan.medianOnCamera && caps.medianEnable)
+            nodes.SetBool(caps.medianEnable, false);
+
+        return plan;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BBBConfig.h"
+
+namespace BBB
+{
+    // acceso minimo a los nodos de la camara, el driver lo implementa con GenApi
+    // y sin camara vale cualquier mapa de nombres a valores
+    class NodeAccess
+    {
+    public:
+        virtual ~NodeAccess() = default;
+
+        // existe y se puede escribir
+        virtual bool Writable(const char* name) const = 0;
+
+        virtual bool SetBool(const char* name, bool value) = 0;
+
+        // entero o float segun el tipo del nodo, si es entero redondeamos
+        virtual bool SetNumber(const char* name, double value) = 0;
+    };
+
+    // nodos de postproceso de disparidad que encontramos en la camara, nullptr si no estan
+    struct CameraFilterCaps
+    {
+        const char* speckleEnable = nullptr;
+        const char* speckleSize = nullptr;
+        const char* speckleThreshold = nullptr;
+        const char* medianEnable = nullptr;
+
+        bool HasSpeckle() const { return speckleEnable && speckleSize; }
+        bool HasMedian() const { return medianEnable != nullptr; }
+    };
+
+    // que etapa hace la camara, lo que quede a false lo hace el host si esta activo
+    struct CameraFilterPlan
+    {
+        bool speckleOnCamera = false;
+        bool medianOnCamera = false;
+    };
+
+    class CameraFilters
+    {
+    public:
+        // los nombres cambian entre modelos y firmwares, probamos candidatos en orden
+        static CameraFilterCaps Probe(const NodeAccess& nodes);
+
+        // con cameraFilters y el nodo presente la etapa pasa a la camara con maxSpeckleSize
+        // y speckleThreshold, si no o si falla alguna escritura apagamos el de la camara
+        // y el plan la deja en el host, asi nunca filtramos dos veces ni ninguna
+        static CameraFilterPlan Configure(NodeAccess& nodes, const CameraFilterCaps& caps, const BBBParams& p);
+    };
+}
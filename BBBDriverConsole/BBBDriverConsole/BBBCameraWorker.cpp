@@ -0,0 +1,234 @@
+#include "BBBCameraWorker.h"
+
+#include <algorithm>
+#include <iostream>
+#include <streambuf>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace BBB
+{
+    CameraWorker::CameraWorker(const std::string& tag, int core) : CameraWorker(tag, ThreadTuning{ core, 0 })
+    {
+    }
+
+    CameraWorker::CameraWorker(const std::string& tag, const ThreadTuning& tuning) : tag(tag), tuning(tuning)
+    {
+        worker = std::thread([this]() { Loop(); });
+    }
+
+    CameraWorker::~CameraWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stop = true;
+        }
+        cvJob.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    void CameraWorker::Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            jobs.push_back(std::move(job));
+            pending++;
+        }
+        cvJob.notify_one();
+    }
+
+    void CameraWorker::Wait()
+    {
+        std::unique_lock<std::mutex> lk(m);
+        cvIdle.wait(lk, [this]() { return jobs.empty() && running == 0; });
+    }
+
+    void CameraWorker::Run(std::function<void()> job)
+    {
+        Submit(std::move(job));
+        Wait();
+    }
+
+    void CameraWorker::Loop()
+    {
+        ConsoleLines::SetThreadTag(tag);
+
+        if (tuning.core >= 0 && !PinCurrentThread(tuning.core))
+            std::cout << "No se pudo fijar el hilo al nucleo " << tuning.core << "\n";
+
+        if (tuning.rtPriority > 0 && !SetRealtimePriority(tuning.rtPriority))
+            std::cout << "No se pudo poner prioridad tiempo real " << tuning.rtPriority << ", seguimos en tiempo compartido\n";
+
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cvJob.wait(lk, [this]() { return stop || !jobs.empty(); });
+                if (stop && jobs.empty()) return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                running++;
+            }
+
+            try { job(); }
+            catch (const std::exception& e) { std::cout << "Excepcion en hilo de camara " << e.what() << "\n"; }
+            catch (...) { std::cout << "Excepcion en hilo de camara\n"; }
+
+            {
+                std::lock_guard<std::mutex> lk(m);
+                running--;
+                pending--;
+            }
+            cvIdle.notify_all();
+        }
+    }
+
+    bool CameraWorker::PinCurrentThread(int core)
+    {
+        if (core < 0) return false;
+
+#ifdef _WIN32
+        if (core >= 64) return false;
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#elif defined(__linux__)
+        if (core >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool CameraWorker::SetRealtimePriority(int priority)
+    {
+        if (priority <= 0) return false;
+
+#ifdef _WIN32
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#elif defined(__linux__)
+        sched_param sp{};
+        sp.sched_priority = (std::min)(priority, sched_get_priority_max(SCHED_FIFO));
+        return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool CameraWorker::LockProcessMemory()
+    {
+        static std::mutex lockMutex;
+        static bool locked = false;
+
+        std::lock_guard<std::mutex> lk(lockMutex);
+        if (locked) return true;
+
+#ifdef _WIN32
+        // sin mlockall, subimos el minimo del working set para que no lo recorte
+        locked = SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)256 << 20, (SIZE_T)1 << 30) != 0;
+#elif defined(__linux__)
+        locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#endif
+        return locked;
+    }
+
+    // buffer de std::cout que junta por hilo y escribe lineas completas con un lock
+    class LineSyncBuf : public std::streambuf
+    {
+    public:
+        explicit LineSyncBuf(std::streambuf* out) : out(out) {}
+
+        static thread_local std::string tag;
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+
+            char c = traits_type::to_char_type(ch);
+            Pending().push_back(c);
+            if (c == '\n') Emit();
+            return ch;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            for (std::streamsize i = 0; i < n; ++i)
+            {
+                Pending().push_back(s[i]);
+                if (s[i] == '\n') Emit();
+            }
+            return n;
+        }
+
+        // flush y la lectura de std::cin piden sacar lo que haya aunque no acabe en salto
+        int sync() override
+        {
+            if (!Pending().empty()) Emit();
+            return 0;
+        }
+
+    private:
+        static std::string& Pending()
+        {
+            static thread_local std::string line;
+            return line;
+        }
+
+        static bool& AtLineStart()
+        {
+            static thread_local bool start = true;
+            return start;
+        }
+
+        void Emit()
+        {
+            std::string& line = Pending();
+
+            std::lock_guard<std::mutex> lk(m);
+            if (AtLineStart() && !tag.empty() && line != "\n")
+            {
+                out->sputc('[');
+                out->sputn(tag.data(), (std::streamsize)tag.size());
+                out->sputn("] ", 2);
+            }
+            out->sputn(line.data(), (std::streamsize)line.size());
+            out->pubsync();
+
+            AtLineStart() = line.back() == '\n';
+            line.clear();
+        }
+
+        std::streambuf* out;
+        std::mutex m;
+    };
+
+    thread_local std::string LineSyncBuf::tag;
+
+    void ConsoleLines::Install()
+    {
+        static LineSyncBuf buf(std::cout.rdbuf());
+        static bool installed = false;
+        if (installed) return;
+
+        std::cout.rdbuf(&buf);
+        installed = true;
+    }
+
+    void ConsoleLines::SetThreadTag(const std::string& tag)
+    {
+        LineSyncBuf::tag = tag;
+    }
+}
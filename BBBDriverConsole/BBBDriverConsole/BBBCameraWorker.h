@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace BBB
+{
+    // afinidad y prioridad de un hilo, core < 0 sin fijar, rtPriority 0 sin tiempo real
+    struct ThreadTuning
+    {
+        int core = -1;
+        int rtPriority = 0;
+    };
+
+    // hilo propio de una camara, los trabajos se hacen en orden de llegada
+    // con varias camaras la ronda dura lo que la mas lenta y no la suma de todas
+    // los bucles pesados de cada trabajo siguen repartiendose en el pool de Parallel
+    class CameraWorker
+    {
+    public:
+        // tag va delante de cada linea que escriba el hilo, core < 0 lo deja sin fijar
+        CameraWorker(const std::string& tag, int core);
+        CameraWorker(const std::string& tag, const ThreadTuning& tuning);
+        ~CameraWorker();
+
+        CameraWorker(const CameraWorker&) = delete;
+        CameraWorker& operator=(const CameraWorker&) = delete;
+
+        void Submit(std::function<void()> job);
+
+        // esperamos a que acaben todos los trabajos enviados
+        void Wait();
+
+        // enviamos y esperamos, para pasar un paso concreto a este hilo
+        void Run(std::function<void()> job);
+
+        // trabajos en cola mas el que esta corriendo, se puede leer desde cualquier hilo
+        int Pending() const { return pending.load(std::memory_order_relaxed); }
+
+        // fijamos el hilo que llama a un nucleo, false si el sistema no deja
+        static bool PinCurrentThread(int core);
+
+        // SCHED_FIFO en Linux, en Windows prioridad critica, sin permisos devuelve false
+        static bool SetRealtimePriority(int priority);
+
+        // mlockall de lo mapeado y lo que venga, una vez por proceso
+        static bool LockProcessMemory();
+
+    private:
+        void Loop();
+
+        std::string tag;
+        ThreadTuning tuning;
+
+        std::thread worker;
+        std::deque<std::function<void()>> jobs;
+        int running = 0;
+        bool stop = false;
+        std::atomic<int> pending{ 0 };
+
+        std::mutex m;
+        std::condition_variable cvJob;
+        std::condition_variable cvIdle;
+    };
+
+    // std::cout con una linea entera por escritura aunque escriban varios hilos
+    // cada hilo acumula su linea y la suelta con su etiqueta al llegar al salto
+    class ConsoleLines
+    {
+    public:
+        // sustituimos el buffer de std::cout, se llama una vez al arrancar
+        static void Install();
+
+        static void SetThreadTag(const std::string& tag);
+    };
+}
@@ -0,0 +1,88 @@
+#include "BBBColorize.h"
+
+#include "BBBParallel.h"
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+
+namespace BBB
+{
+    void Colorize::Apply(std::vector<Pt>& pts, int colorMode, const ColorSource& src, float zMin, float zMax)
+    {
+        const GuideView& img = src.image;
+        const bool haveImage = img.data && img.strideBytes > 0 && src.pixWidth > 0 &&
+            (img.bpp == 8 || img.bpp == 24);
+
+        const bool fromImage = (colorMode == 1 || colorMode == 3) && haveImage;
+
+        if (colorMode == 2)
+        {
+            Parallel::For(0, (int)pts.size(), 4096, [&](int b, int e)
+                {
+                    // z a SoA por bloques pequenos que caben en L1
+                    constexpr int kBlock = 256;
+                    float zs[kBlock];
+                    uint8_t rgb[kBlock * 3];
+
+                    for (int i0 = b; i0 < e; i0 += kBlock)
+                    {
+                        const int n = (std::min)(kBlock, e - i0);
+                        for (int k = 0; k < n; ++k) zs[k] = pts[i0 + k].z;
+
+                        VisionMath::DepthToHeatBatch(zs, n, zMin, zMax, rgb);
+
+                        for (int k = 0; k < n; ++k)
+                        {
+                            Pt& q = pts[i0 + k];
+                            q.r = rgb[k * 3 + 0];
+                            q.g = rgb[k * 3 + 1];
+                            q.b = rgb[k * 3 + 2];
+                        }
+                    }
+                });
+            return;
+        }
+
+        Parallel::For(0, (int)pts.size(), 4096, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    Pt& q = pts[i];
+                    uint8_t R = 180, G = 180, B = 180;
+
+                    if (fromImage && q.pix >= 0)
+                    {
+                        const int x = q.pix % src.pixWidth;
+                        const int y = q.pix / src.pixWidth;
+
+                        if (x < img.width && y < img.height)
+                        {
+                            if (img.bpp == 24)
+                            {
+                                // cuando fijamos PixelFormat a RGB8Packed el orden es R G B
+                                const uint8_t* px = img.data + (size_t)y * img.strideBytes + (size_t)x * 3;
+                                R = px[0]; G = px[1]; B = px[2];
+                            }
+                            else if (src.bayer != BayerPattern::None)
+                            {
+                                Demosaic::SampleRGB(img, src.bayer, src.edgeAware, x, y, R, G, B);
+                            }
+                            else
+                            {
+                                uint8_t v = img.data[(size_t)y * img.strideBytes + x];
+                                R = v; G = v; B = v;
+                            }
+
+                            if (colorMode == 1)
+                            {
+                                uint8_t v = (uint8_t)(((int)R + (int)G + (int)B) / 3);
+                                R = v; G = v; B = v;
+                            }
+                        }
+                    }
+
+                    q.r = R; q.g = G; q.b = B;
+                }
+            });
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BBBDemosaic.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // imagen de la que sacamos el color de cada punto por su pix
+    // pixWidth es el ancho con el que se codifico pix, el de la disparidad
+    struct ColorSource
+    {
+        GuideView image;
+        BayerPattern bayer = BayerPattern::None;
+        bool edgeAware = true;
+        int pixWidth = 0;
+    };
+
+    class Colorize
+    {
+    public:
+        // color de los puntos que quedan tras filtrar, mismos modos que colorMode
+        // 0 gris fijo, 1 gris de la imagen, 2 calor por z, 3 color de la imagen
+        // el calor va por bloques con VisionMath::DepthToHeatBatch
+        // sin imagen o sin pix los puntos quedan en gris fijo
+        static void Apply(std::vector<Pt>& pts, int colorMode, const ColorSource& src, float zMin, float zMax);
+    };
+}
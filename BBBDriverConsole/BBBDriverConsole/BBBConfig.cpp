@@ -20,11 +20,13 @@ static inline std::string ToLower(std::string s)
     return s;
 }
 
-static std::string DefaultOrientForIndex(int index0Based)
+// ARR las tres primeras son las del arco clasico, de la cuarta en adelante camN
+std::string BBBConfig::DefaultOrientForIndex(int index0Based)
 {
     if (index0Based == 0) return "izq";
     if (index0Based == 1) return "der";
-    return "cenital";
+    if (index0Based == 2) return "cenital";
+    return "cam" + std::to_string(index0Based + 1);
 }
 
 static std::string CanonicalOrient(std::string s)
@@ -43,13 +45,25 @@ static bool NearlyEqualF(float a, float b, float eps = 1e-6f)
     return da <= eps * m;
 }
 
-static bool ControlEqual(const BBBControl& a, const BBBControl& b)
+bool BBBConfig::ControlEqual(const BBBControl& a, const BBBControl& b)
 {
     return std::fabs(a.exposureUs - b.exposureUs) <= 1e-6 &&
            std::fabs(a.gainDb - b.gainDb) <= 1e-6;
 }
 
-static bool ParamsEqual(const BBBParams& a, const BBBParams& b)
+bool BBBConfig::MountEqual(const BBBCameraMount& a, const BBBCameraMount& b)
+{
+    return
+        NearlyEqualF(a.alturaCamaraM, b.alturaCamaraM) &&
+        NearlyEqualF(a.distHorizArc0M, b.distHorizArc0M) &&
+        NearlyEqualF(a.pitchDeg, b.pitchDeg) &&
+        NearlyEqualF(a.yawDeg, b.yawDeg) &&
+        NearlyEqualF(a.rollDeg, b.rollDeg) &&
+        NearlyEqualF(a.posXM, b.posXM) &&
+        NearlyEqualF(a.posZM, b.posZM);
+}
+
+bool BBBConfig::ParamsEqual(const BBBParams& a, const BBBParams& b)
 {
     return
         NearlyEqualF(a.minRangeM, b.minRangeM) &&
@@ -62,7 +76,13 @@ static bool ParamsEqual(const BBBParams& a, const BBBParams& b)
         a.applySpeckleFilter == b.applySpeckleFilter &&
         a.maxSpeckleSize == b.maxSpeckleSize &&
         a.speckleThreshold == b.speckleThreshold &&
+        a.ownSpeckleFilter == b.ownSpeckleFilter &&
+        a.speckleMarginPx == b.speckleMarginPx &&
         a.applyMedian3x3 == b.applyMedian3x3 &&
+        a.enableGuidedFill == b.enableGuidedFill &&
+        a.guidedRadiusPx == b.guidedRadiusPx &&
+        NearlyEqualF(a.guidedEps, b.guidedEps) &&
+        NearlyEqualF(a.guidedMinCoverage, b.guidedMinCoverage) &&
         NearlyEqualF(a.voxelLeafM, b.voxelLeafM) &&
         NearlyEqualF(a.outlierRadiusM, b.outlierRadiusM) &&
         a.outlierMinNeighbors == b.outlierMinNeighbors &&
@@ -82,7 +102,55 @@ static bool ParamsEqual(const BBBParams& a, const BBBParams& b)
         a.plyBinary == b.plyBinary &&
         NearlyEqualF(a.hardMaxZM, b.hardMaxZM) &&
         NearlyEqualF(a.groundMinHeightM, b.groundMinHeightM) &&
-        NearlyEqualF(a.bultoFacePercentile, b.bultoFacePercentile);
+        NearlyEqualF(a.bultoFacePercentile, b.bultoFacePercentile) &&
+        NearlyEqualF(a.heightMapCellM, b.heightMapCellM) &&
+        a.enableFaceSegmentation == b.enableFaceSegmentation &&
+        NearlyEqualF(a.faceAngleDeg, b.faceAngleDeg) &&
+        NearlyEqualF(a.faceDistM, b.faceDistM) &&
+        a.faceMinPoints == b.faceMinPoints &&
+        a.normalRadiusPx == b.normalRadiusPx &&
+        a.estimateNormals == b.estimateNormals &&
+        NearlyEqualF(a.normalMaxDepthChange, b.normalMaxDepthChange) &&
+        a.outlierMode == b.outlierMode &&
+        a.sorMeanK == b.sorMeanK &&
+        NearlyEqualF(a.sorStdMul, b.sorStdMul) &&
+        a.lodLevels == b.lodLevels &&
+        a.sgmNumDisparities == b.sgmNumDisparities &&
+        a.sgmP1 == b.sgmP1 &&
+        a.sgmP2 == b.sgmP2 &&
+        a.sgmPaths == b.sgmPaths &&
+        a.streamBayer == b.streamBayer &&
+        a.demosaicEdgeAware == b.demosaicEdgeAware &&
+        a.streamCoord3D == b.streamCoord3D &&
+        a.cameraFilters == b.cameraFilters &&
+        a.streamBufferCount == b.streamBufferCount;
+}
+
+BBBConfigDiff BBBConfig::Diff(const CameraConfig& before, const CameraConfig& after)
+{
+    const BBBParams& a = before.params;
+    const BBBParams& b = after.params;
+
+    BBBConfigDiff d;
+    d.params = !ParamsEqual(a, b);
+    d.control = !ControlEqual(before.control, after.control);
+    d.mount = !MountEqual(before.mount, after.mount);
+
+    if (d.params)
+    {
+        d.streams = a.streamBayer != b.streamBayer || a.streamCoord3D != b.streamCoord3D ||
+            a.streamBufferCount != b.streamBufferCount;
+
+        d.cameraFilters =
+            a.cameraFilters != b.cameraFilters ||
+            a.applySpeckleFilter != b.applySpeckleFilter ||
+            a.maxSpeckleSize != b.maxSpeckleSize ||
+            a.speckleThreshold != b.speckleThreshold ||
+            a.applyMedian3x3 != b.applyMedian3x3 ||
+            a.enableGuidedFill != b.enableGuidedFill;
+    }
+
+    return d;
 }
 
 static bool ParseIni(const std::string& path, std::unordered_map<std::string, std::string>& kv)
@@ -184,6 +252,10 @@ static void LoadMount(const std::unordered_map<std::string, std::string>& kv, co
     GetF(kv, prefix + ".alturacamaram", m.alturaCamaraM);
     GetF(kv, prefix + ".disthorizarc0m", m.distHorizArc0M);
     GetF(kv, prefix + ".pitchdeg", m.pitchDeg);
+    GetF(kv, prefix + ".yawdeg", m.yawDeg);
+    GetF(kv, prefix + ".rolldeg", m.rollDeg);
+    GetF(kv, prefix + ".posxm", m.posXM);
+    GetF(kv, prefix + ".poszm", m.posZM);
 }
 
 static void LoadParams(const std::unordered_map<std::string, std::string>& kv, const std::string& prefix, BBBParams& p)
@@ -201,13 +273,23 @@ static void LoadParams(const std::unordered_map<std::string, std::string>& kv, c
     GetB(kv, prefix + ".applyspecklefilter", p.applySpeckleFilter);
     GetI(kv, prefix + ".maxspecklesize", p.maxSpeckleSize);
     GetI(kv, prefix + ".specklethreshold", p.speckleThreshold);
+    GetB(kv, prefix + ".ownspecklefilter", p.ownSpeckleFilter);
+    GetI(kv, prefix + ".specklemarginpx", p.speckleMarginPx);
 
     GetB(kv, prefix + ".applymedian3x3", p.applyMedian3x3);
 
+    GetB(kv, prefix + ".enableguidedfill", p.enableGuidedFill);
+    GetI(kv, prefix + ".guidedradiuspx", p.guidedRadiusPx);
+    GetF(kv, prefix + ".guidedeps", p.guidedEps);
+    GetF(kv, prefix + ".guidedmincoverage", p.guidedMinCoverage);
+
     GetF(kv, prefix + ".voxelleafm", p.voxelLeafM);
 
     GetF(kv, prefix + ".outlierradiusm", p.outlierRadiusM);
     GetI(kv, prefix + ".outlierminneighbors", p.outlierMinNeighbors);
+    GetI(kv, prefix + ".outliermode", p.outlierMode);
+    GetI(kv, prefix + ".sormeank", p.sorMeanK);
+    GetF(kv, prefix + ".sorstdmul", p.sorStdMul);
 
     GetB(kv, prefix + ".keeplargestcluster", p.keepLargestCluster);
 
@@ -233,6 +315,33 @@ static void LoadParams(const std::unordered_map<std::string, std::string>& kv, c
     GetF(kv, prefix + ".groundminheightm", p.groundMinHeightM);
 
     GetF(kv, prefix + ".bultofacepercentile", p.bultoFacePercentile);
+
+    GetF(kv, prefix + ".heightmapcellm", p.heightMapCellM);
+
+    GetB(kv, prefix + ".enablefacesegmentation", p.enableFaceSegmentation);
+    GetF(kv, prefix + ".faceangledeg", p.faceAngleDeg);
+    GetF(kv, prefix + ".facedistm", p.faceDistM);
+    GetI(kv, prefix + ".faceminpoints", p.faceMinPoints);
+
+    GetI(kv, prefix + ".normalradiuspx", p.normalRadiusPx);
+    GetB(kv, prefix + ".estimatenormals", p.estimateNormals);
+    GetF(kv, prefix + ".normalmaxdepthchange", p.normalMaxDepthChange);
+
+    GetI(kv, prefix + ".lodlevels", p.lodLevels);
+
+    GetI(kv, prefix + ".sgmnumdisparities", p.sgmNumDisparities);
+    GetI(kv, prefix + ".sgmp1", p.sgmP1);
+    GetI(kv, prefix + ".sgmp2", p.sgmP2);
+    GetI(kv, prefix + ".sgmpaths", p.sgmPaths);
+
+    GetB(kv, prefix + ".streambayer", p.streamBayer);
+    GetB(kv, prefix + ".demosaicedgeaware", p.demosaicEdgeAware);
+
+    GetB(kv, prefix + ".streamcoord3d", p.streamCoord3D);
+
+    GetB(kv, prefix + ".camerafilters", p.cameraFilters);
+
+    GetI(kv, prefix + ".streambuffercount", p.streamBufferCount);
 }
 
 static void LoadControl(const std::unordered_map<std::string, std::string>& kv, const std::string& prefix, BBBControl& c)
@@ -258,6 +367,10 @@ static void SaveMount(std::ofstream& f, const BBBCameraMount& m)
     WriteKV(f, "alturaCamaraM", m.alturaCamaraM);
     WriteKV(f, "distHorizArc0M", m.distHorizArc0M);
     WriteKV(f, "pitchDeg", m.pitchDeg);
+    WriteKV(f, "yawDeg", m.yawDeg);
+    WriteKV(f, "rollDeg", m.rollDeg);
+    WriteKV(f, "posXM", m.posXM);
+    WriteKV(f, "posZM", m.posZM);
 }
 
 static void SaveParams(std::ofstream& f, const BBBParams& p)
@@ -275,13 +388,23 @@ static void SaveParams(std::ofstream& f, const BBBParams& p)
     WriteKV(f, "applySpeckleFilter", p.applySpeckleFilter);
     WriteKV(f, "maxSpeckleSize", p.maxSpeckleSize);
     WriteKV(f, "speckleThreshold", p.speckleThreshold);
+    WriteKV(f, "ownSpeckleFilter", p.ownSpeckleFilter);
+    WriteKV(f, "speckleMarginPx", p.speckleMarginPx);
 
     WriteKV(f, "applyMedian3x3", p.applyMedian3x3);
 
+    WriteKV(f, "enableGuidedFill", p.enableGuidedFill);
+    WriteKV(f, "guidedRadiusPx", p.guidedRadiusPx);
+    WriteKV(f, "guidedEps", p.guidedEps);
+    WriteKV(f, "guidedMinCoverage", p.guidedMinCoverage);
+
     WriteKV(f, "voxelLeafM", p.voxelLeafM);
 
     WriteKV(f, "outlierRadiusM", p.outlierRadiusM);
     WriteKV(f, "outlierMinNeighbors", p.outlierMinNeighbors);
+    WriteKV(f, "outlierMode", p.outlierMode);
+    WriteKV(f, "sorMeanK", p.sorMeanK);
+    WriteKV(f, "sorStdMul", p.sorStdMul);
 
     WriteKV(f, "keepLargestCluster", p.keepLargestCluster);
 
@@ -307,6 +430,33 @@ static void SaveParams(std::ofstream& f, const BBBParams& p)
     WriteKV(f, "groundMinHeightM", p.groundMinHeightM);
 
     WriteKV(f, "bultoFacePercentile", p.bultoFacePercentile);
+
+    WriteKV(f, "heightMapCellM", p.heightMapCellM);
+
+    WriteKV(f, "enableFaceSegmentation", p.enableFaceSegmentation);
+    WriteKV(f, "faceAngleDeg", p.faceAngleDeg);
+    WriteKV(f, "faceDistM", p.faceDistM);
+    WriteKV(f, "faceMinPoints", p.faceMinPoints);
+
+    WriteKV(f, "normalRadiusPx", p.normalRadiusPx);
+    WriteKV(f, "estimateNormals", p.estimateNormals);
+    WriteKV(f, "normalMaxDepthChange", p.normalMaxDepthChange);
+
+    WriteKV(f, "lodLevels", p.lodLevels);
+
+    WriteKV(f, "sgmNumDisparities", p.sgmNumDisparities);
+    WriteKV(f, "sgmP1", p.sgmP1);
+    WriteKV(f, "sgmP2", p.sgmP2);
+    WriteKV(f, "sgmPaths", p.sgmPaths);
+
+    WriteKV(f, "streamBayer", p.streamBayer);
+    WriteKV(f, "demosaicEdgeAware", p.demosaicEdgeAware);
+
+    WriteKV(f, "streamCoord3D", p.streamCoord3D);
+
+    WriteKV(f, "cameraFilters", p.cameraFilters);
+
+    WriteKV(f, "streamBufferCount", p.streamBufferCount);
 }
 
 static void SaveControl(std::ofstream& f, const BBBControl& c)
@@ -337,9 +487,13 @@ bool BBBConfig::LoadIni(const std::string& iniPath, BBBAppConfig& out)
     GetB(kv, "general.autoadddetectedcameras", out.autoAddDetectedCameras);
     GetB(kv, "general.autonamefromserial", out.autoNameFromSerial);
     GetStr(kv, "general.nameprefix", out.namePrefix);
+    GetI(kv, "general.profilesummarysec", out.profileSummarySec);
+    GetB(kv, "general.traceenabled", out.traceEnabled);
+    GetB(kv, "general.perfcounters", out.perfCounters);
+    GetStr(kv, "general.metricsfile", out.metricsFile);
+    GetI(kv, "general.metricsintervalsec", out.metricsIntervalSec);
 
     if (out.maxCameras < 1) out.maxCameras = 1;
-    if (out.maxCameras > 3) out.maxCameras = 3;
 
     LoadMount(kv, "defaults", out.defaultMount);
     LoadParams(kv, "defaults.params", out.defaultParams);
@@ -377,6 +531,11 @@ bool BBBConfig::LoadIni(const std::string& iniPath, BBBAppConfig& out)
 
             c.orient = CanonicalOrient(c.orient);
 
+            GetI(kv, base + ".workercore", c.workerCore);
+            GetI(kv, base + ".acqcore", c.acqCore);
+            GetI(kv, base + ".rtpriority", c.rtPriority);
+            GetB(kv, base + ".lockmemory", c.lockMemory);
+
             LoadMount(kv, base, c.mount);
             LoadParams(kv, base + ".params", c.params);
             LoadControl(kv, base + ".control", c.control);
@@ -406,7 +565,6 @@ bool BBBConfig::SaveIni(const std::string& iniPath, const BBBAppConfig& cfgIn)
     BBBAppConfig cfg = cfgIn;
 
     if (cfg.maxCameras < 1) cfg.maxCameras = 1;
-    if (cfg.maxCameras > 3) cfg.maxCameras = 3;
 
     if ((int)cfg.cameras.size() < cfg.maxCameras)
     {
@@ -439,6 +597,11 @@ bool BBBConfig::SaveIni(const std::string& iniPath, const BBBAppConfig& cfgIn)
     WriteKV(f, "autoAddDetectedCameras", cfg.autoAddDetectedCameras);
     WriteKV(f, "autoNameFromSerial", cfg.autoNameFromSerial);
     WriteKV(f, "namePrefix", cfg.namePrefix);
+    WriteKV(f, "profileSummarySec", cfg.profileSummarySec);
+    WriteKV(f, "traceEnabled", cfg.traceEnabled);
+    WriteKV(f, "perfCounters", cfg.perfCounters);
+    WriteKV(f, "metricsFile", cfg.metricsFile);
+    WriteKV(f, "metricsIntervalSec", cfg.metricsIntervalSec);
     f << "\n";
 
     WriteSection(f, "Defaults");
@@ -468,6 +631,10 @@ bool BBBConfig::SaveIni(const std::string& iniPath, const BBBAppConfig& cfgIn)
         WriteKV(f, "serial", c.serial);
         WriteKV(f, "name", c.name);
         WriteKV(f, "orient", c.orient);
+        WriteKV(f, "workerCore", c.workerCore);
+        WriteKV(f, "acqCore", c.acqCore);
+        WriteKV(f, "rtPriority", c.rtPriority);
+        WriteKV(f, "lockMemory", c.lockMemory);
         SaveMount(f, c.mount);
         f << "\n";
 
@@ -498,7 +665,6 @@ bool BBBConfig::EnsureDetectedCameras(
     if (!cfg.autoAddDetectedCameras) return true;
 
     if (cfg.maxCameras < 1) cfg.maxCameras = 1;
-    if (cfg.maxCameras > 3) cfg.maxCameras = 3;
 
     // ARR limpiamos duplicados dentro del propio cfg
     for (int i = 0; i < (int)cfg.cameras.size(); ++i)
@@ -537,7 +703,7 @@ bool BBBConfig::EnsureDetectedCameras(
             return false;
         };
 
-    // ARR primero rellenamos huecos serial vacios en Camera.0..2
+    // ARR primero rellenamos huecos serial vacios en Camera.0..maxCameras-1
     for (const auto& s : uniqueDetected)
     {
         if (HasSerial(s)) continue;
@@ -565,8 +731,9 @@ bool BBBConfig::EnsureDetectedCameras(
 
         if (placed) continue;
 
+        // ARR un arco puede tener mas cabezas que maxCameras, subimos el limite y queda en el INI
         if ((int)cfg.cameras.size() >= cfg.maxCameras)
-            continue;
+            cfg.maxCameras = (int)cfg.cameras.size() + 1;
 
         CameraConfig c;
         c.enabled = true;
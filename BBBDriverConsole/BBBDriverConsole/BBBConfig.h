@@ -8,6 +8,14 @@ struct BBBCameraMount
     float alturaCamaraM = 3.849f;
     float distHorizArc0M = 0.0f;
     float pitchDeg = 36.45f;
+
+    // extrinsecos completos en el sistema del arco X lateral Y arriba Z delante
+    // por defecto cero y la camara queda definida solo por altura y pitch
+    // los afinamos con ICP entre camaras
+    float yawDeg = 0.0f;
+    float rollDeg = 0.0f;
+    float posXM = 0.0f;
+    float posZM = 0.0f;
 };
 
 struct BBBParams
@@ -25,14 +33,31 @@ struct BBBParams
     bool applySpeckleFilter = true;
     int maxSpeckleSize = 900;
     int speckleThreshold = 20;
+    // speckle propio por bandas en paralelo y solo sobre el ROI, false usa el del SDK sobre toda la imagen
+    // margen alrededor del ROI, nunca menos que maxSpeckleSize para salir igual que el del SDK
+    bool ownSpeckleFilter = true;
+    int speckleMarginPx = 900;
 
     bool applyMedian3x3 = true;
 
+    // relleno de huecos y suavizado con filtro guiado por la rectificada antes de reproyectar
+    // con el activo la mediana 3x3 sobra y no se aplica
+    // ventana en pixeles, regularizacion sobre gris en [0, 1] y fraccion minima de validos para rellenar
+    bool enableGuidedFill = false;
+    int guidedRadiusPx = 4;
+    float guidedEps = 0.001f;
+    float guidedMinCoverage = 0.4f;
+
     float voxelLeafM = 0.01f;
 
     float outlierRadiusM = 0.08f;
     int outlierMinNeighbors = 10;
 
+    // filtro de outliers 0 radio 1 estadistico por k vecinos
+    int outlierMode = 0;
+    int sorMeanK = 16;
+    float sorStdMul = 1.0f;
+
     bool keepLargestCluster = true;
 
     bool enableGroundPlaneFilter = true;
@@ -57,6 +82,51 @@ struct BBBParams
     float groundMinHeightM = 0.08f;
 
     float bultoFacePercentile = 0.10f;
+
+    // celda del mapa de alturas para la camara cenital, 0 lo desactiva
+    float heightMapCellM = 0.01f;
+
+    // caras del bulto por segmentacion de planos sobre la nube organizada
+    // si no hay cara frontal volvemos al slab de faceSlabM
+    bool enableFaceSegmentation = true;
+    float faceAngleDeg = 12.0f;
+    float faceDistM = 0.015f;
+    int faceMinPoints = 300;
+
+    // ventana de normales en celdas de la rejilla, radio
+    int normalRadiusPx = 3;
+    // salto de profundidad relativo a z que corta la ventana de normales, 0 sin bordes
+    float normalMaxDepthChange = 0.02f;
+
+    // normales por punto desde la rejilla organizada, van al PLY y al LOD como nx ny nz
+    bool estimateNormals = false;
+
+    // fichero .lod junto al PLY con niveles progresivos de un octree, 0 no lo genera
+    // cada nivel anade puntos al anterior y el ultimo lleva el resto a resolucion completa
+    int lodLevels = 0;
+
+    // SGM en el host para reprocesar pares guardados, opcion 7 del menu
+    // disparidades a buscar multiplo de 8, penalizaciones de salto y caminos 4 u 8
+    int sgmNumDisparities = 128;
+    int sgmP1 = 8;
+    int sgmP2 = 96;
+    int sgmPaths = 8;
+
+    // rectificada en Bayer para ahorrar ancho de banda, demosaicamos en el host
+    // con edgeAware el verde se interpola siguiendo el borde
+    bool streamBayer = false;
+    bool demosaicEdgeAware = true;
+
+    // la camara manda Coord3D ABC o AC en vez de disparidad y nos saltamos la reproyeccion
+    // sin speckle ni relleno guiado en el host, esos van sobre disparidad
+    bool streamCoord3D = false;
+
+    // speckle y mediana en la camara cuando tiene los nodos, el host se salta esa etapa
+    // sin los nodos o a false los hace el host como siempre
+    bool cameraFilters = true;
+
+    // buffers del stream de cada camara, 0 deja los que ponga el SDK
+    int streamBufferCount = 0;
 };
 
 struct BBBControl
@@ -85,6 +155,19 @@ struct CameraConfig
     // ARR lo leemos del INI como orient y por compatibilidad side
     std::string orient;
 
+    // ARR nucleo al que fijamos el hilo de proceso de la camara, -1 lo deja al sistema
+    int workerCore = -1;
+
+    // ARR nucleo del hilo que espera los frames, separado del de proceso para que
+    // ARR el filtrado de una camara no retrase la recogida de la siguiente
+    int acqCore = -1;
+
+    // ARR prioridad SCHED_FIFO 1 a 99 de ambos hilos, 0 los deja en tiempo compartido
+    int rtPriority = 0;
+
+    // ARR mlockall para que los buffers no se paginen, vale para todo el proceso
+    bool lockMemory = false;
+
     BBBCameraMount mount;
     BBBParams params;
     BBBControl control;
@@ -100,6 +183,20 @@ struct BBBAppConfig
     bool autoNameFromSerial = true;
     std::string namePrefix = "BBB";
 
+    // ARR cada cuantos segundos sacamos la tabla de tiempos por etapa, 0 solo desde el menu
+    int profileSummarySec = 0;
+
+    // ARR traza de tiempos por hilo para Chrome o Perfetto, se vuelca al salir y desde el menu
+    bool traceEnabled = false;
+
+    // ARR ciclos instrucciones y fallos de cache y salto por etapa con perf_event_open
+    // ARR si no hay permisos o PMU se queda en lo que haya y sale en la tabla de tiempos
+    bool perfCounters = false;
+
+    // ARR metricas Prometheus en fichero para el textfile collector, vacio no escribe
+    std::string metricsFile;
+    int metricsIntervalSec = 5;
+
     BBBCameraMount defaultMount;
     BBBParams defaultParams;
     BBBControl defaultControl;
@@ -107,6 +204,22 @@ struct BBBAppConfig
     std::vector<CameraConfig> cameras;
 };
 
+// ARR que cambio de una camara al releer el INI, lo derivado se rehace solo si cambio su entrada
+struct BBBConfigDiff
+{
+    bool params = false;
+    bool control = false;
+    bool mount = false;
+
+    // formatos y buffers de stream, para aplicarlos hay que parar la adquisicion de esa camara
+    bool streams = false;
+
+    // entradas del reparto de filtros entre camara y host
+    bool cameraFilters = false;
+
+    bool Any() const { return params || control || mount; }
+};
+
 class BBBConfig
 {
 public:
@@ -120,4 +233,12 @@ public:
     );
 
     static std::string MakeAutoName(const BBBAppConfig& cfg, const std::string& serial, int index1Based);
+
+    static std::string DefaultOrientForIndex(int index0Based);
+
+    static bool ParamsEqual(const BBBParams& a, const BBBParams& b);
+    static bool ControlEqual(const BBBControl& a, const BBBControl& b);
+    static bool MountEqual(const BBBCameraMount& a, const BBBCameraMount& b);
+
+    static BBBConfigDiff Diff(const CameraConfig& before, const CameraConfig& after);
 };
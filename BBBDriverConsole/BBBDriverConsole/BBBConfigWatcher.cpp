@@ -0,0 +1,118 @@
+#include "BBBConfigWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+BBBConfigWatcher::~BBBConfigWatcher()
+{
+    Stop();
+}
+
+bool BBBConfigWatcher::StampChanged()
+{
+    std::error_code ec;
+    const std::filesystem::path p(path);
+
+    auto t = std::filesystem::last_write_time(p, ec);
+    if (ec) return false;
+    uint64_t size = std::filesystem::file_size(p, ec);
+    if (ec) return false;
+
+    int64_t write = (int64_t)t.time_since_epoch().count();
+    if (write == lastWrite && size == lastSize) return false;
+
+    lastWrite = write;
+    lastSize = size;
+    return true;
+}
+
+bool BBBConfigWatcher::Start(const std::string& iniPath, std::function<void()> cb)
+{
+    Stop();
+
+    path = iniPath;
+    fileName = std::filesystem::path(iniPath).filename().string();
+    onChange = std::move(cb);
+    stop = false;
+
+    // ARR fecha de partida para no avisar del fichero tal como lo cargamos
+    lastWrite = 0;
+    lastSize = 0;
+    StampChanged();
+
+#ifdef __linux__
+    std::filesystem::path dir = std::filesystem::path(iniPath).parent_path();
+    if (dir.empty()) dir = ".";
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, dir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+
+    std::cout << "Vigilando " << path << (UsingInotify() ? " con inotify\n" : " por fecha\n");
+
+    worker = std::thread([this] { Run(); });
+    return true;
+}
+
+void BBBConfigWatcher::Stop()
+{
+    stop = true;
+    if (worker.joinable()) worker.join();
+
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+    inotifyFd = -1;
+}
+
+void BBBConfigWatcher::Run()
+{
+    while (!stop)
+    {
+        bool touched = false;
+
+#ifdef __linux__
+        if (inotifyFd >= 0)
+        {
+            // ARR timeout corto para poder salir con Stop
+            pollfd pfd{ inotifyFd, POLLIN, 0 };
+            if (poll(&pfd, 1, 250) <= 0) continue;
+
+            alignas(inotify_event) char buf[4096];
+            ssize_t n;
+            while ((n = read(inotifyFd, buf, sizeof(buf))) > 0)
+            {
+                for (char* q = buf; q < buf + n; )
+                {
+                    const inotify_event* ev = (const inotify_event*)q;
+                    if (ev->len > 0 && fileName == ev->name) touched = true;
+                    q += sizeof(inotify_event) + ev->len;
+                }
+            }
+        }
+        else
+#endif
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            touched = true;
+        }
+
+        if (!touched) continue;
+
+        // ARR un guardado puede ser varias escrituras seguidas, esperamos a que acabe
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        if (StampChanged() && onChange) onChange();
+    }
+}
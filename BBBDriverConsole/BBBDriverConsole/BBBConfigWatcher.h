@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+// ARR vigila bbb_config.ini en un hilo y avisa cuando cambia su contenido
+// ARR en Linux con inotify sobre la carpeta, los editores suelen guardar con rename
+// ARR sin inotify miramos fecha y tamano cada medio segundo
+class BBBConfigWatcher
+{
+public:
+    BBBConfigWatcher() = default;
+    ~BBBConfigWatcher();
+
+    BBBConfigWatcher(const BBBConfigWatcher&) = delete;
+    BBBConfigWatcher& operator=(const BBBConfigWatcher&) = delete;
+
+    // onChange se llama desde el hilo del watcher, una vez por guardado
+    bool Start(const std::string& iniPath, std::function<void()> onChange);
+    void Stop();
+
+    bool UsingInotify() const { return inotifyFd >= 0; }
+
+private:
+    void Run();
+
+    // fecha y tamano distintos de lo ultimo visto
+    bool StampChanged();
+
+    std::string path;
+    std::string fileName;
+    std::function<void()> onChange;
+
+    std::thread worker;
+    std::atomic<bool> stop{ false };
+
+    int inotifyFd = -1;
+
+    int64_t lastWrite = 0;
+    uint64_t lastSize = 0;
+};
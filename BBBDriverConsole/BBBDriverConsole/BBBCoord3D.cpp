@@ -0,0 +1,143 @@
+#include "BBBCoord3D.h"
+
+#include "BBBSimd.h"
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace BBB
+{
+    static bool ValidView(const Coord3DView& view, const Coord3DParams& prm)
+    {
+        if (!view.data || view.width <= 0 || view.height <= 0) return false;
+        if (view.channels != 2 && view.channels != 3) return false;
+        if (view.strideBytes < view.width * view.channels * (int)sizeof(float)) return false;
+        if (view.channels == 2 && prm.focal <= 1e-6f) return false;
+        return prm.unitToM > 0.0f;
+    }
+
+    static inline bool PointOk(float X, float Y, float Z, float H, const Coord3DParams& prm, float invM)
+    {
+        bool ok = (X == X) & (Y == Y) & (Z > 0.0f) & (Z >= prm.minZ) & (Z <= prm.maxZ);
+        if (prm.invalidFlag) ok = ok & (Z != invM);
+        if (prm.groundFilter) ok = ok & (H >= prm.groundMinHeightM);
+        return ok;
+    }
+
+    bool Coord3D::Run(const Coord3DView& view, const Coord3DParams& prm, std::vector<Pt>& pts, std::vector<int>& cells)
+    {
+        pts.clear();
+        cells.clear();
+
+        if (!ValidView(view, prm) || prm.step < 1) return false;
+        if (prm.roi.x0 < 0 || prm.roi.y0 < 0 || prm.roi.x1 > view.width || prm.roi.y1 > view.height) return false;
+        if (prm.roi.x1 <= prm.roi.x0 || prm.roi.y1 <= prm.roi.y0) return true;
+
+        const int x0 = prm.roi.x0, x1 = prm.roi.x1;
+        const int y0 = prm.roi.y0, y1 = prm.roi.y1;
+        const int step = prm.step;
+        const int gw = (x1 - x0 + step - 1) / step;
+        const int ch = view.channels;
+        const float s = prm.unitToM;
+        const float invM = prm.invalidValue * s;
+
+        pts.reserve((size_t)gw * ((y1 - y0 + step - 1) / step));
+        cells.reserve(pts.capacity());
+
+        // planos de la fila en metros, el suelo se calcula en bloque como en la disparidad
+        std::vector<float> rowX(gw), rowY(gw), rowZ(gw), rowH(gw, 0.0f);
+
+        for (int y = y0; y < y1; y += step)
+        {
+            const float* src = view.Row(y);
+
+            if (ch == 3)
+            {
+                for (int k = 0, x = x0; k < gw; ++k, x += step)
+                {
+                    const float* px = src + (size_t)x * 3;
+                    rowX[k] = px[0] * s;
+                    rowY[k] = px[1] * s;
+                    rowZ[k] = px[2] * s;
+                }
+            }
+            else
+            {
+                const float Yn = ((float)y - prm.principalV) / prm.focal;
+                for (int k = 0, x = x0; k < gw; ++k, x += step)
+                {
+                    const float* px = src + (size_t)x * 2;
+                    rowX[k] = px[0] * s;
+                    rowZ[k] = px[1] * s;
+                    rowY[k] = Yn * rowZ[k];
+                }
+            }
+
+            if (prm.groundFilter)
+                VisionMath::HeightAboveGroundBatch(rowY.data(), rowZ.data(), gw, prm.camHeightM, prm.pitchDownDeg, rowH.data());
+
+            const int cellRow = ((y - y0) / step) * gw;
+
+            auto Push = [&](int k)
+                {
+                    Pt q;
+                    q.x = rowX[k];
+                    q.y = rowY[k];
+                    q.z = rowZ[k];
+                    q.pix = y * view.width + x0 + k * step;
+                    pts.push_back(q);
+                    cells.push_back(cellRow + k);
+                };
+
+            int k = 0;
+
+#if defined(BBB_SIMD_SSE2)
+            // NaN da falso en las comparaciones ordenadas, no hace falta isfinite aparte
+            const __m128 vZero = _mm_setzero_ps();
+            const __m128 vMin = _mm_set1_ps(prm.minZ);
+            const __m128 vMax = _mm_set1_ps(prm.maxZ);
+            const __m128 vInv = _mm_set1_ps(invM);
+            const __m128 vGnd = _mm_set1_ps(prm.groundMinHeightM);
+
+            for (; k + 4 <= gw; k += 4)
+            {
+                const __m128 X = _mm_loadu_ps(rowX.data() + k);
+                const __m128 Y = _mm_loadu_ps(rowY.data() + k);
+                const __m128 Z = _mm_loadu_ps(rowZ.data() + k);
+
+                __m128 ok = _mm_and_ps(_mm_cmpord_ps(X, Y), _mm_cmpgt_ps(Z, vZero));
+                ok = _mm_and_ps(ok, _mm_and_ps(_mm_cmpge_ps(Z, vMin), _mm_cmple_ps(Z, vMax)));
+                if (prm.invalidFlag) ok = _mm_and_ps(ok, _mm_cmpneq_ps(Z, vInv));
+                if (prm.groundFilter) ok = _mm_and_ps(ok, _mm_cmpge_ps(_mm_loadu_ps(rowH.data() + k), vGnd));
+
+                const int bits = _mm_movemask_ps(ok);
+                if (!bits) continue;
+
+                for (int j = 0; j < 4; ++j)
+                    if (bits & (1 << j)) Push(k + j);
+            }
+#endif
+
+            for (; k < gw; ++k)
+                if (PointOk(rowX[k], rowY[k], rowZ[k], rowH[k], prm, invM)) Push(k);
+        }
+
+        return true;
+    }
+
+    bool Coord3D::DepthAt(const Coord3DView& view, const Coord3DParams& prm, int x, int y, float& zM)
+    {
+        if (!ValidView(view, prm)) return false;
+        if (x < 0 || y < 0 || x >= view.width || y >= view.height) return false;
+
+        const float* px = view.Row(y) + (size_t)x * view.channels;
+        const float z = px[view.channels - 1];
+
+        if (!std::isfinite(z) || z <= 0.0f) return false;
+        if (prm.invalidFlag && z == prm.invalidValue) return false;
+
+        zM = z * prm.unitToM;
+        return true;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BBBDisparity.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // vista del Coord3D que calcula la camara, un float por canal y pixel
+    // ABC trae X Y Z, AC solo X y Z y la Y la sacamos de la fila con la focal
+    struct Coord3DView
+    {
+        const uint8_t* data = nullptr;
+        int width = 0;
+        int height = 0;
+        int strideBytes = 0;
+        int channels = 3;
+
+        const float* Row(int y) const
+        {
+            return (const float*)(data + (size_t)y * strideBytes);
+        }
+    };
+
+    struct Coord3DParams
+    {
+        // pixeles [x0, x1) x [y0, y1) cada step
+        PixelRoi roi;
+        int step = 1;
+
+        // unidades del buffer a metros, Scan3dDistanceUnit
+        float unitToM = 0.001f;
+
+        // solo para AC, Y = (y - principalV) * Z / focal
+        float focal = 0.0f;
+        float principalV = 0.0f;
+
+        // NaN siempre es invalido, invalidValue solo si invalidFlag
+        bool invalidFlag = false;
+        float invalidValue = 0.0f;
+
+        // z aceptada en [minZ, maxZ] metros
+        float minZ = 0.0f;
+        float maxZ = 0.0f;
+
+        // descartamos lo que quede por debajo de groundMinHeightM sobre el suelo
+        bool groundFilter = false;
+        float camHeightM = 0.0f;
+        float pitchDownDeg = 0.0f;
+        float groundMinHeightM = 0.0f;
+    };
+
+    class Coord3D
+    {
+    public:
+        // nube con pix y celda de cada punto, misma salida que Reprojection::Run
+        // cada fila se separa en planos X Y Z en metros y las mascaras de validez, rango y suelo
+        // van en SSE2 de 4 en 4 antes de compactar
+        static bool Run(const Coord3DView& view, const Coord3DParams& prm, std::vector<Pt>& pts, std::vector<int>& cells);
+
+        // z en metros de un pixel, false si no es valida
+        static bool DepthAt(const Coord3DView& view, const Coord3DParams& prm, int x, int y, float& zM);
+    };
+}
@@ -0,0 +1,233 @@
+#include "BBBDemosaic.h"
+
+#include "BBBParallel.h"
+#include "BBBSimd.h"
+
+#include <cstdlib>
+
+namespace BBB
+{
+    // posicion del rojo dentro del 2x2, el azul va en la diagonal opuesta
+    static bool RedOffset(BayerPattern pattern, int& rx, int& ry)
+    {
+        switch (pattern)
+        {
+        case BayerPattern::RG: rx = 0; ry = 0; return true;
+        case BayerPattern::GR: rx = 1; ry = 0; return true;
+        case BayerPattern::GB: rx = 0; ry = 1; return true;
+        case BayerPattern::BG: rx = 1; ry = 1; return true;
+        default: return false;
+        }
+    }
+
+    // reflejo sin repetir el borde, -1 pasa a 1 y n pasa a n - 2, asi conserva la paridad
+    static inline int Reflect(int i, int n)
+    {
+        if (i < 0) return -i;
+        if (i >= n) return 2 * n - 2 - i;
+        return i;
+    }
+
+    static inline int Avg2(int a, int b) { return (a + b + 1) >> 1; }
+    static inline int Avg4(int a, int b, int c, int d) { return (a + b + c + d + 2) >> 2; }
+
+    static inline int GreenAt(int L, int R, int U, int D, bool edgeAware)
+    {
+        if (edgeAware)
+        {
+            const int gh = std::abs(L - R);
+            const int gv = std::abs(U - D);
+            if (gh < gv) return Avg2(L, R);
+            if (gv < gh) return Avg2(U, D);
+        }
+        return Avg4(L, R, U, D);
+    }
+
+    static void SampleAt(const GuideView& bayer, int rx, int ry, bool edgeAware, int x, int y, uint8_t* rgb)
+    {
+        const int w = bayer.width;
+        const int h = bayer.height;
+
+        auto P = [&](int xx, int yy) -> int
+            {
+                return bayer.data[(size_t)Reflect(yy, h) * bayer.strideBytes + Reflect(xx, w)];
+            };
+
+        const int c = P(x, y);
+        const int L = P(x - 1, y), R = P(x + 1, y);
+        const int U = P(x, y - 1), D = P(x, y + 1);
+
+        const int cx = (x ^ rx) & 1;
+        const int cy = (y ^ ry) & 1;
+
+        int r, g, b;
+        if (cx == cy)
+        {
+            const int diag = Avg4(P(x - 1, y - 1), P(x + 1, y - 1), P(x - 1, y + 1), P(x + 1, y + 1));
+            g = GreenAt(L, R, U, D, edgeAware);
+            if (cx == 0) { r = c; b = diag; }
+            else { r = diag; b = c; }
+        }
+        else if (cy == 0)
+        {
+            // verde en fila de rojos
+            r = Avg2(L, R); g = c; b = Avg2(U, D);
+        }
+        else
+        {
+            // verde en fila de azules
+            r = Avg2(U, D); g = c; b = Avg2(L, R);
+        }
+
+        rgb[0] = (uint8_t)r;
+        rgb[1] = (uint8_t)g;
+        rgb[2] = (uint8_t)b;
+    }
+
+    void Demosaic::SampleRGB(
+        const GuideView& bayer,
+        BayerPattern pattern,
+        bool edgeAware,
+        int x,
+        int y,
+        uint8_t& r,
+        uint8_t& g,
+        uint8_t& b)
+    {
+        int rx, ry;
+        if (!bayer.data || bayer.width < 2 || bayer.height < 2 || !RedOffset(pattern, rx, ry))
+        {
+            r = g = b = 0;
+            return;
+        }
+
+        uint8_t rgb[3];
+        SampleAt(bayer, rx, ry, edgeAware, x, y, rgb);
+        r = rgb[0]; g = rgb[1]; b = rgb[2];
+    }
+
+#if defined(BBB_SIMD_SSE2)
+    static inline __m128i Load8(const uint8_t* p)
+    {
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+    }
+
+    static inline __m128i Select(__m128i m, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+    }
+
+    static inline __m128i Abs16(__m128i v)
+    {
+        return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+    }
+
+    // pixeles [x, x + 8) de una fila interior, necesita x >= 1 y x + 8 <= w - 1
+    // siteMask marca los carriles con R o B en el centro
+    static void RowInterior8(const uint8_t* up, const uint8_t* mid, const uint8_t* dn, int x,
+        int cy, __m128i siteMask, bool edgeAware, uint8_t* out)
+    {
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i two = _mm_set1_epi16(2);
+
+        const __m128i C = Load8(mid + x);
+        const __m128i L = Load8(mid + x - 1);
+        const __m128i R = Load8(mid + x + 1);
+        const __m128i U = Load8(up + x);
+        const __m128i D = Load8(dn + x);
+        const __m128i UL = Load8(up + x - 1);
+        const __m128i UR = Load8(up + x + 1);
+        const __m128i DL = Load8(dn + x - 1);
+        const __m128i DR = Load8(dn + x + 1);
+
+        const __m128i H2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(L, R), one), 1);
+        const __m128i V2 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(U, D), one), 1);
+        const __m128i X4 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(L, R), _mm_add_epi16(U, D)), two), 2);
+        const __m128i D4 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(UL, UR), _mm_add_epi16(DL, DR)), two), 2);
+
+        __m128i Gi = X4;
+        if (edgeAware)
+        {
+            const __m128i gh = Abs16(_mm_sub_epi16(L, R));
+            const __m128i gv = Abs16(_mm_sub_epi16(U, D));
+            Gi = Select(_mm_cmplt_epi16(gh, gv), H2, Select(_mm_cmplt_epi16(gv, gh), V2, X4));
+        }
+
+        __m128i r, g, b;
+        g = Select(siteMask, Gi, C);
+        if (cy == 0)
+        {
+            r = Select(siteMask, C, H2);
+            b = Select(siteMask, D4, V2);
+        }
+        else
+        {
+            r = Select(siteMask, D4, V2);
+            b = Select(siteMask, C, H2);
+        }
+
+        // SSE2 no tiene shuffle de bytes, empaquetamos y entrelazamos a mano
+        alignas(16) uint8_t tr[16], tg[16], tb[16];
+        _mm_store_si128((__m128i*)tr, _mm_packus_epi16(r, r));
+        _mm_store_si128((__m128i*)tg, _mm_packus_epi16(g, g));
+        _mm_store_si128((__m128i*)tb, _mm_packus_epi16(b, b));
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[i * 3 + 0] = tr[i];
+            out[i * 3 + 1] = tg[i];
+            out[i * 3 + 2] = tb[i];
+        }
+    }
+#endif
+
+    bool Demosaic::ToRGB(
+        const GuideView& bayer,
+        BayerPattern pattern,
+        bool edgeAware,
+        std::vector<uint8_t>& rgb)
+    {
+        int rx, ry;
+        if (!bayer.data || bayer.bpp != 8 || bayer.width < 2 || bayer.height < 2) return false;
+        if (!RedOffset(pattern, rx, ry)) return false;
+
+        const int w = bayer.width;
+        const int h = bayer.height;
+        rgb.resize((size_t)w * h * 3);
+
+        Parallel::For(0, h, 16, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    uint8_t* out = rgb.data() + (size_t)y * w * 3;
+                    int x = 0;
+
+#if defined(BBB_SIMD_SSE2)
+                    if (y >= 1 && y + 1 < h && w >= 10)
+                    {
+                        SampleAt(bayer, rx, ry, edgeAware, 0, y, out);
+                        x = 1;
+
+                        // desde x = 1 de 8 en 8 la paridad de cada carril no cambia
+                        const int cy = (y ^ ry) & 1;
+                        const __m128i odd = _mm_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+                        const __m128i cxOne = ((1 ^ rx) & 1) ? _mm_xor_si128(odd, _mm_set1_epi16(-1)) : odd;
+                        const __m128i siteMask = cy == 1 ? cxOne : _mm_xor_si128(cxOne, _mm_set1_epi16(-1));
+
+                        const uint8_t* mid = bayer.data + (size_t)y * bayer.strideBytes;
+                        const uint8_t* up = mid - bayer.strideBytes;
+                        const uint8_t* dn = mid + bayer.strideBytes;
+
+                        for (; x + 8 <= w - 1; x += 8)
+                            RowInterior8(up, mid, dn, x, cy, siteMask, edgeAware, out + (size_t)x * 3);
+                    }
+#endif
+
+                    for (; x < w; ++x)
+                        SampleAt(bayer, rx, ry, edgeAware, x, y, out + (size_t)x * 3);
+                }
+            });
+
+        return true;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BBBGuidedFill.h"
+
+namespace BBB
+{
+    // color del pixel (0, 0) del mosaico, el resto sigue el patron 2x2
+    enum class BayerPattern
+    {
+        None,
+        RG,
+        GB,
+        GR,
+        BG
+    };
+
+    class Demosaic
+    {
+    public:
+        // RGB en un pixel del mosaico sin demosaicar la imagen entera, para colorear la nube
+        // bilineal, con edgeAware el verde en R y B se interpola a lo largo del borde
+        // en los bordes de la imagen reflejamos respetando la paridad del patron
+        static void SampleRGB(
+            const GuideView& bayer,
+            BayerPattern pattern,
+            bool edgeAware,
+            int x,
+            int y,
+            uint8_t& r,
+            uint8_t& g,
+            uint8_t& b
+        );
+
+        // imagen entera a RGB24 empaquetado R G B, para exportar PNG o usar como guia
+        // interior en SSE2 de 8 en 8 pixeles y bordes por SampleRGB, repartido por filas
+        // da exactamente lo mismo que SampleRGB en cada pixel
+        static bool ToRGB(
+            const GuideView& bayer,
+            BayerPattern pattern,
+            bool edgeAware,
+            std::vector<uint8_t>& rgb
+        );
+    };
+}
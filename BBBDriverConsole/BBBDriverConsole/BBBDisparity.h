@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// TELEDYNE parametros Scan3D que leemos de los nodos oficiales
+struct Scan3DParams
+{
+    float scale = 1.0f;
+    float offset = 0.0f;
+    float focal = 0.0f;
+    float baseline = 0.0f;
+    float principalU = 0.0f;
+    float principalV = 0.0f;
+    bool invalidFlag = false;
+    float invalidValue = 0.0f;
+
+    // unidad de las coordenadas Coord3D en metros, Scan3dDistanceUnit
+    float distanceUnitM = 0.001f;
+};
+
+namespace BBB
+{
+    // vista de la disparidad cruda sin depender del SDK
+    // sirve igual para la imagen de la camara que para un buffer nuestro
+    struct DisparityView
+    {
+        const uint8_t* data = nullptr;
+        int width = 0;
+        int height = 0;
+        int strideBytes = 0;
+        int bpp = 16;
+
+        uint16_t RawAt(int x, int y) const
+        {
+            if (bpp <= 8) return (uint16_t)data[y * strideBytes + x];
+            return ((const uint16_t*)(data + y * strideBytes))[x];
+        }
+    };
+
+    // rectangulo [x0, x1) x [y0, y1) en pixeles
+    struct PixelRoi
+    {
+        int x0 = 0, x1 = 0;
+        int y0 = 0, y1 = 0;
+    };
+}
@@ -1,4 +1,16 @@
 #include "BBBDriver.h"
+#include "BBBColorize.h"
+#include "BBBCoord3D.h"
+#include "BBBDemosaic.h"
+#include "BBBImageIO.h"
+#include "BBBKdTree.h"
+#include "BBBMeasurement.h"
+#include "BBBOctreeLod.h"
+#include "BBBPlaneSegmentation.h"
+#include "BBBProfiler.h"
+#include "BBBReprojection.h"
+#include "BBBStereoMatcher.h"
+#include "BBBVisionMath.h"
 
 #include <iostream>
 #include <vector>
@@ -6,303 +18,14 @@
 #include <cmath>
 #include <limits>
 #include <fstream>
-#include <unordered_map>
-#include <queue>
+#include <chrono>
 
 using namespace Spinnaker;
 using namespace Spinnaker::GenApi;
 
-// ARR helpers matematicos y color
-static float Clamp01(float v)
-{
-    if (v < 0.0f) return 0.0f;
-    if (v > 1.0f) return 1.0f;
-    return v;
-}
-static float DegToRad(float deg)
-{
-    return deg * 3.14159265358979323846f / 180.0f;
-}
-
-// ARR sistema camara X derecha Y abajo Z delante
-static float HeightAboveGroundM(float Xc, float Yc, float Zc, float camHeightM, float pitchDownDeg)
-{
-    float yUp = -Yc;
-
-    float p = DegToRad(pitchDownDeg);
-    float cp = std::cos(p);
-    float sp = std::sin(p);
-
-    float yUpWorld = cp * yUp - sp * Zc;
-    return camHeightM + yUpWorld;
-}
-
-static void HsvToRgb(float hDeg, float s, float v, uint8_t& r, uint8_t& g, uint8_t& b)
-{
-    hDeg = std::fmod(hDeg, 360.0f);
-    if (hDeg < 0.0f) hDeg += 360.0f;
-
-    float c = v * s;
-    float x = c * (1.0f - std::fabs(std::fmod(hDeg / 60.0f, 2.0f) - 1.0f));
-    float m = v - c;
-
-    float rp = 0, gp = 0, bp = 0;
-
-    if (hDeg < 60.0f) { rp = c; gp = x; bp = 0; }
-    else if (hDeg < 120.0f) { rp = x; gp = c; bp = 0; }
-    else if (hDeg < 180.0f) { rp = 0; gp = c; bp = x; }
-    else if (hDeg < 240.0f) { rp = 0; gp = x; bp = c; }
-    else if (hDeg < 300.0f) { rp = x; gp = 0; bp = c; }
-    else { rp = c; gp = 0; bp = x; }
-
-    int R = (int)std::lround((rp + m) * 255.0f);
-    int G = (int)std::lround((gp + m) * 255.0f);
-    int B = (int)std::lround((bp + m) * 255.0f);
-
-    r = (uint8_t)std::clamp(R, 0, 255);
-    g = (uint8_t)std::clamp(G, 0, 255);
-    b = (uint8_t)std::clamp(B, 0, 255);
-}
-
-static void DepthToHeatRGB(float z, float zMin, float zMax, uint8_t& r, uint8_t& g, uint8_t& b)
-{
-    float denom = (zMax - zMin);
-    if (denom < 1e-6f) denom = 1.0f;
-
-    float t = (z - zMin) / denom;
-    t = Clamp01(t);
-
-    float hue = (1.0f - t) * 240.0f;
-    HsvToRgb(hue, 1.0f, 1.0f, r, g, b);
-}
-
-// ARR percentil robusto
-static float Percentile(std::vector<float>& v, float q)
-{
-    if (v.empty()) return std::numeric_limits<float>::quiet_NaN();
-    std::sort(v.begin(), v.end());
-    float idx = q * (v.size() - 1);
-    size_t i0 = (size_t)idx;
-    size_t i1 = (std::min)(i0 + 1, v.size() - 1);
-    float t = idx - (float)i0;
-    return v[i0] * (1.f - t) + v[i1] * t;
-}
-
-struct Pt
-{
-    float x, y, z;
-    uint8_t r, g, b;
-};
-
-struct Key3
-{
-    int x, y, z;
-    bool operator==(const Key3& o) const { return x == o.x && y == o.y && z == o.z; }
-};
-
-struct Key3Hash
-{
-    size_t operator()(const Key3& k) const
-    {
-        size_t h1 = std::hash<int>()(k.x);
-        size_t h2 = std::hash<int>()(k.y);
-        size_t h3 = std::hash<int>()(k.z);
-        return h1 ^ (h2 * 0x9e3779b1u) ^ (h3 * 0x85ebca6bu);
-    }
-};
-
-static Key3 CellKey(float x, float y, float z, float cell)
-{
-    return Key3{ (int)std::floor(x / cell), (int)std::floor(y / cell), (int)std::floor(z / cell) };
-}
-
-// ARR voxel sencillo
-static std::vector<Pt> VoxelDownsample(const std::vector<Pt>& in, float leaf)
-{
-    if (leaf <= 1e-6f) return in;
-
-    struct Acc { double sx = 0, sy = 0, sz = 0, sr = 0, sg = 0, sb = 0; int n = 0; };
-    std::unordered_map<Key3, Acc, Key3Hash> m;
-    m.reserve(in.size());
-
-    for (const auto& p : in)
-    {
-        Key3 k = CellKey(p.x, p.y, p.z, leaf);
-        auto& a = m[k];
-        a.sx += p.x; a.sy += p.y; a.sz += p.z;
-        a.sr += p.r; a.sg += p.g; a.sb += p.b;
-        a.n += 1;
-    }
-
-    std::vector<Pt> out;
-    out.reserve(m.size());
-
-    for (auto& it : m)
-    {
-        const Acc& a = it.second;
-        if (a.n <= 0) continue;
-
-        Pt p;
-        p.x = (float)(a.sx / a.n);
-        p.y = (float)(a.sy / a.n);
-        p.z = (float)(a.sz / a.n);
-        p.r = (uint8_t)std::clamp((int)std::lround(a.sr / a.n), 0, 255);
-        p.g = (uint8_t)std::clamp((int)std::lround(a.sg / a.n), 0, 255);
-        p.b = (uint8_t)std::clamp((int)std::lround(a.sb / a.n), 0, 255);
-
-        out.push_back(p);
-    }
-
-    return out;
-}
-
-// ARR outlier por radio con grid
-static std::vector<Pt> RadiusOutlierRemoval(const std::vector<Pt>& in, float radius, int minNeighbors)
-{
-    if (in.empty()) return in;
-    if (radius <= 1e-6f) return in;
-    if (minNeighbors <= 1) return in;
-
-    const float cell = radius;
-    const float r2 = radius * radius;
-
-    std::unordered_map<Key3, std::vector<int>, Key3Hash> grid;
-    grid.reserve(in.size());
-
-    for (int i = 0; i < (int)in.size(); ++i)
-    {
-        Key3 k = CellKey(in[i].x, in[i].y, in[i].z, cell);
-        grid[k].push_back(i);
-    }
-
-    std::vector<Pt> out;
-    out.reserve(in.size());
-
-    for (int i = 0; i < (int)in.size(); ++i)
-    {
-        const Pt& p = in[i];
-        Key3 ck = CellKey(p.x, p.y, p.z, cell);
-
-        int neighbors = 0;
-
-        for (int dz = -1; dz <= 1; ++dz)
-            for (int dy = -1; dy <= 1; ++dy)
-                for (int dx = -1; dx <= 1; ++dx)
-                {
-                    Key3 nk{ ck.x + dx, ck.y + dy, ck.z + dz };
-                    auto it = grid.find(nk);
-                    if (it == grid.end()) continue;
-
-                    for (int j : it->second)
-                    {
-                        if (j == i) continue;
-                        const Pt& q = in[j];
-
-                        float dx2 = p.x - q.x;
-                        float dy2 = p.y - q.y;
-                        float dz2 = p.z - q.z;
-                        float d2 = dx2 * dx2 + dy2 * dy2 + dz2 * dz2;
-
-                        if (d2 <= r2)
-                        {
-                            neighbors++;
-                            if (neighbors >= minNeighbors) break;
-                        }
-                    }
-
-                    if (neighbors >= minNeighbors) break;
-                }
-
-        if (neighbors >= minNeighbors) out.push_back(p);
-    }
-
-    return out;
-}
-
-// ARR cluster mayor con grid BFS
-static std::vector<Pt> KeepLargestCluster(const std::vector<Pt>& in, float cellSize)
-{
-    if (in.empty()) return in;
-    if (cellSize <= 1e-6f) return in;
-
-    std::unordered_map<Key3, std::vector<int>, Key3Hash> cells;
-    cells.reserve(in.size());
-
-    for (int i = 0; i < (int)in.size(); ++i)
-    {
-        Key3 k = CellKey(in[i].x, in[i].y, in[i].z, cellSize);
-        cells[k].push_back(i);
-    }
-
-    std::unordered_map<Key3, int, Key3Hash> visited;
-    visited.reserve(cells.size());
-
-    int bestCount = -1;
-    std::vector<Key3> bestKeys;
-
-    std::queue<Key3> q;
-
-    for (auto& it : cells)
-    {
-        const Key3 start = it.first;
-        if (visited.find(start) != visited.end()) continue;
-
-        std::vector<Key3> compKeys;
-        int compCount = 0;
-
-        visited[start] = 1;
-        q.push(start);
-
-        while (!q.empty())
-        {
-            Key3 cur = q.front();
-            q.pop();
-
-            auto itc = cells.find(cur);
-            if (itc == cells.end()) continue;
-
-            compKeys.push_back(cur);
-            compCount += (int)itc->second.size();
-
-            for (int dz = -1; dz <= 1; ++dz)
-                for (int dy = -1; dy <= 1; ++dy)
-                    for (int dx = -1; dx <= 1; ++dx)
-                    {
-                        if (dx == 0 && dy == 0 && dz == 0) continue;
-
-                        Key3 nb{ cur.x + dx, cur.y + dy, cur.z + dz };
-                        if (cells.find(nb) == cells.end()) continue;
-                        if (visited.find(nb) != visited.end()) continue;
-
-                        visited[nb] = 1;
-                        q.push(nb);
-                    }
-        }
-
-        if (compCount > bestCount)
-        {
-            bestCount = compCount;
-            bestKeys.swap(compKeys);
-        }
-    }
-
-    if (bestCount <= 0) return in;
-
-    std::unordered_map<Key3, int, Key3Hash> keep;
-    keep.reserve(bestKeys.size());
-    for (const auto& k : bestKeys) keep[k] = 1;
-
-    std::vector<Pt> out;
-    out.reserve(bestCount);
-
-    for (auto& it : cells)
-    {
-        if (keep.find(it.first) == keep.end()) continue;
-        for (int idx : it.second) out.push_back(in[idx]);
-    }
-
-    return out;
-}
+// ARR los helpers de geometria y los filtros de nube viven en VisionMath y CloudFilters
+using BBB::Pt;
+using BBB::VisionMath;
 
 BBBDriver::~BBBDriver()
 {
@@ -314,6 +37,8 @@ BBBDriver::BBBDriver(BBBDriver&& other) noexcept
 {
     acquiring = other.acquiring;
     cam = other.cam;
+    cameraFilterCaps = other.cameraFilterCaps;
+    cameraFilterPlan = other.cameraFilterPlan;
 
     other.acquiring = false;
     other.cam = nullptr;
@@ -327,6 +52,8 @@ BBBDriver& BBBDriver::operator=(BBBDriver&& other) noexcept
 
     acquiring = other.acquiring;
     cam = other.cam;
+    cameraFilterCaps = other.cameraFilterCaps;
+    cameraFilterPlan = other.cameraFilterPlan;
 
     other.acquiring = false;
     other.cam = nullptr;
@@ -400,6 +127,21 @@ static bool IsRectifiedPF(Spinnaker::PixelFormatEnums pf)
     }
 }
 
+// ARR patron del mosaico si la rectificada llega en Bayer, None si ya es mono o RGB
+static BBB::BayerPattern BayerPatternOf(Spinnaker::PixelFormatEnums pf)
+{
+    using namespace Spinnaker;
+
+    switch (pf)
+    {
+    case PixelFormat_BayerRG8: return BBB::BayerPattern::RG;
+    case PixelFormat_BayerGB8: return BBB::BayerPattern::GB;
+    case PixelFormat_BayerGR8: return BBB::BayerPattern::GR;
+    case PixelFormat_BayerBG8: return BBB::BayerPattern::BG;
+    default: return BBB::BayerPattern::None;
+    }
+}
+
 static bool IsDisparityPF(Spinnaker::PixelFormatEnums pf)
 {
     using namespace Spinnaker;
@@ -420,6 +162,13 @@ static bool IsDisparityPF(Spinnaker::PixelFormatEnums pf)
     }
 }
 
+// ARR Coord3D trae xyz en float, no se puede leer como disparidad de 16 bits
+static bool IsCoord3DPF(Spinnaker::PixelFormatEnums pf)
+{
+    using namespace Spinnaker;
+    return pf == PixelFormat_Coord3D_ABC32f || pf == PixelFormat_Coord3D_AC32f;
+}
+
 static void DumpSetInfo(const Spinnaker::ImageList& set, const char* tag)
 {
     std::cout << tag << " set size " << set.GetSize() << "\n";
@@ -499,6 +248,95 @@ static Spinnaker::ImagePtr FindDisparity(const Spinnaker::ImageList& set)
     return ImagePtr();
 }
 
+// ARR vista de la disparidad para los modulos que no dependen del SDK
+static BBB::DisparityView MakeDisparityView(const ImagePtr& disp)
+{
+    BBB::DisparityView v;
+    v.data = (const uint8_t*)disp->GetData();
+    v.width = (int)disp->GetWidth();
+    v.height = (int)disp->GetHeight();
+    v.strideBytes = (int)disp->GetStride();
+    v.bpp = (int)disp->GetBitsPerPixel();
+    return v;
+}
+
+static BBB::Coord3DView MakeCoord3DView(const ImagePtr& img)
+{
+    BBB::Coord3DView v;
+    v.data = (const uint8_t*)img->GetData();
+    v.width = (int)img->GetWidth();
+    v.height = (int)img->GetHeight();
+    v.strideBytes = (int)img->GetStride();
+    v.channels = img->GetPixelFormat() == Spinnaker::PixelFormat_Coord3D_ABC32f ? 3 : 2;
+    return v;
+}
+
+BBB::Coord3DParams BBBDriver::Coord3DParamsFor(const BBBParams& p, const BBBCameraMount& mount, const Scan3DParams& s3d, int w, int h, int step)
+{
+    BBB::Coord3DParams cp;
+    ClampRoiXY(p, w, h, cp.roi.x0, cp.roi.x1, cp.roi.y0, cp.roi.y1);
+    cp.step = (std::max)(1, step);
+    cp.unitToM = s3d.distanceUnitM;
+    cp.focal = s3d.focal;
+    cp.principalV = s3d.principalV;
+    cp.invalidFlag = s3d.invalidFlag;
+    cp.invalidValue = s3d.invalidValue;
+    cp.minZ = p.minRangeM;
+    cp.maxZ = std::min(p.maxRangeM, p.hardMaxZM);
+    cp.groundFilter = p.enableGroundPlaneFilter;
+    cp.camHeightM = mount.alturaCamaraM;
+    cp.pitchDownDeg = mount.pitchDeg;
+    cp.groundMinHeightM = p.groundMinHeightM;
+    return cp;
+}
+
+// Aplicamos speckle del SDK sobre disparity
+static void ApplySdkSpeckle(const ImagePtr& disp, const Scan3DParams& s3d, const BBBParams& p)
+{
+    if (!p.applySpeckleFilter) return;
+
+    try
+    {
+        ImageUtilityStereo::FilterSpecklesFromImage(
+            disp,
+            p.maxSpeckleSize,
+            p.speckleThreshold,
+            s3d.scale,
+            s3d.invalidValue
+        );
+    }
+    catch (...) {}
+}
+
+BBB::DisparityView BBBDriver::SpeckleFilteredView(const ImagePtr& disp, const Scan3DParams& s3d, const BBBParams& p)
+{
+    BBB::DisparityView view = MakeDisparityView(disp);
+
+    // ARR si la camara ya quito los speckles no repetimos en el host
+    if (!p.applySpeckleFilter || cameraFilterPlan.speckleOnCamera) return view;
+
+    BBB::ScopedStage stage(BBB::Stage::Speckle);
+
+    if (!p.ownSpeckleFilter)
+    {
+        ApplySdkSpeckle(disp, s3d, p);
+        return view;
+    }
+
+    BBB::PixelRoi roi;
+    ClampRoiXY(p, view.width, view.height, roi.x0, roi.x1, roi.y0, roi.y1);
+
+    // ARR si el formato no es de 8 o 16 bits seguimos con el del SDK
+    if (!BBB::SpeckleFilter::Apply(view, roi, p.speckleMarginPx, p.maxSpeckleSize, p.speckleThreshold,
+        s3d.scale, (uint16_t)s3d.invalidValue, speckleBuf))
+    {
+        ApplySdkSpeckle(disp, s3d, p);
+        return view;
+    }
+
+    return speckleBuf.View();
+}
+
 bool BBBDriver::ValidateSetHasRectDisp(const Spinnaker::ImageList& set)
 {
     Spinnaker::ImagePtr disp = FindDisparity(set);
@@ -587,6 +425,7 @@ bool BBBDriver::OpenBySerial(CameraList& cams, const std::string& serial)
 
         cam = c;
         acquiring = false;
+        ProbeCameraFilters();
         return true;
     }
 
@@ -622,6 +461,7 @@ bool BBBDriver::OpenFirstStereoSkip(CameraList& cams, const std::string& serialT
         {
             cam = c;
             acquiring = false;
+            ProbeCameraFilters();
             return true;
         }
 
@@ -643,6 +483,8 @@ void BBBDriver::Close
             // TELEDYNE DeInit oficial
             cam->DeInit();
             cam = nullptr;
+            cameraFilterCaps = BBB::CameraFilterCaps{};
+            cameraFilterPlan = BBB::CameraFilterPlan{};
         }
     }
     catch (...) {}
@@ -667,8 +509,83 @@ bool BBBDriver::DisableGVCPHeartbeat(bool disable)
     return false;
 }
 
+// TELEDYNE nodos GenApi detras del acceso de CameraFilters
+class GenApiNodeAccess : public BBB::NodeAccess
+{
+public:
+    explicit GenApiNodeAccess(INodeMap& nodeMap) : nodeMap(nodeMap) {}
+
+    bool Writable(const char* name) const override
+    {
+        try { return IsWritable(nodeMap.GetNode(name)); }
+        catch (...) { return false; }
+    }
+
+    bool SetBool(const char* name, bool value) override
+    {
+        try
+        {
+            CBooleanPtr node = nodeMap.GetNode(name);
+            if (!IsWritable(node)) return false;
+            node->SetValue(value);
+            return true;
+        }
+        catch (...) { return false; }
+    }
+
+    bool SetNumber(const char* name, double value) override
+    {
+        try
+        {
+            CFloatPtr f = nodeMap.GetNode(name);
+            if (IsWritable(f))
+            {
+                f->SetValue(std::clamp(value, f->GetMin(), f->GetMax()));
+                return true;
+            }
+
+            CIntegerPtr i = nodeMap.GetNode(name);
+            if (IsWritable(i))
+            {
+                i->SetValue(std::clamp((int64_t)std::llround(value), i->GetMin(), i->GetMax()));
+                return true;
+            }
+        }
+        catch (...) {}
+        return false;
+    }
+
+private:
+    INodeMap& nodeMap;
+};
+
+void BBBDriver::ProbeCameraFilters()
+{
+    cameraFilterCaps = BBB::CameraFilterCaps{};
+    cameraFilterPlan = BBB::CameraFilterPlan{};
+    if (!cam) return;
+
+    GenApiNodeAccess nodes(cam->GetNodeMap());
+    cameraFilterCaps = BBB::CameraFilters::Probe(nodes);
+
+    std::cout << "Filtros en camara speckle " << (cameraFilterCaps.HasSpeckle() ? cameraFilterCaps.speckleEnable : "no")
+        << " mediana " << (cameraFilterCaps.HasMedian() ? cameraFilterCaps.medianEnable : "no") << "\n";
+}
+
+void BBBDriver::ConfigureCameraFilters(const BBBParams& p)
+{
+    cameraFilterPlan = BBB::CameraFilterPlan{};
+    if (!cam) return;
+
+    GenApiNodeAccess nodes(cam->GetNodeMap());
+    cameraFilterPlan = BBB::CameraFilters::Configure(nodes, cameraFilterCaps, p);
+
+    std::cout << "Speckle en " << (cameraFilterPlan.speckleOnCamera ? "camara" : "host")
+        << " mediana en " << (cameraFilterPlan.medianOnCamera ? "camara" : "host") << "\n";
+}
+
 // TELEDYNE configuramos componentes oficiales Rectified y Disparity
-bool BBBDriver::ConfigureStreams_Rectified1_Disparity()
+bool BBBDriver::ConfigureStreams_Rectified1_Disparity(bool streamBayer, bool streamCoord3D)
 {
     if (!cam) return false;
 
@@ -715,14 +632,42 @@ bool BBBDriver::ConfigureStreams_Rectified1_Disparity()
 
     // ARR intentamos sacar Rectified en color real para colorear el PLY con la escena
     // ARR si la camara no soporta color en Rectified, nos quedamos con el formato que tenga
+    // ARR en Bayer va un tercio del ancho de banda de RGB y demosaicamos en el host
     const char* pfTry[] = { "RGB8Packed", "RGB8", "BGR8Packed", "BGR8", "Mono8" };
-    if (!TrySetEnumAny(nodeMap, "PixelFormat", pfTry, 5))
+    const char* pfTryBayer[] = { "BayerRG8", "BayerGB8", "BayerGR8", "BayerBG8", "RGB8Packed", "RGB8", "Mono8" };
+
+    bool pfOk = streamBayer
+        ? TrySetEnumAny(nodeMap, "PixelFormat", pfTryBayer, 7)
+        : TrySetEnumAny(nodeMap, "PixelFormat", pfTry, 5);
+
+    if (!pfOk)
         std::cout << "PixelFormat en Rectified no se pudo fijar\n";
 
     const char* dispNames[] = { "Disparity" };
     if (!TrySetEnumAny(nodeMap, "ComponentSelector", dispNames, 1)) return false;
     compEnable->SetValue(true);
 
+    // ARR con Coord3D la camara reproyecta y el host se ahorra ese bucle
+    // ARR si el componente no acepta ningun formato 3D seguimos en disparidad
+    if (streamCoord3D)
+    {
+        const char* modes[] = { "CalibratedABC_Grid", "CalibratedAC" };
+        const char* formats[] = { "Coord3D_ABC32f", "Coord3D_AC32f" };
+
+        bool c3dOk = false;
+        for (int i = 0; i < 2 && !c3dOk; ++i)
+        {
+            SetEnumAsString(nodeMap, "Scan3dOutputMode", modes[i]);
+            c3dOk = SetEnumAsString(nodeMap, "PixelFormat", formats[i]);
+        }
+
+        if (!c3dOk)
+        {
+            SetEnumAsString(nodeMap, "Scan3dOutputMode", "DisparityC");
+            std::cout << "Coord3D no soportado en este modelo, seguimos con disparidad\n";
+        }
+    }
+
     return true;
 }
 
@@ -773,6 +718,25 @@ bool BBBDriver::ConfigureStreamBuffersNewestOnly()
     return false;
 }
 
+bool BBBDriver::ConfigureStreamBufferCount(int count)
+{
+    if (!cam || count <= 0) return false;
+
+    try
+    {
+        INodeMap& tl = cam->GetTLStreamNodeMap();
+        if (!SetEnumAsString(tl, "StreamBufferCountMode", "Manual")) return false;
+
+        CIntegerPtr n = tl.GetNode("StreamBufferCountManual");
+        if (!IsWritable(n)) return false;
+
+        n->SetValue(std::clamp((int64_t)count, n->GetMin(), n->GetMax()));
+        return true;
+    }
+    catch (...) {}
+    return false;
+}
+
 // TELEDYNE Scan3D params con nodos oficiales
 bool BBBDriver::ReadScan3DParams(Scan3DParams& out)
 {
@@ -789,6 +753,20 @@ bool BBBDriver::ReadScan3DParams(Scan3DParams& out)
     if (!GetBoolNode(nodeMap, "Scan3dInvalidDataFlag", out.invalidFlag)) return false;
     if (!GetFloatNode(nodeMap, "Scan3dInvalidDataValue", out.invalidValue)) return false;
 
+    // ARR la unidad solo importa con Coord3D y no todos los modelos la exponen, si falta dejamos mm
+    try
+    {
+        CEnumerationPtr unit = nodeMap.GetNode("Scan3dDistanceUnit");
+        if (IsReadable(unit))
+        {
+            std::string u = unit->GetCurrentEntry()->GetSymbolic().c_str();
+            if (u == "Millimeter") out.distanceUnitM = 0.001f;
+            else if (u == "Meter") out.distanceUnitM = 1.0f;
+            else if (u == "Inch") out.distanceUnitM = 0.0254f;
+        }
+    }
+    catch (...) {}
+
     return true;
 }
 
@@ -827,6 +805,8 @@ bool BBBDriver::CaptureOnceSync(ImageList& outSet, uint64_t timeoutMs)
     if (!cam) return false;
     if (!StartAcquisition()) return false;
 
+    BBB::ScopedStage stage(BBB::Stage::Capture);
+
     try
     {
         INodeMap& nodeMap = cam->GetNodeMap();
@@ -893,13 +873,46 @@ static bool SavePGM16_BE(const ImagePtr& img, const std::string& filePath)
     return true;
 }
 
-bool BBBDriver::SaveDisparityPGM(const ImageList& set, const std::string& filePath)
+bool BBBDriver::SaveDisparityPGM(const ImageList& set, const std::string& filePath, const Scan3DParams& s3d)
 {
     ImagePtr disp = FindDisparity(set);
     if (!disp) return false;
     if (disp->IsIncomplete()) return false;
     if (!disp->GetData()) return false;
 
+    BBB::ScopedStage stage(BBB::Stage::WritePGM);
+
+    // ARR con Coord3D guardamos la Z en mm en 16 bits, 0 donde no hay dato
+    if (IsCoord3DPF(disp->GetPixelFormat()))
+    {
+        const BBB::Coord3DView v = MakeCoord3DView(disp);
+
+        BBB::Coord3DParams cp;
+        cp.unitToM = s3d.distanceUnitM;
+        cp.invalidFlag = s3d.invalidFlag;
+        cp.invalidValue = s3d.invalidValue;
+
+        BBB::DisparityBuffer zmm;
+        zmm.width = v.width;
+        zmm.height = v.height;
+        zmm.bpp = 16;
+        zmm.strideBytes = v.width * 2;
+        zmm.bytes.assign((size_t)zmm.strideBytes * v.height, 0);
+
+        uint16_t* out = (uint16_t*)zmm.bytes.data();
+        for (int y = 0; y < v.height; ++y)
+        {
+            for (int x = 0; x < v.width; ++x)
+            {
+                float zM;
+                if (!BBB::Coord3D::DepthAt(v, cp, x, y, zM)) continue;
+                out[(size_t)y * v.width + x] = (uint16_t)std::min(65535.0f, zM * 1000.0f + 0.5f);
+            }
+        }
+
+        return BBB::ImageIO::SavePGM16_BE(zmm, filePath);
+    }
+
     try
     {
         const unsigned int bpp = disp->GetBitsPerPixel();
@@ -910,13 +923,34 @@ bool BBBDriver::SaveDisparityPGM(const ImageList& set, const std::string& filePa
 }
 
 // TELEDYNE ImagePtr Save es oficial
-bool BBBDriver::SaveRectifiedPNG(const ImageList& set, const std::string& filePath)
+bool BBBDriver::SaveRectifiedPNG(const ImageList& set, const std::string& filePath, bool edgeAware)
 {
     ImagePtr rect = FindRectified(set);
     if (!rect || rect->IsIncomplete()) return false;
 
+    BBB::ScopedStage stage(BBB::Stage::WritePNG);
+
     try
     {
+        // ARR en Bayer demosaicamos nosotros la imagen entera y guardamos el PNG en RGB
+        BBB::BayerPattern pattern = BayerPatternOf(rect->GetPixelFormat());
+        if (pattern != BBB::BayerPattern::None && rect->GetData())
+        {
+            BBB::GuideView bayer;
+            bayer.data = (const uint8_t*)rect->GetData();
+            bayer.width = (int)rect->GetWidth();
+            bayer.height = (int)rect->GetHeight();
+            bayer.strideBytes = (int)rect->GetStride();
+            bayer.bpp = 8;
+
+            if (!BBB::Demosaic::ToRGB(bayer, pattern, edgeAware, demosaicBuf)) return false;
+
+            ImagePtr rgb = Image::Create(rect->GetWidth(), rect->GetHeight(), 0, 0,
+                PixelFormat_RGB8Packed, demosaicBuf.data());
+            rgb->Save(filePath.c_str());
+            return true;
+        }
+
         rect->Save(filePath.c_str());
         return true;
     }
@@ -927,13 +961,17 @@ bool BBBDriver::SaveRectifiedPNG(const ImageList& set, const std::string& filePa
 // ARR aqui irian SavePointCloudPLY_Filtered GetDistanceCentralPointM GetDistanceToBultoM_Debug SetExposureUs SetGainDb
 
 
-bool BBBDriver::SavePointCloudPLY_Filtered(
+bool BBBDriver::BuildPointCloud_Filtered(
     const ImageList& set,
     const Scan3DParams& s3d,
     const BBBParams& p,
     const BBBCameraMount& mount,
-    const std::string& filePath)
+    std::vector<Pt>& pts,
+    float& zFront)
 {
+    pts.clear();
+    zFront = std::numeric_limits<float>::quiet_NaN();
+
     ImagePtr disp = FindDisparity(set);
     ImagePtr rect = FindRectified(set);
 
@@ -942,183 +980,172 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
     const int w = (int)disp->GetWidth();
     const int h = (int)disp->GetHeight();
 
+    // ARR con Coord3D la camara ya reproyecto, sin speckle ni relleno que son sobre disparidad
+    const bool coord3D = IsCoord3DPF(disp->GetPixelFormat());
+
     float baselineM = BaselineToMeters(s3d.baseline);
     const float focal = s3d.focal;
-    if (focal <= 1e-6f || baselineM <= 1e-9f) return false;
+    if (!coord3D && (focal <= 1e-6f || baselineM <= 1e-9f)) return false;
 
-    // Aplicamos speckle del SDK sobre disparity
-    if (p.applySpeckleFilter)
-    {
-        try
-        {
-            ImageUtilityStereo::FilterSpecklesFromImage(
-                disp,
-                p.maxSpeckleSize,
-                p.speckleThreshold,
-                s3d.scale,
-                s3d.invalidValue
-            );
-        }
-        catch (...) {}
-    }
+    BBB::DisparityView view;
+    if (!coord3D) view = SpeckleFilteredView(disp, s3d, p);
+
+    const bool guided = p.enableGuidedFill && !coord3D;
 
     const uint8_t* rectData = nullptr;
     int rectStride = 0;
     unsigned int rectBpp = 0;
+    BBB::BayerPattern bayerPattern = BBB::BayerPattern::None;
 
     if (rect && !rect->IsIncomplete() && rect->GetData())
     {
         rectData = (const uint8_t*)rect->GetData();
         rectStride = (int)rect->GetStride();
         rectBpp = rect->GetBitsPerPixel();
+        bayerPattern = BayerPatternOf(rect->GetPixelFormat());
     }
 
-    const unsigned int bpp = disp->GetBitsPerPixel();
-    const int step = (std::max)(1, p.decimationFactor);
+    BBB::GuideView bayerView;
+    if (bayerPattern != BBB::BayerPattern::None)
+    {
+        bayerView.data = rectData;
+        bayerView.width = (int)rect->GetWidth();
+        bayerView.height = (int)rect->GetHeight();
+        bayerView.strideBytes = rectStride;
+        bayerView.bpp = 8;
+
+        // ARR el guiado necesita la imagen entera y el mosaico crudo le meteria el patron 2x2
+        // ARR demosaicamos todo y a partir de aqui la rectificada es RGB24
+        if (guided && BBB::Demosaic::ToRGB(bayerView, bayerPattern, p.demosaicEdgeAware, demosaicBuf))
+        {
+            rectData = demosaicBuf.data();
+            rectStride = bayerView.width * 3;
+            rectBpp = 24;
+            bayerPattern = BBB::BayerPattern::None;
+        }
+    }
 
-    const uint8_t* d8 = (const uint8_t*)disp->GetData();
-    const uint16_t* d16 = (const uint16_t*)disp->GetData();
-    const int strideBytes = (int)disp->GetStride();
-    const int strideU16 = strideBytes / (int)sizeof(uint16_t);
+    // ARR de aqui sale el color de los puntos al exportar, vale mientras viva el set
+    colorSrc = BBB::ColorSource{};
+    if (rectData)
+    {
+        colorSrc.image.data = rectData;
+        colorSrc.image.width = (int)rect->GetWidth();
+        colorSrc.image.height = (int)rect->GetHeight();
+        colorSrc.image.strideBytes = rectStride;
+        colorSrc.image.bpp = (int)rectBpp;
+        colorSrc.bayer = bayerPattern;
+        colorSrc.edgeAware = p.demosaicEdgeAware;
+        colorSrc.pixWidth = w;
+    }
 
-    int x0, x1, y0, y1;
-    ClampRoiXY(p, w, h, x0, x1, y0, y1);
-
-    auto IsInvalidRaw = [&](uint16_t raw) -> bool
-        {
-            if (raw == 0) return true;
-            if (s3d.invalidFlag)
-            {
-                uint16_t inv = (uint16_t)(s3d.invalidValue);
-                if (raw == inv) return true;
-            }
-            return false;
-        };
-
-    auto ReadRawAt = [&](int x, int y) -> uint16_t
-        {
-            if (bpp <= 8) return (uint16_t)d8[y * strideBytes + x];
-            return d16[y * strideU16 + x];
-        };
-
-    auto MedianRaw3x3 = [&](int x, int y) -> uint16_t
+    // ARR huecos y suavizado guiados por la rectificada, sustituye a la mediana
+    bool guidedDone = false;
+    if (guided && rectData)
+    {
+        BBB::ScopedStage stage(BBB::Stage::GuidedFill);
+        auto t0 = std::chrono::steady_clock::now();
+
+        BBB::GuideView guide;
+        guide.data = rectData;
+        guide.width = (int)rect->GetWidth();
+        guide.height = (int)rect->GetHeight();
+        guide.strideBytes = rectStride;
+        guide.bpp = (int)rectBpp;
+
+        BBB::PixelRoi roi;
+        ClampRoiXY(p, w, h, roi.x0, roi.x1, roi.y0, roi.y1);
+
+        // ARR un valido no se mueve mas que el umbral de speckle, en crudo
+        BBB::GuidedFillParams gfp;
+        gfp.radiusPx = p.guidedRadiusPx;
+        gfp.eps = p.guidedEps;
+        gfp.minCoverage = p.guidedMinCoverage;
+        gfp.maxDeltaRaw = s3d.scale > 1e-9f ? (int)((float)p.speckleThreshold / s3d.scale) : p.speckleThreshold;
+
+        BBB::GuidedFillStats gst;
+        if (BBB::GuidedFill::Apply(view, guide, roi, gfp, (uint16_t)s3d.invalidValue, fillBuf, gst))
         {
-            if (!p.applyMedian3x3) return ReadRawAt(x, y);
+            view = fillBuf.View();
+            guidedDone = true;
 
-            uint16_t vals[9];
-            int n = 0;
-
-            for (int dy = -1; dy <= 1; ++dy)
-            {
-                int yy = y + dy;
-                if (yy < 0 || yy >= h) continue;
-
-                for (int dx = -1; dx <= 1; ++dx)
-                {
-                    int xx = x + dx;
-                    if (xx < 0 || xx >= w) continue;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "RELLENO guiado validos " << gst.validBefore << " a " << gst.validAfter
+                << " tiempo " << ms << " ms\n";
+        }
+    }
 
-                    uint16_t r = ReadRawAt(xx, yy);
-                    if (IsInvalidRaw(r)) continue;
-                    vals[n++] = r;
-                }
-            }
+    const int step = (std::max)(1, p.decimationFactor);
 
-            if (n == 0) return 0;
-            std::sort(vals, vals + n);
-            return vals[n / 2];
-        };
+    BBB::PixelRoi roi;
+    ClampRoiXY(p, w, h, roi.x0, roi.x1, roi.y0, roi.y1);
 
-    auto RawToDisparity = [&](uint16_t raw) -> float
-        {
-            return (float)raw * s3d.scale + s3d.offset;
-        };
+    // ARR los puntos de entrada son los pixeles de la ROI tras decimar
+    BBB::ScopedStage reprojStage(BBB::Stage::Reprojection,
+        (size_t)((roi.x1 - roi.x0 + step - 1) / step) * (size_t)((roi.y1 - roi.y0 + step - 1) / step));
 
-    auto DisparityToZ = [&](float dispVal) -> float
+    if (coord3D)
+    {
+        if (!BBB::Coord3D::Run(MakeCoord3DView(disp), Coord3DParamsFor(p, mount, s3d, w, h, step), pts, ptCell))
         {
-            return (focal * baselineM) / dispVal;
-        };
-
-    std::vector<Pt> pts;
-    pts.reserve(((x1 - x0) / step) * ((y1 - y0) / step));
-
-    float zHardMax = p.hardMaxZM;
-    float zMaxUse = std::min(p.maxRangeM, zHardMax);
-
-    for (int y = y0; y < y1; y += step)
+            std::cout << "Coord3D no valido, AC necesita Scan3dFocalLength\n";
+            return false;
+        }
+    }
+    else
     {
-        for (int x = x0; x < x1; x += step)
+        // ARR la variante compilada del bucle se elige una vez aqui segun formato y opciones
+        BBB::ReprojectParams rp;
+        rp.roi = roi;
+        rp.step = step;
+        rp.scale = s3d.scale;
+        rp.offset = s3d.offset;
+        rp.focal = focal;
+        rp.baselineM = baselineM;
+        rp.principalU = s3d.principalU;
+        rp.principalV = s3d.principalV;
+        rp.invalidFlag = s3d.invalidFlag;
+        rp.invalidValue = (uint16_t)s3d.invalidValue;
+        rp.minZ = p.minRangeM;
+        rp.maxZ = std::min(p.maxRangeM, p.hardMaxZM);
+        rp.median3x3 = p.applyMedian3x3 && !guidedDone && !cameraFilterPlan.medianOnCamera;
+        rp.groundFilter = p.enableGroundPlaneFilter;
+        rp.camHeightM = mount.alturaCamaraM;
+        rp.pitchDownDeg = mount.pitchDeg;
+        rp.groundMinHeightM = p.groundMinHeightM;
+
+        // ARR el color va al final solo para los que sobreviven, aqui cada punto lleva su pixel
+        if (!BBB::Reprojection::Run(view, rp, pts, ptCell))
         {
-            uint16_t raw = MedianRaw3x3(x, y);
-            if (IsInvalidRaw(raw)) continue;
-
-            float dispVal = RawToDisparity(raw);
-            if (dispVal <= 1e-6f) continue;
-
-            float z = DisparityToZ(dispVal);
-            if (!std::isfinite(z)) continue;
-
-            if (z > zHardMax) continue;
-            if (z < p.minRangeM || z > zMaxUse) continue;
+            std::cout << "Formato de disparidad no soportado bpp " << view.bpp << "\n";
+            return false;
+        }
+    }
 
-            float X = ((float)x - s3d.principalU) * z / focal;
-            float Y = ((float)y - s3d.principalV) * z / focal;
+    reprojStage.PointsOut(pts.size());
+    reprojStage.Stop();
 
-            // filtro geometrico suelo (si está activo)
-            if (p.enableGroundPlaneFilter)
-            {
-                float hAG = HeightAboveGroundM(X, Y, z, mount.alturaCamaraM, mount.pitchDeg);
-                if (!std::isfinite(hAG)) continue;
-                if (hAG < p.groundMinHeightM) continue;
-            }
+    ptPixWidth = w;
 
-            uint8_t R = 180, G = 180, B = 180;
+    // ARR rejilla organizada para las caras, misma decimacion que la nube
+    const int gw = (roi.x1 - roi.x0 + step - 1) / step;
+    const int gh = (roi.y1 - roi.y0 + step - 1) / step;
 
-            // ARR colorMode
-            // ARR 0 gris fijo
-            // ARR 1 gris de rectified
-            // ARR 2 heatmap por profundidad
-            // ARR 3 color real de rectified si hay RGB y si no tiramos a gris
+    const bool needGrid = p.enableFaceSegmentation || p.estimateNormals;
 
-            if (p.colorMode == 2)
-            {
-                DepthToHeatRGB(z, p.minRangeM, zMaxUse, R, G, B);
-            }
-            else if ((p.colorMode == 1 || p.colorMode == 3) && rectData && rectStride > 0)
-            {
-                if (rectBpp == 24)
-                {
-                    const int off = y * rectStride + x * 3;
-                    const uint8_t* px = rectData + off;
-
-                    // ARR cuando fijamos PixelFormat a RGB8Packed el orden es R G B
-                    uint8_t r0 = px[0];
-                    uint8_t g0 = px[1];
-                    uint8_t b0 = px[2];
-
-                    if (p.colorMode == 1)
-                    {
-                        uint8_t g = (uint8_t)(((int)r0 + (int)g0 + (int)b0) / 3);
-                        R = g; G = g; B = g;
-                    }
-                    else
-                    {
-                        R = r0; G = g0; B = b0;
-                    }
-                }
-                else if (rectBpp == 8)
-                {
-                    uint8_t g = rectData[y * rectStride + x];
-                    R = g; G = g; B = g;
-                }
-            }
+    if (needGrid)
+    {
+        organized.Reset(gw, gh, roi.x0, roi.y0, step);
 
-            Pt q;
-            q.x = X; q.y = Y; q.z = z;
-            q.r = R; q.g = G; q.b = B;
-            pts.push_back(q);
+        for (size_t i = 0; i < pts.size(); ++i)
+        {
+            const int gi = ptCell[i];
+            organized.x[gi] = pts[i].x;
+            organized.y[gi] = pts[i].y;
+            organized.z[gi] = pts[i].z;
         }
     }
+    else organized.Reset(0, 0, roi.x0, roi.y0, step);
 
     if (pts.size() < 500)
     {
@@ -1128,14 +1155,31 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
 
     std::cout << "Puntos RAW (sin filtrar) " << pts.size() << "\n";
 
-    float zFront = std::numeric_limits<float>::quiet_NaN();
+    // ARR normales en la rejilla antes de filtrar, los puntos que queden las recogen por su pix al exportar
+    if (p.estimateNormals)
+    {
+        BBB::ScopedStage stage(BBB::Stage::Normals, pts.size());
+        auto t0 = std::chrono::steady_clock::now();
+
+        BBB::Normals::EstimateIntegral(organized, p.normalRadiusPx, 6, p.normalMaxDepthChange, normals);
+
+        int withNormal = 0;
+        for (size_t i = 0; i < pts.size(); ++i)
+            if (normals.Valid(ptCell[i])) withNormal++;
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Normales " << withNormal << " de " << pts.size() << " puntos tiempo " << ms << " ms\n";
+    }
+
     if (p.enableFrontDepthClamp)
     {
+        BBB::ScopedStage stage(BBB::Stage::FrontClamp, pts.size());
+
         std::vector<float> zvals;
         zvals.reserve(pts.size());
         for (const auto& q : pts) zvals.push_back(q.z);
 
-        zFront = Percentile(zvals, p.frontFacePercentile);
+        zFront = VisionMath::Percentile(zvals, p.frontFacePercentile);
         if (std::isfinite(zFront))
         {
             float zCut = zFront + p.frontDepthBandM;
@@ -1151,6 +1195,12 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
                 << " puntos " << pts.size() << " -> " << tmp.size() << "\n";
 
             pts.swap(tmp);
+            stage.PointsOut(pts.size());
+
+            // ARR el fondo tampoco entra en la rejilla
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            for (size_t i = 0; i < organized.z.size(); ++i)
+                if (organized.z[i] > zCut) organized.z[i] = nan;
         }
     }
 
@@ -1161,22 +1211,62 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
     }
 
     {
-        auto tmp = VoxelDownsample(pts, p.voxelLeafM);
+        BBB::ScopedStage stage(BBB::Stage::Voxel, pts.size());
+
+        auto tmp = BBB::CloudFilters::VoxelDownsample(pts, p.voxelLeafM);
         std::cout << "Puntos voxel " << pts.size() << " -> " << tmp.size() << "\n";
         pts.swap(tmp);
-    }
 
-    {
-        auto tmp = RadiusOutlierRemoval(pts, p.outlierRadiusM, p.outlierMinNeighbors);
-        std::cout << "Puntos outlier " << pts.size() << " -> " << tmp.size() << "\n";
-        pts.swap(tmp);
+        stage.PointsOut(pts.size());
     }
 
-    if (p.keepLargestCluster)
+    // ARR indice para outliers y cluster por celdas, cada filtro solo va apagando puntos de la mascara
     {
-        auto tmp = KeepLargestCluster(pts, p.outlierRadiusM);
-        std::cout << "Puntos cluster " << pts.size() << " -> " << tmp.size() << "\n";
-        pts.swap(tmp);
+        auto t0 = std::chrono::steady_clock::now();
+
+        // ARR el indice solo lo usa outlier y cuenta en su etapa, el cluster va por celdas sin indice
+        BBB::ScopedStage stage(BBB::Stage::Outlier, pts.size());
+
+        BBB::KdTree cloudIndex;
+        cloudIndex.Build(pts);
+        std::vector<uint8_t> keep(pts.size(), 1);
+
+        size_t nIn = pts.size();
+        size_t nOut = nIn;
+
+        if (p.outlierMode == 1)
+        {
+            // ARR estadistico, se adapta solo a la densidad que cambia con la distancia
+            BBB::CloudFilters::StatisticalOutlierMask(cloudIndex, p.sorMeanK, p.sorStdMul, keep);
+            nOut = (size_t)std::count(keep.begin(), keep.end(), (uint8_t)1);
+            std::cout << "Puntos outlier estadistico k " << p.sorMeanK << " " << nIn << " -> " << nOut << "\n";
+        }
+        else
+        {
+            BBB::CloudFilters::RadiusOutlierMask(cloudIndex, p.outlierRadiusM, p.outlierMinNeighbors, keep);
+            nOut = (size_t)std::count(keep.begin(), keep.end(), (uint8_t)1);
+            std::cout << "Puntos outlier " << nIn << " -> " << nOut << "\n";
+        }
+
+        stage.PointsOut(nOut);
+        stage.Stop();
+
+        if (p.keepLargestCluster)
+        {
+            BBB::ScopedStage clusterStage(BBB::Stage::Cluster, nOut);
+
+            nIn = nOut;
+            BBB::CloudFilters::LargestClusterMask(pts, p.outlierRadiusM, keep);
+            nOut = (size_t)std::count(keep.begin(), keep.end(), (uint8_t)1);
+            std::cout << "Puntos cluster " << nIn << " -> " << nOut << "\n";
+
+            clusterStage.PointsOut(nOut);
+        }
+
+        pts = BBB::CloudFilters::Compact(pts, keep);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Indice y filtros " << ms << " ms\n";
     }
 
     if (pts.size() < 300)
@@ -1185,22 +1275,47 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
         return false;
     }
 
+    return true;
+}
+
+bool BBBDriver::SavePointCloudPLY_Filtered(
+    const ImageList& set,
+    const Scan3DParams& s3d,
+    const BBBParams& p,
+    const BBBCameraMount& mount,
+    const std::string& filePath)
+{
+    std::vector<Pt> pts;
+    float zFront = std::numeric_limits<float>::quiet_NaN();
+
+    if (!BuildPointCloud_Filtered(set, s3d, p, mount, pts, zFront)) return false;
+
     // Medidas en consola
     {
-        std::vector<float> xs, zs, hs;
+        BBB::ScopedStage stage(BBB::Stage::Measurement, pts.size());
+
+        std::vector<float> xs, ys, zs, hs;
         xs.reserve(pts.size());
+        ys.reserve(pts.size());
         zs.reserve(pts.size());
-        hs.reserve(pts.size());
 
         for (const auto& q : pts)
         {
             xs.push_back(q.x);
+            ys.push_back(q.y);
             zs.push_back(q.z);
-
-            float hAG = HeightAboveGroundM(q.x, q.y, q.z, mount.alturaCamaraM, mount.pitchDeg);
-            if (std::isfinite(hAG)) hs.push_back(hAG);
         }
 
+        // ARR alturas de todos los puntos de una vez, hAll sigue el orden de pts
+        // ARR los percentiles reordenan xs y zs asi que la cara tira de hAll
+        std::vector<float> hAll(pts.size());
+        VisionMath::HeightAboveGroundBatch(ys.data(), zs.data(), (int)pts.size(),
+            mount.alturaCamaraM, mount.pitchDeg, hAll.data());
+
+        hs.reserve(hAll.size());
+        for (float hv : hAll)
+            if (std::isfinite(hv)) hs.push_back(hv);
+
         float xMin = +1e9f, xMax = -1e9f;
         float hMin = +1e9f, hMax = -1e9f;
         float zMin = +1e9f, zMax = -1e9f;
@@ -1222,19 +1337,19 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
         float qLo = std::clamp(p.dimPercentileLow, 0.0f, 0.49f);
         float qHi = std::clamp(p.dimPercentileHigh, 0.51f, 1.0f);
 
-        float xLo = Percentile(xs, qLo);
-        float xHi = Percentile(xs, qHi);
+        float xLo = VisionMath::Percentile(xs, qLo);
+        float xHi = VisionMath::Percentile(xs, qHi);
 
-        float hLo = Percentile(hs, qLo);
-        float hHi = Percentile(hs, qHi);
+        float hLo = VisionMath::Percentile(hs, qLo);
+        float hHi = VisionMath::Percentile(hs, qHi);
 
-        float zLo = Percentile(zs, 0.05f);
-        float zHi = Percentile(zs, 0.95f);
+        float zLo = VisionMath::Percentile(zs, 0.05f);
+        float zHi = VisionMath::Percentile(zs, 0.95f);
 
         float anchoM = xHi - xLo;
         float altoM = hHi - hLo;
 
-        float zFace = std::isfinite(zFront) ? zFront : Percentile(zs, p.frontFacePercentile);
+        float zFace = std::isfinite(zFront) ? zFront : VisionMath::Percentile(zs, p.frontFacePercentile);
         float faceAnchoM = std::numeric_limits<float>::quiet_NaN();
         float faceAltoM = std::numeric_limits<float>::quiet_NaN();
 
@@ -1245,21 +1360,21 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
             fhs.reserve(pts.size() / 3);
 
             float zLim = zFace + p.faceSlabM;
-            for (const auto& q : pts)
+            for (size_t i = 0; i < pts.size(); ++i)
             {
+                const Pt& q = pts[i];
                 if (q.z > zLim) continue;
                 fxs.push_back(q.x);
 
-                float hAG = HeightAboveGroundM(q.x, q.y, q.z, mount.alturaCamaraM, mount.pitchDeg);
-                if (std::isfinite(hAG)) fhs.push_back(hAG);
+                if (std::isfinite(hAll[i])) fhs.push_back(hAll[i]);
             }
 
             if (fxs.size() >= 200 && fhs.size() >= 200)
             {
-                float fxLo = Percentile(fxs, qLo);
-                float fxHi = Percentile(fxs, qHi);
-                float fhLo = Percentile(fhs, qLo);
-                float fhHi = Percentile(fhs, qHi);
+                float fxLo = VisionMath::Percentile(fxs, qLo);
+                float fxHi = VisionMath::Percentile(fxs, qHi);
+                float fhLo = VisionMath::Percentile(fhs, qLo);
+                float fhHi = VisionMath::Percentile(fhs, qHi);
 
                 faceAnchoM = fxHi - fxLo;
                 faceAltoM = fhHi - fhLo;
@@ -1280,7 +1395,92 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
             << "z min-max " << zMin << " a " << zMax
             << "\n";
 
-        if (std::isfinite(faceAnchoM) && std::isfinite(faceAltoM))
+        // ARR caja orientada minima en el suelo, no depende de como este girado el bulto
+        {
+            auto t0 = std::chrono::steady_clock::now();
+
+            BBB::OrientedBox obb;
+            bool okObb = BBB::Measurement::MeasureOrientedBox(pts, mount, p.groundMinHeightM, qHi, obb);
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            if (okObb)
+            {
+                std::cout << "BULTO caja orientada "
+                    << "largo " << obb.lengthM << " m " << (int)std::lround(obb.lengthM * 1000.0f) << " mm "
+                    << "ancho " << obb.widthM << " m " << (int)std::lround(obb.widthM * 1000.0f) << " mm "
+                    << "alto p" << (int)std::lround(qHi * 100) << " " << obb.heightM << " m " << (int)std::lround(obb.heightM * 1000.0f) << " mm "
+                    << "yaw " << obb.yawDeg << " grados "
+                    << "casco " << obb.hullPoints << " tiempo " << ms << " ms"
+                    << "\n";
+            }
+            else
+            {
+                std::cout << "BULTO caja orientada sin suficientes puntos sobre el suelo\n";
+            }
+        }
+
+        // ARR caras por planos, aguanta bultos girados donde el slab en z se come la lateral
+        bool frontFromPlanes = false;
+
+        if (p.enableFaceSegmentation && organized.width > 0)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+
+            // ARR solo la zona del bulto ya limpio, con margen para la ventana de normales
+            const float margin = 2.0f * p.voxelLeafM;
+            float bMin[3] = { xMin - margin, +1e9f, zMin - margin };
+            float bMax[3] = { xMax + margin, -1e9f, zMax + margin };
+            for (const auto& q : pts)
+            {
+                bMin[1] = std::min(bMin[1], q.y - margin);
+                bMax[1] = std::max(bMax[1], q.y + margin);
+            }
+
+            organized.CropToBox(bMin, bMax, p.normalRadiusPx, organizedBox);
+            BBB::Normals::EstimateIntegral(organizedBox, p.normalRadiusPx, 6, p.normalMaxDepthChange, boxNormals);
+
+            auto t1 = std::chrono::steady_clock::now();
+
+            BBB::FaceSegParams fsp;
+            fsp.angleDeg = p.faceAngleDeg;
+            fsp.distM = p.faceDistM;
+            fsp.minRegionPoints = p.faceMinPoints;
+            fsp.qLow = qLo;
+            fsp.qHigh = qHi;
+
+            std::vector<BBB::BoxFace> faces;
+            bool okFaces = BBB::PlaneSegmentation::SegmentBoxFaces(organizedBox, boxNormals, mount, fsp, faces);
+
+            auto t2 = std::chrono::steady_clock::now();
+            double msN = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            double msS = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+            if (okFaces)
+            {
+                for (const auto& fc : faces)
+                {
+                    if (fc.kind == BBB::FaceKind::Front) frontFromPlanes = true;
+
+                    std::cout << "CARA " << BBB::PlaneSegmentation::FaceName(fc.kind)
+                        << " ancho " << fc.widthM << " m " << (int)std::lround(fc.widthM * 1000.0f) << " mm "
+                        << (fc.kind == BBB::FaceKind::Top ? "largo " : "alto ")
+                        << fc.heightM << " m " << (int)std::lround(fc.heightM * 1000.0f) << " mm "
+                        << "area " << fc.areaM2 << " m2 "
+                        << "puntos " << fc.plane.points << " rms " << fc.plane.rmsM * 1000.0f << " mm"
+                        << "\n";
+                }
+            }
+            else
+            {
+                std::cout << "CARAS sin planos dominantes\n";
+            }
+
+            std::cout << "CARAS tiempo normales " << msN << " ms segmentacion " << msS << " ms\n";
+        }
+
+        // ARR si ya tenemos la frontal del plano el slab no se imprime
+        if (!frontFromPlanes && std::isfinite(faceAnchoM) && std::isfinite(faceAltoM))
         {
             float areaM2 = faceAnchoM * faceAltoM;
             std::cout << "CARA frontal "
@@ -1291,12 +1491,29 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
                 << " area " << areaM2 << " m2"
                 << "\n";
         }
-        else
+        else if (!frontFromPlanes)
         {
             std::cout << "CARA frontal sin suficientes puntos para medir\n";
         }
     }
 
+    // ARR color solo para los puntos que han pasado todos los filtros
+    {
+        BBB::ScopedStage stage(BBB::Stage::Colorize, pts.size());
+        auto t0 = std::chrono::steady_clock::now();
+
+        const float zMaxUse = std::min(p.maxRangeM, p.hardMaxZM);
+        BBB::Colorize::Apply(pts, p.colorMode, colorSrc, p.minRangeM, zMaxUse);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Color " << pts.size() << " puntos tiempo " << ms << " ms\n";
+    }
+
+    BBB::ScopedStage writeStage(BBB::Stage::WritePLY, pts.size());
+
+    // ARR normales solo de los puntos que se escriben, en SoA aparte para no engordar Pt
+    if (p.estimateNormals) BBB::Normals::Gather(normals, organized, ptPixWidth, pts, ptNormals);
+
     std::ofstream f(filePath, std::ios::binary);
     if (!f.is_open()) return false;
 
@@ -1306,35 +1523,86 @@ bool BBBDriver::SavePointCloudPLY_Filtered(
     f << "property float x\n";
     f << "property float y\n";
     f << "property float z\n";
+    if (p.estimateNormals)
+    {
+        f << "property float nx\n";
+        f << "property float ny\n";
+        f << "property float nz\n";
+    }
     f << "property uchar red\n";
     f << "property uchar green\n";
     f << "property uchar blue\n";
     f << "end_header\n";
 
-    for (const auto& q : pts)
+    for (size_t i = 0; i < pts.size(); ++i)
     {
+        const Pt& q = pts[i];
+
         if (!p.plyBinary)
         {
-            f << q.x << " " << q.y << " " << q.z << " "
-                << (int)q.r << " " << (int)q.g << " " << (int)q.b << "\n";
+            f << q.x << " " << q.y << " " << q.z << " ";
+            if (p.estimateNormals) f << ptNormals.nx[i] << " " << ptNormals.ny[i] << " " << ptNormals.nz[i] << " ";
+            f << (int)q.r << " " << (int)q.g << " " << (int)q.b << "\n";
         }
         else
         {
             f.write((char*)&q.x, sizeof(float));
             f.write((char*)&q.y, sizeof(float));
             f.write((char*)&q.z, sizeof(float));
+            if (p.estimateNormals)
+            {
+                f.write((char*)&ptNormals.nx[i], sizeof(float));
+                f.write((char*)&ptNormals.ny[i], sizeof(float));
+                f.write((char*)&ptNormals.nz[i], sizeof(float));
+            }
             f.write((char*)&q.r, sizeof(uint8_t));
             f.write((char*)&q.g, sizeof(uint8_t));
             f.write((char*)&q.b, sizeof(uint8_t));
         }
     }
 
+    f.close();
+    writeStage.Stop();
+
     std::cout << "PLY guardado " << filePath
         << " puntos " << pts.size()
         << " rango " << p.minRangeM << " a " << std::min(p.maxRangeM, p.hardMaxZM)
         << " colorMode " << p.colorMode
         << "\n";
 
+    // ARR niveles de detalle al lado del PLY para que el visor abra primero una vista gruesa
+    if (p.lodLevels > 0)
+    {
+        BBB::ScopedStage stage(BBB::Stage::WriteLOD, pts.size());
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::string lodPath = filePath;
+        size_t dot = lodPath.find_last_of('.');
+        size_t slash = lodPath.find_last_of("/\\");
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) lodPath.erase(dot);
+        lodPath += ".lod";
+
+        // ARR el nivel mas fino antes del completo con celda doble del voxel
+        float finestCellM = 2.0f * (p.voxelLeafM > 0.0f ? p.voxelLeafM : 0.005f);
+
+        BBB::LodCloud lod;
+        bool okLod = BBB::OctreeLod::Build(pts, p.lodLevels, finestCellM, lod) &&
+            BBB::OctreeLod::Write(lodPath, lod, p.estimateNormals ? &ptNormals : nullptr);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        if (okLod)
+        {
+            std::cout << "LOD guardado " << lodPath << " niveles";
+            for (const auto& lv : lod.levels) std::cout << " " << lv.count;
+            std::cout << " tiempo " << ms << " ms\n";
+        }
+        else
+        {
+            std::cout << "LOD no se pudo guardar " << lodPath << "\n";
+        }
+    }
+
     return true;
 }
 
@@ -1348,6 +1616,15 @@ bool BBBDriver::GetDistanceCentralPointM(const ImageList& set, const Scan3DParam
     const int cx = w / 2;
     const int cy = h / 2;
 
+    if (IsCoord3DPF(disp->GetPixelFormat()))
+    {
+        BBB::Coord3DParams cp;
+        cp.unitToM = s3d.distanceUnitM;
+        cp.invalidFlag = s3d.invalidFlag;
+        cp.invalidValue = s3d.invalidValue;
+        return BBB::Coord3D::DepthAt(MakeCoord3DView(disp), cp, cx, cy, outMeters);
+    }
+
     const unsigned int bpp = disp->GetBitsPerPixel();
     const uint8_t* d8 = (const uint8_t*)disp->GetData();
     const uint16_t* d16 = (const uint16_t*)disp->GetData();
@@ -1389,9 +1666,27 @@ bool BBBDriver::GetDistanceToBultoM_Debug(
     ImagePtr disp = FindDisparity(set);
     if (!disp || disp->IsIncomplete() || !disp->GetData()) return false;
 
+    BBB::ScopedStage stage(BBB::Stage::Measurement);
+
     const int w = (int)disp->GetWidth();
     const int h = (int)disp->GetHeight();
 
+    // ARR con Coord3D la camara ya da la Z, solo aplicamos ROI rango y suelo
+    if (IsCoord3DPF(disp->GetPixelFormat()))
+    {
+        std::vector<Pt> c3d;
+        std::vector<int> cells;
+        if (!BBB::Coord3D::Run(MakeCoord3DView(disp), Coord3DParamsFor(p, mount, s3d, w, h, 1), c3d, cells)) return false;
+        if (c3d.size() < 200) return false;
+
+        std::vector<float> depths(c3d.size());
+        for (size_t i = 0; i < c3d.size(); ++i) depths[i] = c3d[i].z;
+
+        outUsedPoints = (int)depths.size();
+        outMeters = VisionMath::Percentile(depths, p.bultoFacePercentile);
+        return std::isfinite(outMeters);
+    }
+
     int x0, x1, y0, y1;
     ClampRoiXY(p, w, h, x0, x1, y0, y1);
 
@@ -1427,8 +1722,13 @@ bool BBBDriver::GetDistanceToBultoM_Debug(
     float zHardMax = p.hardMaxZM;
     float zMaxUse = std::min(p.maxRangeM, zHardMax);
 
+    // ARR profundidades validas de la fila y su Y para el filtro de suelo en bloque
+    std::vector<float> rowY((size_t)(std::max)(0, x1 - x0)), rowZ(rowY.size()), rowH(rowY.size());
+
     for (int y = y0; y < y1; ++y)
     {
+        int nRow = 0;
+
         for (int x = x0; x < x1; ++x)
         {
             uint16_t raw = ReadRawAt(x, y);
@@ -1443,17 +1743,23 @@ bool BBBDriver::GetDistanceToBultoM_Debug(
             if (z > zHardMax) continue;
             if (z < p.minRangeM || z > zMaxUse) continue;
 
+            rowY[nRow] = ((float)y - s3d.principalV) * z / focal;
+            rowZ[nRow] = z;
+            nRow++;
+        }
+
+        if (p.enableGroundPlaneFilter)
+            VisionMath::HeightAboveGroundBatch(rowY.data(), rowZ.data(), nRow, mount.alturaCamaraM, mount.pitchDeg, rowH.data());
+
+        for (int k = 0; k < nRow; ++k)
+        {
             if (p.enableGroundPlaneFilter)
             {
-                float X = ((float)x - s3d.principalU) * z / focal;
-                float Y = ((float)y - s3d.principalV) * z / focal;
-
-                float hAG = HeightAboveGroundM(X, Y, z, mount.alturaCamaraM, mount.pitchDeg);
-                if (!std::isfinite(hAG)) continue;
-                if (hAG < p.groundMinHeightM) continue;
+                if (!std::isfinite(rowH[k])) continue;
+                if (rowH[k] < p.groundMinHeightM) continue;
             }
 
-            depths.push_back(z);
+            depths.push_back(rowZ[k]);
             outUsedPoints++;
         }
     }
@@ -1461,10 +1767,180 @@ bool BBBDriver::GetDistanceToBultoM_Debug(
     if (depths.size() < 200) return false;
 
     std::vector<float> tmp = depths;
-    outMeters = Percentile(tmp, p.bultoFacePercentile);
+    outMeters = VisionMath::Percentile(tmp, p.bultoFacePercentile);
     return std::isfinite(outMeters);
 }
 
+bool BBBDriver::MeasureHeightMap(
+    const ImageList& set,
+    const Scan3DParams& s3d,
+    const BBBParams& p,
+    const BBBCameraMount& mount,
+    BBB::HeightMapStats& out)
+{
+    out = BBB::HeightMapStats{};
+
+    if (p.heightMapCellM <= 1e-4f) return false;
+
+    ImagePtr disp = FindDisparity(set);
+    if (!disp || disp->IsIncomplete() || !disp->GetData()) return false;
+
+    BBB::ScopedStage stage(BBB::Stage::Measurement);
+    auto t0 = std::chrono::steady_clock::now();
+
+    BBB::HeightMapGrid grid;
+
+    if (IsCoord3DPF(disp->GetPixelFormat()))
+    {
+        // ARR el Coord3D ya viene en camara, pasamos por la nube decimada y la rasterizamos
+        std::vector<Pt> c3d;
+        std::vector<int> cells;
+        const int w = (int)disp->GetWidth();
+        const int h = (int)disp->GetHeight();
+
+        if (!BBB::Coord3D::Run(MakeCoord3DView(disp), Coord3DParamsFor(p, mount, s3d, w, h, p.decimationFactor), c3d, cells))
+            return false;
+        if (!BBB::HeightMap::BuildFromPoints(c3d, p, mount, grid))
+            return false;
+    }
+    else
+    {
+        BBB::DisparityView view = SpeckleFilteredView(disp, s3d, p);
+
+        BBB::PixelRoi roi;
+        ClampRoiXY(p, view.width, view.height, roi.x0, roi.x1, roi.y0, roi.y1);
+
+        if (!BBB::HeightMap::BuildFromDisparity(view, s3d, BaselineToMeters(s3d.baseline), roi, p, mount, grid))
+            return false;
+    }
+
+    out = BBB::HeightMap::Measure(grid, p.groundMinHeightM, 3);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << "MAPA alturas "
+        << grid.cols << " x " << grid.rows << " celdas de " << grid.cellM << " m"
+        << " ocupadas " << out.occupiedCells
+        << " tiempo " << ms << " ms\n";
+
+    return out.occupiedCells > 0;
+}
+
+bool BBBDriver::ReprocessStereoPGM(
+    const std::string& leftPath,
+    const std::string& rightPath,
+    const std::string& refDispPath,
+    const Scan3DParams& s3d,
+    const BBBParams& p,
+    const std::string& outPath)
+{
+    BBB::DisparityBuffer left, right;
+    if (!BBB::ImageIO::LoadPGM(leftPath, left) || !BBB::ImageIO::LoadPGM(rightPath, right))
+    {
+        std::cout << "SGM no pudimos leer el par " << leftPath << " " << rightPath << "\n";
+        return false;
+    }
+
+    if (left.bpp != 8 || right.bpp != 8 || left.width != right.width || left.height != right.height)
+    {
+        std::cout << "SGM el par tiene que ser mono 8 bits y del mismo tamano\n";
+        return false;
+    }
+
+    BBB::StereoParams sp;
+    sp.numDisparities = p.sgmNumDisparities;
+    sp.p1 = p.sgmP1;
+    sp.p2 = p.sgmP2;
+    sp.paths = p.sgmPaths;
+
+    // ARR misma codificacion que la camara, sin Scan3D leido dejamos 1/64 de pixel
+    if (s3d.scale > 1e-9f)
+    {
+        sp.scale = s3d.scale;
+        sp.offset = s3d.offset;
+    }
+    sp.invalidValue = s3d.invalidFlag ? (uint16_t)s3d.invalidValue : 0;
+
+    BBB::PixelRoi roi;
+    ClampRoiXY(p, left.width, left.height, roi.x0, roi.x1, roi.y0, roi.y1);
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    BBB::DisparityBuffer disp;
+    if (!BBB::StereoMatcher::Compute(left.View(), right.View(), roi, sp, disp))
+    {
+        std::cout << "SGM parametros no validos, sgmNumDisparities tiene que ser multiplo de 8\n";
+        return false;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    BBB::DisparityView view = disp.View();
+    auto Valid = [&](uint16_t raw) { return raw != 0 && raw != sp.invalidValue; };
+
+    int roiPx = 0, validPx = 0;
+    for (int y = roi.y0; y < roi.y1; ++y)
+        for (int x = roi.x0; x < roi.x1; ++x)
+        {
+            roiPx++;
+            if (Valid(view.RawAt(x, y))) validPx++;
+        }
+
+    std::cout << "SGM " << left.width << " x " << left.height
+        << " disparidades " << sp.numDisparities << " caminos " << sp.paths
+        << " validos " << (roiPx > 0 ? 100.0 * validPx / roiPx : 0.0) << " % del ROI"
+        << " tiempo " << ms << " ms\n";
+
+    if (!refDispPath.empty())
+    {
+        BBB::DisparityBuffer ref;
+        if (BBB::ImageIO::LoadPGM(refDispPath, ref) && ref.width == disp.width && ref.height == disp.height)
+        {
+            BBB::DisparityView rv = ref.View();
+
+            int refValid = 0, both = 0, within1 = 0;
+            double sumAbs = 0.0;
+            for (int y = roi.y0; y < roi.y1; ++y)
+            {
+                for (int x = roi.x0; x < roi.x1; ++x)
+                {
+                    uint16_t a = view.RawAt(x, y);
+                    uint16_t b = rv.RawAt(x, y);
+                    bool vb = b != 0 && !(s3d.invalidFlag && b == (uint16_t)s3d.invalidValue);
+                    if (vb) refValid++;
+                    if (!vb || !Valid(a)) continue;
+
+                    float da = (float)a * sp.scale + sp.offset;
+                    float db = (float)b * sp.scale + sp.offset;
+                    float e = std::fabs(da - db);
+
+                    both++;
+                    sumAbs += e;
+                    if (e <= 1.0f) within1++;
+                }
+            }
+
+            std::cout << "SGM frente a camara validos camara " << (roiPx > 0 ? 100.0 * refValid / roiPx : 0.0) << " %"
+                << " comunes " << both
+                << " a 1 px " << (both > 0 ? 100.0 * within1 / both : 0.0) << " %"
+                << " error medio " << (both > 0 ? sumAbs / both : 0.0) << " px\n";
+        }
+        else
+        {
+            std::cout << "SGM no pudimos leer la disparidad de referencia o no tiene el mismo tamano\n";
+        }
+    }
+
+    if (!BBB::ImageIO::SavePGM16_BE(disp, outPath))
+    {
+        std::cout << "SGM no pudimos guardar " << outPath << "\n";
+        return false;
+    }
+
+    std::cout << "SGM guardado " << outPath << "\n";
+    return true;
+}
+
 bool BBBDriver::SetExposureUs(double exposureUs)
 {
     if (!cam) return false;
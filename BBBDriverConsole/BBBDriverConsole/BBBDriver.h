@@ -14,25 +14,23 @@
 #endif
 
 #include <string>
+#include <vector>
 #include <cstdint>
 
 // TELEDYNE usamos Spinnaker y GenApi oficiales
 #include "Spinnaker.h"
 #include "SpinGenApi/SpinnakerGenApi.h"
 
+#include "BBBCameraFilters.h"
+#include "BBBColorize.h"
 #include "BBBConfig.h"
-
-struct Scan3DParams
-{
-    float scale = 1.0f;
-    float offset = 0.0f;
-    float focal = 0.0f;
-    float baseline = 0.0f;
-    float principalU = 0.0f;
-    float principalV = 0.0f;
-    bool invalidFlag = false;
-    float invalidValue = 0.0f;
-};
+#include "BBBCoord3D.h"
+#include "BBBDisparity.h"
+#include "BBBGuidedFill.h"
+#include "BBBHeightMap.h"
+#include "BBBNormals.h"
+#include "BBBPointCloudFilters.h"
+#include "BBBSpeckleFilter.h"
 
 class BBBDriver
 {
@@ -53,10 +51,17 @@ public:
 
     bool DisableGVCPHeartbeat(bool disable);
 
-    bool ConfigureStreams_Rectified1_Disparity();
+    bool ConfigureStreams_Rectified1_Disparity(bool streamBayer = false, bool streamCoord3D = false);
+
+    // ARR pasa speckle y mediana a la camara si al abrir encontramos sus nodos
+    // ARR lo que la camara no haga lo sigue haciendo el host
+    void ConfigureCameraFilters(const BBBParams& p);
     bool ConfigureSoftwareTrigger();
     bool ConfigureStreamBuffersNewestOnly();
 
+    // ARR buffers del stream en manual, con varias camaras cada una tiene los suyos
+    bool ConfigureStreamBufferCount(int count);
+
     bool ReadScan3DParams(Scan3DParams& out);
 
     bool StartAcquisition();
@@ -64,8 +69,21 @@ public:
 
     bool CaptureOnceSync(Spinnaker::ImageList& outSet, uint64_t timeoutMs);
 
-    bool SaveDisparityPGM(const Spinnaker::ImageList& set, const std::string& filePath);
-    bool SaveRectifiedPNG(const Spinnaker::ImageList& set, const std::string& filePath);
+    // ARR con Coord3D el PGM lleva la Z en mm, s3d da la unidad del buffer
+    bool SaveDisparityPGM(const Spinnaker::ImageList& set, const std::string& filePath, const Scan3DParams& s3d);
+    bool SaveRectifiedPNG(const Spinnaker::ImageList& set, const std::string& filePath, bool edgeAware = true);
+
+    // ARR reproyectamos y limpiamos la nube en sistema camara sin escribir nada
+    // ARR zFront sale NaN si el corte de fondo no esta activo
+    // ARR los puntos salen sin color con su pix, el color se pone al exportar con Colorize
+    bool BuildPointCloud_Filtered(
+        const Spinnaker::ImageList& set,
+        const Scan3DParams& s3d,
+        const BBBParams& p,
+        const BBBCameraMount& mount,
+        std::vector<BBB::Pt>& outPts,
+        float& outZFront
+    );
 
     bool SavePointCloudPLY_Filtered(
         const Spinnaker::ImageList& set,
@@ -86,6 +104,28 @@ public:
         int& outUsedPoints
     );
 
+    // ARR mapa de alturas 2.5D directo desde la disparidad, pensado para la cenital
+    // ARR huella altura y volumen sin construir ni filtrar la nube
+    bool MeasureHeightMap(
+        const Spinnaker::ImageList& set,
+        const Scan3DParams& s3d,
+        const BBBParams& p,
+        const BBBCameraMount& mount,
+        BBB::HeightMapStats& out
+    );
+
+    // ARR SGM en el host sobre un par rectificado guardado en PGM, no necesita camara
+    // la salida usa scale offset e invalido de s3d como la disparidad de la camara
+    // si refDispPath no esta vacio comparamos con esa disparidad dentro del ROI
+    static bool ReprocessStereoPGM(
+        const std::string& leftPath,
+        const std::string& rightPath,
+        const std::string& refDispPath,
+        const Scan3DParams& s3d,
+        const BBBParams& p,
+        const std::string& outPath
+    );
+
     bool SetExposureUs(double exposureUs);
     bool SetGainDb(double gainDb);
 
@@ -103,7 +143,43 @@ private:
     static void ClampRoiXY(const BBBParams& p, int w, int h, int& x0, int& x1, int& y0, int& y1);
     static float BaselineToMeters(float baselineMaybeMm);
 
+    // ARR nodos de postproceso que tiene la camara, se miran una vez al abrir
+    void ProbeCameraFilters();
+
+    // ARR ROI, rango y suelo para el Coord3D de la camara, cada step pixeles
+    static BBB::Coord3DParams Coord3DParamsFor(const BBBParams& p, const BBBCameraMount& mount, const Scan3DParams& s3d, int w, int h, int step);
+
+    // ARR speckle sobre la disparidad, el propio deja el resultado en speckleBuf y el del SDK toca la imagen
+    BBB::DisparityView SpeckleFilteredView(const Spinnaker::ImagePtr& disp, const Scan3DParams& s3d, const BBBParams& p);
+
 private:
     bool acquiring = false;
     Spinnaker::CameraPtr cam;
+
+    // ARR filtros de disparidad en la camara y que etapas les hemos pasado
+    BBB::CameraFilterCaps cameraFilterCaps;
+    BBB::CameraFilterPlan cameraFilterPlan;
+
+    // ARR nube organizada y normales del ultimo frame, se reutilizan entre capturas
+    BBB::OrganizedCloud organized;
+    BBB::OrganizedCloud organizedBox;
+    BBB::NormalMap normals;
+    BBB::NormalMap boxNormals;
+
+    // ARR celda de la rejilla de cada punto de la nube, para llenar la rejilla organizada
+    std::vector<int> ptCell;
+
+    // ARR ancho con el que se codifico pix y normales de los puntos que se exportan
+    int ptPixWidth = 0;
+    BBB::PointNormals ptNormals;
+
+    // ARR disparidad filtrada de speckle, no tocamos el buffer del SDK
+    BBB::DisparityBuffer speckleBuf;
+    BBB::DisparityBuffer fillBuf;
+
+    // ARR rectificada demosaicada cuando la camara manda Bayer
+    std::vector<uint8_t> demosaicBuf;
+
+    // ARR imagen de color del ultimo BuildPointCloud_Filtered, apunta al set o a demosaicBuf
+    BBB::ColorSource colorSrc;
 };
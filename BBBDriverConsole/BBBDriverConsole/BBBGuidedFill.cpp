@@ -0,0 +1,297 @@
+#include "BBBGuidedFill.h"
+
+#include "BBBParallel.h"
+#include "BBBSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace BBB
+{
+    // acc += row o acc -= row, el acumulador va en double para que la suma deslizante no derive
+    static void AccumRow(double* acc, const float* row, int w, bool add)
+    {
+        int x = 0;
+
+#if defined(BBB_SIMD_SSE2)
+        for (; x + 4 <= w; x += 4)
+        {
+            __m128 v = _mm_loadu_ps(row + x);
+            __m128d lo = _mm_cvtps_pd(v);
+            __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+            __m128d a0 = _mm_loadu_pd(acc + x);
+            __m128d a1 = _mm_loadu_pd(acc + x + 2);
+            if (add)
+            {
+                a0 = _mm_add_pd(a0, lo);
+                a1 = _mm_add_pd(a1, hi);
+            }
+            else
+            {
+                a0 = _mm_sub_pd(a0, lo);
+                a1 = _mm_sub_pd(a1, hi);
+            }
+            _mm_storeu_pd(acc + x, a0);
+            _mm_storeu_pd(acc + x + 2, a1);
+        }
+#endif
+
+        for (; x < w; ++x)
+        {
+            if (add) acc[x] += row[x];
+            else acc[x] -= row[x];
+        }
+    }
+
+    // suma en la ventana (2r + 1)^2 recortada al borde
+    // primero columnas, cada bloque de filas arranca su acumulador y lo desliza, luego filas
+    static void BoxSum(const float* src, float* dst, int w, int h, int r, std::vector<float>& tmp)
+    {
+        tmp.resize((size_t)w * h);
+
+        Parallel::For(0, h, 32, [&](int b, int e)
+            {
+                std::vector<double> acc(w, 0.0);
+                for (int y = (std::max)(0, b - r); y <= (std::min)(h - 1, b + r); ++y)
+                    AccumRow(acc.data(), src + (size_t)y * w, w, true);
+
+                for (int y = b; y < e; ++y)
+                {
+                    float* out = tmp.data() + (size_t)y * w;
+                    for (int x = 0; x < w; ++x) out[x] = (float)acc[x];
+
+                    if (y + 1 + r < h) AccumRow(acc.data(), src + (size_t)(y + 1 + r) * w, w, true);
+                    if (y - r >= 0) AccumRow(acc.data(), src + (size_t)(y - r) * w, w, false);
+                }
+            });
+
+        Parallel::For(0, h, 32, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    const float* in = tmp.data() + (size_t)y * w;
+                    float* out = dst + (size_t)y * w;
+
+                    double s = 0.0;
+                    for (int x = 0; x <= (std::min)(w - 1, r); ++x) s += in[x];
+
+                    for (int x = 0; x < w; ++x)
+                    {
+                        out[x] = (float)s;
+                        if (x + 1 + r < w) s += in[x + 1 + r];
+                        if (x - r >= 0) s -= in[x - r];
+                    }
+                }
+            });
+    }
+
+    bool GuidedFill::Apply(
+        const DisparityView& disp,
+        const GuideView& guide,
+        const PixelRoi& roi,
+        const GuidedFillParams& prm,
+        uint16_t invalidValue,
+        DisparityBuffer& out,
+        GuidedFillStats& stats)
+    {
+        stats = GuidedFillStats{};
+
+        if (!disp.data || !guide.data) return false;
+        if (disp.bpp != 8 && disp.bpp != 16) return false;
+        if (guide.bpp != 8 && guide.bpp != 24) return false;
+        if (guide.width != disp.width || guide.height != disp.height) return false;
+
+        const size_t rowBytes = (size_t)disp.width * (disp.bpp / 8);
+        out.width = disp.width;
+        out.height = disp.height;
+        out.bpp = disp.bpp;
+        out.strideBytes = (int)rowBytes;
+        out.bytes.resize(rowBytes * disp.height);
+
+        Parallel::For(0, disp.height, 64, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                    std::memcpy(out.bytes.data() + (size_t)y * rowBytes, disp.data + (size_t)y * disp.strideBytes, rowBytes);
+            });
+
+        const int r = (std::max)(1, prm.radiusPx);
+
+        // las dos cajas seguidas leen hasta 2r fuera del ROI
+        const int rx0 = std::clamp(roi.x0 - 2 * r, 0, disp.width);
+        const int rx1 = std::clamp(roi.x1 + 2 * r, 0, disp.width);
+        const int ry0 = std::clamp(roi.y0 - 2 * r, 0, disp.height);
+        const int ry1 = std::clamp(roi.y1 + 2 * r, 0, disp.height);
+
+        const int w = rx1 - rx0;
+        const int h = ry1 - ry0;
+        if (w <= 0 || h <= 0) return false;
+
+        const size_t n = (size_t)w * h;
+
+        auto Raw = [&](const DisparityView& v, int x, int y) -> int
+            {
+                return (int)v.RawAt(rx0 + x, ry0 + y);
+            };
+
+        // guia en gris [0, 1], mascara de validos y productos para las medias locales
+        std::vector<float> gray(n), ch[5], sum[5], tmp;
+        for (auto& c : ch) c.resize(n);
+        for (auto& s : sum) s.resize(n);
+
+        Parallel::For(0, h, 16, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    const uint8_t* g = guide.data + (size_t)(ry0 + y) * guide.strideBytes;
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const size_t i = (size_t)y * w + x;
+
+                        float I;
+                        if (guide.bpp == 24)
+                        {
+                            const uint8_t* px = g + (size_t)(rx0 + x) * 3;
+                            I = ((float)px[0] + (float)px[1] + (float)px[2]) * (1.0f / 765.0f);
+                        }
+                        else
+                        {
+                            I = (float)g[rx0 + x] * (1.0f / 255.0f);
+                        }
+                        gray[i] = I;
+
+                        const int raw = Raw(disp, x, y);
+                        const float m = (raw != 0 && raw != (int)invalidValue) ? 1.0f : 0.0f;
+                        const float p = m * (float)raw;
+
+                        ch[0][i] = m;
+                        ch[1][i] = m * I;
+                        ch[2][i] = p;
+                        ch[3][i] = m * I * I;
+                        ch[4][i] = p * I;
+                    }
+                }
+            });
+
+        for (int c = 0; c < 5; ++c) BoxSum(ch[c].data(), sum[c].data(), w, h, r, tmp);
+
+        auto WindowArea = [&](int x, int y) -> float
+            {
+                int wx = (std::min)(w - 1, x + r) - (std::max)(0, x - r) + 1;
+                int wy = (std::min)(h - 1, y + r) - (std::max)(0, y - r) + 1;
+                return (float)(wx * wy);
+            };
+
+        // coeficientes locales solo donde hay bastantes validos, pesados por cobertura
+        // reutilizamos ch 0..2 para w * a, w * b y w y ch 3..4 para media y varianza de la guia
+        std::vector<float>& wa = ch[0];
+        std::vector<float>& wb = ch[1];
+        std::vector<float>& wc = ch[2];
+        std::vector<float>& meanI = ch[3];
+        std::vector<float>& varGuide = ch[4];
+        std::vector<float> coverage(n);
+
+        Parallel::For(0, h, 16, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const size_t i = (size_t)y * w + x;
+                        const float N = sum[0][i];
+                        const float cov = N / WindowArea(x, y);
+                        coverage[i] = cov;
+
+                        if (N < 1.0f || cov < prm.minCoverage)
+                        {
+                            meanI[i] = 0.0f;
+                            varGuide[i] = -1.0f;
+                            wa[i] = 0.0f;
+                            wb[i] = 0.0f;
+                            wc[i] = 0.0f;
+                            continue;
+                        }
+
+                        const float inv = 1.0f / N;
+                        const float mI = sum[1][i] * inv;
+                        const float mp = sum[2][i] * inv;
+                        const float varI = (std::max)(0.0f, sum[3][i] * inv - mI * mI);
+                        const float covIp = sum[4][i] * inv - mI * mp;
+
+                        const float a = covIp / (varI + prm.eps);
+                        const float bb = mp - a * mI;
+
+                        meanI[i] = mI;
+                        varGuide[i] = varI;
+
+                        wa[i] = cov * a;
+                        wb[i] = cov * bb;
+                        wc[i] = cov;
+                    }
+                }
+            });
+
+        for (int c = 0; c < 3; ++c) BoxSum(ch[c].data(), sum[c].data(), w, h, r, tmp);
+
+        // salida solo dentro del ROI
+        const int ox0 = roi.x0 - rx0, ox1 = roi.x1 - rx0;
+        const int oy0 = roi.y0 - ry0, oy1 = roi.y1 - ry0;
+        const int maxRaw = disp.bpp == 8 ? 255 : 65535;
+
+        std::vector<int> before(h, 0), after(h, 0);
+
+        Parallel::For((std::max)(0, oy0), (std::min)(h, oy1), 16, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    uint8_t* row = out.bytes.data() + (size_t)(ry0 + y) * rowBytes;
+
+                    for (int x = (std::max)(0, ox0); x < (std::min)(w, ox1); ++x)
+                    {
+                        const size_t i = (size_t)y * w + x;
+                        const int raw = Raw(disp, x, y);
+                        const bool valid = raw != 0 && raw != (int)invalidValue;
+                        if (valid) before[y]++;
+
+                        int v = valid ? raw : 0;
+
+                        // un hueco solo se rellena si su gris se parece al de los validos de su ventana
+                        // si no, lo que hay alrededor es otra superficie al otro lado de un borde
+                        bool fill = false;
+                        if (!valid && coverage[i] >= prm.minCoverage)
+                        {
+                            const float dI = gray[i] - meanI[i];
+                            fill = dI * dI <= 4.0f * (varGuide[i] + prm.eps);
+                        }
+
+                        const float W = sum[2][i];
+                        if (W > 1e-6f && (valid || fill))
+                        {
+                            const float q = (sum[0][i] * gray[i] + sum[1][i]) / W;
+                            const int qi = (int)std::lround(q);
+
+                            // los validos no se mueven mas alla de maxDeltaRaw, asi no arrastramos saltos
+                            if (qi > 0 && qi <= maxRaw && qi != (int)invalidValue &&
+                                (!valid || std::abs(qi - raw) <= prm.maxDeltaRaw))
+                                v = qi;
+                        }
+
+                        if (v == 0) continue;
+                        after[y]++;
+
+                        if (disp.bpp == 8) row[rx0 + x] = (uint8_t)v;
+                        else ((uint16_t*)row)[rx0 + x] = (uint16_t)v;
+                    }
+                }
+            });
+
+        for (int y = 0; y < h; ++y)
+        {
+            stats.validBefore += before[y];
+            stats.validAfter += after[y];
+        }
+
+        return true;
+    }
+}
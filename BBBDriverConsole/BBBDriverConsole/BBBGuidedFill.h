@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BBBDisparity.h"
+#include "BBBSpeckleFilter.h"
+
+namespace BBB
+{
+    // imagen rectificada que hace de guia, mono 8 bits o RGB 24
+    struct GuideView
+    {
+        const uint8_t* data = nullptr;
+        int width = 0;
+        int height = 0;
+        int strideBytes = 0;
+        int bpp = 8;
+    };
+
+    struct GuidedFillParams
+    {
+        // ventana (2r + 1)^2 y regularizacion sobre la guia en [0, 1]
+        int radiusPx = 4;
+        float eps = 0.001f;
+
+        // fraccion minima de validos en la ventana para rellenar un hueco
+        float minCoverage = 0.4f;
+
+        // un pixel valido solo se suaviza si no se mueve mas que esto en crudo
+        int maxDeltaRaw = 1280;
+    };
+
+    struct GuidedFillStats
+    {
+        int validBefore = 0;
+        int validAfter = 0;
+    };
+
+    class GuidedFill
+    {
+    public:
+        // filtro guiado normalizado por la mascara de validos, O(1) por pixel con sumas de caja
+        // q = A * I + B con A y B lineales locales ajustados solo sobre los validos, asi el
+        // resultado sigue los bordes de la guia y no mezcla fondo y bulto a traves de ellos
+        // rellena huecos pequenos y suaviza, solo dentro del ROI y con la ventana recortada al borde
+        // out reutiliza su memoria entre frames, la entrada no se toca
+        static bool Apply(
+            const DisparityView& disp,
+            const GuideView& guide,
+            const PixelRoi& roi,
+            const GuidedFillParams& prm,
+            uint16_t invalidValue,
+            DisparityBuffer& out,
+            GuidedFillStats& stats
+        );
+    };
+}
@@ -0,0 +1,294 @@
+#include "BBBHeightMap.h"
+
+#include "BBBParallel.h"
+#include "BBBRegistration.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+namespace BBB
+{
+    // alturas positivas, como float positivo ordena igual que su patron de bits
+    // podemos hacer el max atomico sobre enteros
+    static int32_t FloatBits(float v)
+    {
+        int32_t b;
+        std::memcpy(&b, &v, sizeof(b));
+        return b;
+    }
+
+    static float BitsFloat(int32_t b)
+    {
+        float v;
+        std::memcpy(&v, &b, sizeof(v));
+        return v;
+    }
+
+    static void AtomicMaxBits(std::atomic<int32_t>& cell, int32_t v)
+    {
+        int32_t cur = cell.load(std::memory_order_relaxed);
+        while (v > cur && !cell.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+    }
+
+    // rejilla que cubre [minX, maxX] x [minZ, maxZ] con una celda de margen
+    static bool SizeGrid(float minX, float maxX, float minZ, float maxZ, float cell, HeightMapGrid& out)
+    {
+        const int cols = (int)std::ceil((maxX - minX) / cell) + 2;
+        const int rows = (int)std::ceil((maxZ - minZ) / cell) + 2;
+
+        if (cols <= 0 || rows <= 0 || cols > 4096 || rows > 4096)
+        {
+            std::cout << "Mapa de alturas demasiado grande " << cols << " x " << rows << " celdas, subir heightMapCellM\n";
+            return false;
+        }
+
+        out.cols = cols;
+        out.rows = rows;
+        out.cellM = cell;
+        out.originX = minX - cell;
+        out.originZ = minZ - cell;
+        return true;
+    }
+
+    bool HeightMap::BuildFromDisparity(
+        const DisparityView& disp,
+        const Scan3DParams& s3d,
+        float baselineM,
+        const PixelRoi& roi,
+        const BBBParams& p,
+        const BBBCameraMount& mount,
+        HeightMapGrid& out)
+    {
+        const float focal = s3d.focal;
+        const float cell = p.heightMapCellM;
+
+        if (!disp.data || focal <= 1e-6f || baselineM <= 1e-9f || cell <= 1e-4f) return false;
+
+        const Rigid T = Registration::MountToWorld(mount);
+
+        const float zMin = (std::max)(p.minRangeM, 1e-3f);
+        const float zMax = (std::min)(p.maxRangeM, p.hardMaxZM);
+        if (zMax <= zMin) return false;
+
+        // extension de la rejilla con los rayos de las esquinas del ROI
+        // cortamos cada rayo en el suelo o en el rango maximo
+        float minX = T.t[0], maxX = T.t[0];
+        float minZ = T.t[2], maxZ = T.t[2];
+
+        const int cu[2] = { roi.x0, roi.x1 };
+        const int cv[2] = { roi.y0, roi.y1 };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                float rx = ((float)cu[i] - s3d.principalU) / focal;
+                float ry = ((float)cv[j] - s3d.principalV) / focal;
+
+                float wx = T.r[0] * rx + T.r[1] * ry + T.r[2];
+                float wy = T.r[3] * rx + T.r[4] * ry + T.r[5];
+                float wz = T.r[6] * rx + T.r[7] * ry + T.r[8];
+
+                float zFar = zMax;
+                if (wy < -1e-6f) zFar = std::clamp(-T.t[1] / wy, zMin, zMax);
+
+                for (float z : { zMin, zFar })
+                {
+                    float gx = T.t[0] + wx * z;
+                    float gz = T.t[2] + wz * z;
+                    minX = (std::min)(minX, gx); maxX = (std::max)(maxX, gx);
+                    minZ = (std::min)(minZ, gz); maxZ = (std::max)(maxZ, gz);
+                }
+            }
+        }
+
+        if (!SizeGrid(minX, maxX, minZ, maxZ, cell, out)) return false;
+
+        const int cols = out.cols;
+        const int rows = out.rows;
+        const size_t nCells = (size_t)cols * (size_t)rows;
+        std::unique_ptr<std::atomic<int32_t>[]> cells(new std::atomic<int32_t>[nCells]);
+        for (size_t i = 0; i < nCells; ++i) cells[i].store(0, std::memory_order_relaxed);
+
+        const int step = (std::max)(1, p.decimationFactor);
+        const float fb = focal * baselineM;
+        const float invCell = 1.0f / cell;
+        const float minH = p.groundMinHeightM;
+        const uint16_t inv = s3d.invalidFlag ? (uint16_t)s3d.invalidValue : 0;
+
+        const int nRows = (roi.y1 - roi.y0 + step - 1) / step;
+
+        Parallel::For(0, nRows, 4, [&](int rb, int re)
+            {
+                for (int r = rb; r < re; ++r)
+                {
+                    const int y = roi.y0 + r * step;
+                    const float ry = ((float)y - s3d.principalV) / focal;
+
+                    // parte de la fila que no depende de x
+                    const float bx = T.r[1] * ry + T.r[2];
+                    const float by = T.r[4] * ry + T.r[5];
+                    const float bz = T.r[7] * ry + T.r[8];
+
+                    for (int x = roi.x0; x < roi.x1; x += step)
+                    {
+                        uint16_t raw = disp.RawAt(x, y);
+                        if (raw == 0 || raw == inv) continue;
+
+                        float d = (float)raw * s3d.scale + s3d.offset;
+                        if (d <= 1e-6f) continue;
+
+                        float z = fb / d;
+                        if (z < zMin || z > zMax) continue;
+
+                        float rx = ((float)x - s3d.principalU) / focal;
+
+                        float hW = T.t[1] + (T.r[3] * rx + by) * z;
+                        if (!(hW >= minH)) continue;
+
+                        float gx = T.t[0] + (T.r[0] * rx + bx) * z;
+                        float gz = T.t[2] + (T.r[6] * rx + bz) * z;
+
+                        int ci = (int)((gx - out.originX) * invCell);
+                        int cj = (int)((gz - out.originZ) * invCell);
+                        if (ci < 0 || cj < 0 || ci >= cols || cj >= rows) continue;
+
+                        AtomicMaxBits(cells[(size_t)cj * cols + ci], FloatBits(hW));
+                    }
+                }
+            });
+
+        out.h.resize(nCells);
+        for (size_t i = 0; i < nCells; ++i)
+            out.h[i] = BitsFloat(cells[i].load(std::memory_order_relaxed));
+
+        return true;
+    }
+
+    bool HeightMap::BuildFromPoints(
+        const std::vector<Pt>& pts,
+        const BBBParams& p,
+        const BBBCameraMount& mount,
+        HeightMapGrid& out)
+    {
+        const float cell = p.heightMapCellM;
+        if (pts.empty() || cell <= 1e-4f) return false;
+
+        const Rigid T = Registration::MountToWorld(mount);
+        const float minH = p.groundMinHeightM;
+
+        // sin rayos de esquina la extension sale de los propios puntos sobre el suelo
+        float minX = std::numeric_limits<float>::max(), maxX = -minX;
+        float minZ = minX, maxZ = -minX;
+        int above = 0;
+
+        for (const Pt& q : pts)
+        {
+            float hW = T.t[1] + T.r[3] * q.x + T.r[4] * q.y + T.r[5] * q.z;
+            if (!(hW >= minH)) continue;
+
+            float gx = T.t[0] + T.r[0] * q.x + T.r[1] * q.y + T.r[2] * q.z;
+            float gz = T.t[2] + T.r[6] * q.x + T.r[7] * q.y + T.r[8] * q.z;
+            minX = (std::min)(minX, gx); maxX = (std::max)(maxX, gx);
+            minZ = (std::min)(minZ, gz); maxZ = (std::max)(maxZ, gz);
+            above++;
+        }
+
+        if (above == 0) return false;
+        if (!SizeGrid(minX, maxX, minZ, maxZ, cell, out)) return false;
+
+        const int cols = out.cols;
+        const int rows = out.rows;
+        const size_t nCells = (size_t)cols * (size_t)rows;
+        std::unique_ptr<std::atomic<int32_t>[]> cells(new std::atomic<int32_t>[nCells]);
+        for (size_t i = 0; i < nCells; ++i) cells[i].store(0, std::memory_order_relaxed);
+
+        const float invCell = 1.0f / cell;
+
+        Parallel::For(0, (int)pts.size(), 4096, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& q = pts[i];
+
+                    float hW = T.t[1] + T.r[3] * q.x + T.r[4] * q.y + T.r[5] * q.z;
+                    if (!(hW >= minH)) continue;
+
+                    float gx = T.t[0] + T.r[0] * q.x + T.r[1] * q.y + T.r[2] * q.z;
+                    float gz = T.t[2] + T.r[6] * q.x + T.r[7] * q.y + T.r[8] * q.z;
+
+                    int ci = (int)((gx - out.originX) * invCell);
+                    int cj = (int)((gz - out.originZ) * invCell);
+                    if (ci < 0 || cj < 0 || ci >= cols || cj >= rows) continue;
+
+                    AtomicMaxBits(cells[(size_t)cj * cols + ci], FloatBits(hW));
+                }
+            });
+
+        out.h.resize(nCells);
+        for (size_t i = 0; i < nCells; ++i)
+            out.h[i] = BitsFloat(cells[i].load(std::memory_order_relaxed));
+
+        return true;
+    }
+
+    HeightMapStats HeightMap::Measure(const HeightMapGrid& grid, float minHeightM, int minNeighbors)
+    {
+        HeightMapStats st;
+        if (grid.cols <= 0 || grid.rows <= 0) return st;
+
+        const int cols = grid.cols;
+        const int rows = grid.rows;
+        const float area = grid.cellM * grid.cellM;
+
+        auto Occ = [&](int i, int j) -> bool
+            {
+                if (i < 0 || j < 0 || i >= cols || j >= rows) return false;
+                return grid.h[(size_t)j * cols + i] >= minHeightM;
+            };
+
+        int iMin = cols, iMax = -1, jMin = rows, jMax = -1;
+        double vol = 0.0;
+
+        for (int j = 0; j < rows; ++j)
+        {
+            for (int i = 0; i < cols; ++i)
+            {
+                if (!Occ(i, j)) continue;
+
+                // quitamos celdas sueltas que suelen ser ruido de disparidad
+                int nb = 0;
+                for (int dj = -1; dj <= 1; ++dj)
+                    for (int di = -1; di <= 1; ++di)
+                        if ((di || dj) && Occ(i + di, j + dj)) nb++;
+                if (nb < minNeighbors) continue;
+
+                float hv = grid.h[(size_t)j * cols + i];
+
+                st.occupiedCells++;
+                st.maxHeightM = (std::max)(st.maxHeightM, hv);
+                vol += (double)hv * area;
+
+                iMin = (std::min)(iMin, i); iMax = (std::max)(iMax, i);
+                jMin = (std::min)(jMin, j); jMax = (std::max)(jMax, j);
+            }
+        }
+
+        st.footprintM2 = st.occupiedCells * area;
+        st.volumeM3 = (float)vol;
+
+        if (st.occupiedCells > 0)
+        {
+            st.widthXM = (iMax - iMin + 1) * grid.cellM;
+            st.lengthZM = (jMax - jMin + 1) * grid.cellM;
+        }
+
+        return st;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "BBBConfig.h"
+#include "BBBDisparity.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // rejilla 2.5D sobre el suelo del arco, altura maxima por celda
+    // columnas en X lateral y filas en Z delante, celdas vacias a 0
+    struct HeightMapGrid
+    {
+        int cols = 0;
+        int rows = 0;
+        float cellM = 0.01f;
+        float originX = 0.0f;
+        float originZ = 0.0f;
+        std::vector<float> h;
+    };
+
+    struct HeightMapStats
+    {
+        int occupiedCells = 0;
+        float footprintM2 = 0.0f;
+        float maxHeightM = 0.0f;
+        float volumeM3 = 0.0f;
+
+        // extension de la huella en los ejes del arco
+        float widthXM = 0.0f;
+        float lengthZM = 0.0f;
+    };
+
+    class HeightMap
+    {
+    public:
+        // rasterizamos la disparidad directamente a la rejilla en una pasada paralela por filas
+        // sin construir la nube, cada pixel valido por encima de groundMinHeightM deja su altura maxima
+        static bool BuildFromDisparity(
+            const DisparityView& disp,
+            const Scan3DParams& s3d,
+            float baselineM,
+            const PixelRoi& roi,
+            const BBBParams& p,
+            const BBBCameraMount& mount,
+            HeightMapGrid& out
+        );
+
+        // misma rejilla desde una nube ya en camara, para el Coord3D que calcula la camara
+        static bool BuildFromPoints(
+            const std::vector<Pt>& pts,
+            const BBBParams& p,
+            const BBBCameraMount& mount,
+            HeightMapGrid& out
+        );
+
+        // huella altura y volumen en O(celdas)
+        // una celda cuenta si tiene al menos minNeighbors vecinas ocupadas de sus 8
+        static HeightMapStats Measure(const HeightMapGrid& grid, float minHeightM, int minNeighbors);
+    };
+}
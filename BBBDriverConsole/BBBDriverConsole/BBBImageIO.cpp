@@ -2,6 +2,10 @@
 
 #include <fstream>
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstring>
 
 namespace BBB
 {
@@ -54,4 +58,91 @@ namespace BBB
 
         return true;
     }
+
+    bool ImageIO::SavePGM16_BE(const DisparityBuffer& buf, const std::string& filePath)
+    {
+        if (buf.bpp != 16 || buf.bytes.empty()) return false;
+
+        std::ofstream f(filePath, std::ios::binary);
+        if (!f.is_open()) return false;
+
+        f << "P5\n" << buf.width << " " << buf.height << "\n65535\n";
+
+        std::vector<unsigned char> be((size_t)buf.width * 2);
+        for (int y = 0; y < buf.height; ++y)
+        {
+            const uint16_t* row = (const uint16_t*)(buf.bytes.data() + (size_t)y * buf.strideBytes);
+            for (int x = 0; x < buf.width; ++x)
+            {
+                be[2 * x] = (unsigned char)(row[x] >> 8);
+                be[2 * x + 1] = (unsigned char)(row[x] & 0xFF);
+            }
+            f.write((const char*)be.data(), (std::streamsize)be.size());
+        }
+
+        return true;
+    }
+
+    // siguiente numero de la cabecera saltando espacios y comentarios
+    static bool ReadPgmInt(std::istream& f, int& v)
+    {
+        int c = f.get();
+        while (c != EOF)
+        {
+            if (c == '#')
+            {
+                while (c != EOF && c != '\n') c = f.get();
+            }
+            else if (!std::isspace(c))
+            {
+                break;
+            }
+            c = f.get();
+        }
+        if (c == EOF || !std::isdigit(c)) return false;
+
+        v = 0;
+        while (c != EOF && std::isdigit(c))
+        {
+            v = v * 10 + (c - '0');
+            c = f.get();
+        }
+        // el espacio tras maxval es el unico separador antes de los datos
+        return true;
+    }
+
+    bool ImageIO::LoadPGM(const std::string& filePath, DisparityBuffer& out)
+    {
+        std::ifstream f(filePath, std::ios::binary);
+        if (!f.is_open()) return false;
+
+        char magic[2] = { 0, 0 };
+        f.read(magic, 2);
+        if (magic[0] != 'P' || magic[1] != '5') return false;
+
+        int w = 0, h = 0, maxVal = 0;
+        if (!ReadPgmInt(f, w) || !ReadPgmInt(f, h) || !ReadPgmInt(f, maxVal)) return false;
+        if (w <= 0 || h <= 0 || maxVal <= 0 || maxVal > 65535) return false;
+
+        out.width = w;
+        out.height = h;
+        out.bpp = maxVal < 256 ? 8 : 16;
+        out.strideBytes = w * (out.bpp / 8);
+        out.bytes.resize((size_t)out.strideBytes * h);
+
+        f.read((char*)out.bytes.data(), (std::streamsize)out.bytes.size());
+        if (f.gcount() != (std::streamsize)out.bytes.size()) return false;
+
+        if (out.bpp == 16)
+        {
+            uint8_t* p = out.bytes.data();
+            for (size_t i = 0; i + 1 < out.bytes.size(); i += 2)
+            {
+                uint16_t v = (uint16_t)((p[i] << 8) | p[i + 1]);
+                std::memcpy(p + i, &v, 2);
+            }
+        }
+
+        return true;
+    }
 }
@@ -4,6 +4,8 @@
 
 #include "Spinnaker.h"
 
+#include "BBBSpeckleFilter.h"
+
 namespace BBB
 {
     class ImageIO
@@ -14,5 +16,10 @@ namespace BBB
 
         // guardamos PGM 16 bits big endian
         static bool SavePGM16_BE(const Spinnaker::ImagePtr& img, const std::string& filePath);
+        static bool SavePGM16_BE(const DisparityBuffer& buf, const std::string& filePath);
+
+        // leemos PGM binario de 8 o 16 bits, el de 16 lo pasamos de big endian a memoria
+        // sirve para reprocesar pares y disparidades guardadas sin camara
+        static bool LoadPGM(const std::string& filePath, DisparityBuffer& out);
     };
 }
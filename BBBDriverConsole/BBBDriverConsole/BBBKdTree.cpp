@@ -0,0 +1,384 @@
+#include "BBBKdTree.h"
+
+#include "BBBParallel.h"
+#include "BBBSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace BBB
+{
+    static const int kMaxLeaf = 64;
+
+    // insercion en la lista ordenada de los k mejores
+    static void PushBest(int k, int& n, int* bestIdx, float* bestD2, int id, float d2)
+    {
+        int j = (n < k) ? n++ : k - 1;
+        while (j > 0 && bestD2[j - 1] > d2)
+        {
+            bestD2[j] = bestD2[j - 1];
+            bestIdx[j] = bestIdx[j - 1];
+            j--;
+        }
+        bestD2[j] = d2;
+        bestIdx[j] = id;
+    }
+
+    void KdTree::Build(const std::vector<Pt>& pts, int leafSizeIn)
+    {
+        leafSize = std::clamp(leafSizeIn, 1, kMaxLeaf);
+
+        const int n = (int)pts.size();
+
+        std::vector<BuildPt> work(n);
+        Parallel::For(0, n, 16384, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    work[i].p[0] = pts[i].x;
+                    work[i].p[1] = pts[i].y;
+                    work[i].p[2] = pts[i].z;
+                    work[i].i = i;
+                }
+            });
+
+        axis.assign(n, 0);
+        alive.clear();
+        BuildRange(work, 0, n, 0);
+
+        xs.resize(n); ys.resize(n); zs.resize(n); idx.resize(n);
+        Parallel::For(0, n, 16384, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    xs[i] = work[i].p[0];
+                    ys[i] = work[i].p[1];
+                    zs[i] = work[i].p[2];
+                    idx[i] = work[i].i;
+                }
+            });
+    }
+
+    void KdTree::BuildRange(std::vector<BuildPt>& work, int b, int e, int depth)
+    {
+        if (e - b <= leafSize) return;
+
+        // cortamos por el eje de mayor extension
+        float lo[3] = { +std::numeric_limits<float>::max(), +std::numeric_limits<float>::max(), +std::numeric_limits<float>::max() };
+        float hi[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+        for (int i = b; i < e; ++i)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                lo[a] = (std::min)(lo[a], work[i].p[a]);
+                hi[a] = (std::max)(hi[a], work[i].p[a]);
+            }
+        }
+
+        int ax = 0;
+        if (hi[1] - lo[1] > hi[ax] - lo[ax]) ax = 1;
+        if (hi[2] - lo[2] > hi[ax] - lo[ax]) ax = 2;
+
+        const int m = (b + e) / 2;
+        std::nth_element(work.begin() + b, work.begin() + m, work.begin() + e, [ax](const BuildPt& p, const BuildPt& q)
+            {
+                return p.p[ax] < q.p[ax];
+            });
+        axis[m] = (uint8_t)ax;
+
+        // los dos lados en paralelo mientras merezca la pena
+        if (e - b > 32768 && depth < 10)
+        {
+            Parallel::For(0, 2, 1, [&](int sb, int se)
+                {
+                    for (int s = sb; s < se; ++s)
+                    {
+                        if (s == 0) BuildRange(work, b, m, depth + 1);
+                        else BuildRange(work, m + 1, e, depth + 1);
+                    }
+                });
+        }
+        else
+        {
+            BuildRange(work, b, m, depth + 1);
+            BuildRange(work, m + 1, e, depth + 1);
+        }
+    }
+
+    void KdTree::SetMask(const std::vector<uint8_t>* keep)
+    {
+        if (!keep)
+        {
+            alive.clear();
+            return;
+        }
+
+        const int n = (int)idx.size();
+        alive.resize(n);
+        for (int pos = 0; pos < n; ++pos)
+            alive[pos] = idx[pos] < (int)keep->size() ? (*keep)[idx[pos]] : 0;
+    }
+
+    void KdTree::BucketD2(int b, int e, const float q[3], float* out) const
+    {
+        int i = b;
+
+#if defined(BBB_SIMD_SSE2)
+        const __m128 qx = _mm_set1_ps(q[0]);
+        const __m128 qy = _mm_set1_ps(q[1]);
+        const __m128 qz = _mm_set1_ps(q[2]);
+
+        for (; i + 4 <= e; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(&xs[i]), qx);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(&ys[i]), qy);
+            __m128 dz = _mm_sub_ps(_mm_loadu_ps(&zs[i]), qz);
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            _mm_storeu_ps(out + (i - b), d2);
+        }
+#endif
+
+        for (; i < e; ++i)
+        {
+            float dx = xs[i] - q[0], dy = ys[i] - q[1], dz = zs[i] - q[2];
+            out[i - b] = dx * dx + dy * dy + dz * dz;
+        }
+    }
+
+    void KdTree::KnnRange(int b, int e, const float q[3], float rd, float off[3], float bound, int k, int& n, int* bestIdx, float* bestD2) const
+    {
+        if (e - b <= leafSize)
+        {
+            float d2[kMaxLeaf];
+            BucketD2(b, e, q, d2);
+
+            for (int i = b; i < e; ++i)
+            {
+                const float worst = (n < k) ? bound : bestD2[k - 1];
+                if (d2[i - b] < worst && Alive(i)) PushBest(k, n, bestIdx, bestD2, i, d2[i - b]);
+            }
+            return;
+        }
+
+        const int m = (b + e) / 2;
+        const int ax = axis[m];
+        const float split = ax == 0 ? xs[m] : (ax == 1 ? ys[m] : zs[m]);
+        const float diff = q[ax] - split;
+
+        if (Alive(m))
+        {
+            float dx = xs[m] - q[0], dy = ys[m] - q[1], dz = zs[m] - q[2];
+            float d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 < ((n < k) ? bound : bestD2[k - 1])) PushBest(k, n, bestIdx, bestD2, m, d2);
+        }
+
+        const bool left = diff < 0.0f;
+        if (left) KnnRange(b, m, q, rd, off, bound, k, n, bestIdx, bestD2);
+        else KnnRange(m + 1, e, q, rd, off, bound, k, n, bestIdx, bestD2);
+
+        // distancia incremental a la caja del otro lado, cambia solo el eje del corte
+        const float oldOff = off[ax];
+        const float rdFar = rd - oldOff * oldOff + diff * diff;
+
+        if (rdFar < ((n < k) ? bound : bestD2[k - 1]))
+        {
+            off[ax] = diff;
+            if (left) KnnRange(m + 1, e, q, rdFar, off, bound, k, n, bestIdx, bestD2);
+            else KnnRange(b, m, q, rdFar, off, bound, k, n, bestIdx, bestD2);
+            off[ax] = oldOff;
+        }
+    }
+
+    int KdTree::Knn(float qx, float qy, float qz, int k, int* outIdx, float* outD2) const
+    {
+        if (k <= 0 || idx.empty()) return 0;
+
+        const float q[3] = { qx, qy, qz };
+        float off[3] = { 0, 0, 0 };
+        int n = 0;
+        KnnRange(0, (int)idx.size(), q, 0.0f, off, std::numeric_limits<float>::infinity(), k, n, outIdx, outD2);
+
+        // de posicion en el arbol a indice original
+        for (int i = 0; i < n; ++i) outIdx[i] = idx[outIdx[i]];
+        return n;
+    }
+
+    bool KdTree::Nearest(float qx, float qy, float qz, float maxD2, int& outIdx, float& outD2) const
+    {
+        if (idx.empty()) return false;
+
+        const float q[3] = { qx, qy, qz };
+        float off[3] = { 0, 0, 0 };
+        int n = 0;
+        int bi = -1;
+        float bd = maxD2;
+        KnnRange(0, (int)idx.size(), q, 0.0f, off, maxD2, 1, n, &bi, &bd);
+        if (n == 0) return false;
+
+        outIdx = idx[bi];
+        outD2 = bd;
+        return true;
+    }
+
+    template <class F>
+    void KdTree::RadiusRange(int b, int e, const float q[3], float r2, F&& f) const
+    {
+        // pila explicita, f devuelve false para cortar
+        struct Range { int b, e; };
+        Range stack[64];
+        int top = 0;
+        stack[top++] = { b, e };
+
+        while (top > 0)
+        {
+            Range rg = stack[--top];
+            if (rg.e <= rg.b) continue;
+
+            if (rg.e - rg.b <= leafSize)
+            {
+                float d2[kMaxLeaf];
+                BucketD2(rg.b, rg.e, q, d2);
+                for (int i = rg.b; i < rg.e; ++i)
+                    if (d2[i - rg.b] <= r2 && Alive(i) && !f(i)) return;
+                continue;
+            }
+
+            const int m = (rg.b + rg.e) / 2;
+            const int ax = axis[m];
+            const float split = ax == 0 ? xs[m] : (ax == 1 ? ys[m] : zs[m]);
+            const float diff = q[ax] - split;
+
+            float dx = xs[m] - q[0], dy = ys[m] - q[1], dz = zs[m] - q[2];
+            if (dx * dx + dy * dy + dz * dz <= r2 && Alive(m) && !f(m)) return;
+
+            // la profundidad del arbol no pasa de 64 con enteros de 32 bits
+            if (diff * diff <= r2 || diff < 0.0f) stack[top++] = { rg.b, m };
+            if (diff * diff <= r2 || diff >= 0.0f) stack[top++] = { m + 1, rg.e };
+        }
+    }
+
+    int KdTree::RadiusCount(float qx, float qy, float qz, float r, int maxCount) const
+    {
+        if (idx.empty()) return 0;
+
+        const float q[3] = { qx, qy, qz };
+        int c = 0;
+        RadiusRange(0, (int)idx.size(), q, r * r, [&](int)
+            {
+                c++;
+                return maxCount <= 0 || c < maxCount;
+            });
+        return c;
+    }
+
+    void KdTree::RadiusSearch(float qx, float qy, float qz, float r, std::vector<int>& out) const
+    {
+        out.clear();
+        if (idx.empty()) return;
+
+        const float q[3] = { qx, qy, qz };
+        RadiusRange(0, (int)idx.size(), q, r * r, [&](int pos)
+            {
+                out.push_back(idx[pos]);
+                return true;
+            });
+    }
+
+    void KdTree::BoxRange(int b, int e, const float mn[3], const float mx[3], std::vector<int>& out) const
+    {
+        auto Inside = [&](int i) -> bool
+            {
+                return xs[i] >= mn[0] && xs[i] <= mx[0] &&
+                    ys[i] >= mn[1] && ys[i] <= mx[1] &&
+                    zs[i] >= mn[2] && zs[i] <= mx[2];
+            };
+
+        if (e - b <= leafSize)
+        {
+            for (int i = b; i < e; ++i)
+                if (Inside(i) && Alive(i)) out.push_back(idx[i]);
+            return;
+        }
+
+        const int m = (b + e) / 2;
+        const int ax = axis[m];
+        const float split = ax == 0 ? xs[m] : (ax == 1 ? ys[m] : zs[m]);
+
+        if (Inside(m) && Alive(m)) out.push_back(idx[m]);
+        if (mn[ax] <= split) BoxRange(b, m, mn, mx, out);
+        if (mx[ax] >= split) BoxRange(m + 1, e, mn, mx, out);
+    }
+
+    void KdTree::BoxSearch(const float mn[3], const float mx[3], std::vector<int>& out) const
+    {
+        out.clear();
+        if (idx.empty()) return;
+        BoxRange(0, (int)idx.size(), mn, mx, out);
+    }
+
+    void KdTree::MeanKnnDistanceAll(int k, std::vector<float>& meanDist) const
+    {
+        const int n = (int)idx.size();
+        meanDist.assign(n, -1.0f);
+        if (n == 0 || k <= 0) return;
+
+        // uno mas porque el propio punto sale el primero a distancia cero
+        const int kq = (std::min)(k + 1, n);
+
+        Parallel::For(0, n, 1024, [&](int b, int e)
+            {
+                std::vector<int> bi(kq);
+                std::vector<float> bd(kq);
+
+                for (int pos = b; pos < e; ++pos)
+                {
+                    if (!Alive(pos)) continue;
+
+                    const float q[3] = { xs[pos], ys[pos], zs[pos] };
+                    float off[3] = { 0, 0, 0 };
+                    int got = 0;
+                    KnnRange(0, n, q, 0.0f, off, std::numeric_limits<float>::infinity(), kq, got, bi.data(), bd.data());
+
+                    double s = 0.0;
+                    int c = 0;
+                    for (int j = 0; j < got; ++j)
+                    {
+                        if (bi[j] == pos) continue;
+                        s += std::sqrt(bd[j]);
+                        c++;
+                    }
+
+                    meanDist[idx[pos]] = c > 0 ? (float)(s / c) : 0.0f;
+                }
+            });
+    }
+
+    void KdTree::RadiusCountAll(float r, int maxCount, std::vector<int>& counts) const
+    {
+        const int n = (int)idx.size();
+        counts.assign(n, -1);
+        if (n == 0) return;
+
+        const float r2 = r * r;
+
+        Parallel::For(0, n, 1024, [&](int b, int e)
+            {
+                for (int pos = b; pos < e; ++pos)
+                {
+                    if (!Alive(pos)) continue;
+
+                    const float q[3] = { xs[pos], ys[pos], zs[pos] };
+                    int c = 0;
+                    RadiusRange(0, n, q, r2, [&](int j)
+                        {
+                            if (j == pos) return true;
+                            c++;
+                            return maxCount <= 0 || c < maxCount;
+                        });
+
+                    counts[idx[pos]] = c;
+                }
+            });
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // indice espacial compartido, se construye una vez por nube y lo usan filtros y registro
+    // k-d tree implicito, sin nodos
+    // los puntos se reordenan de forma que el rango [b, e) de cada subarbol tiene su corte en la mediana
+    // (b + e) / 2 y los rangos de leafSize o menos son cubetas que se recorren enteras con SSE2
+    // coordenadas en SoA contiguas, una consulta toca memoria casi secuencial
+    // las consultas son const y se pueden lanzar desde varios hilos, SetMask no
+    class KdTree
+    {
+    public:
+        // construimos en paralelo los niveles altos, leafSize entre 1 y 64
+        void Build(const std::vector<Pt>& pts, int leafSize = 16);
+
+        int Size() const { return (int)idx.size(); }
+
+        // mascara por indice original, los puntos a 0 no salen en ninguna consulta
+        // la copiamos en orden del arbol, nullptr la quita
+        void SetMask(const std::vector<uint8_t>* keep);
+
+        // k vecinos mas cercanos, indices de la nube original y distancias al cuadrado ascendentes
+        // devolvemos cuantos hay, menos de k si la nube es pequena
+        int Knn(float qx, float qy, float qz, int k, int* outIdx, float* outD2) const;
+
+        // vecino mas cercano a menos de sqrt(maxD2), false si no hay
+        bool Nearest(float qx, float qy, float qz, float maxD2, int& outIdx, float& outD2) const;
+
+        // vecinos a radio r o menos, paramos al llegar a maxCount si es mayor que cero
+        int RadiusCount(float qx, float qy, float qz, float r, int maxCount) const;
+        void RadiusSearch(float qx, float qy, float qz, float r, std::vector<int>& out) const;
+
+        // puntos dentro de la caja [mn, mx]
+        void BoxSearch(const float mn[3], const float mx[3], std::vector<int>& out) const;
+
+        // consultas por lotes sobre los propios puntos en orden del arbol, resultado por indice original
+        // los puntos fuera de la mascara no consultan y salen con -1
+        void MeanKnnDistanceAll(int k, std::vector<float>& meanDist) const;
+        void RadiusCountAll(float r, int maxCount, std::vector<int>& counts) const;
+
+    private:
+        struct BuildPt
+        {
+            float p[3];
+            int i;
+        };
+
+        void BuildRange(std::vector<BuildPt>& work, int b, int e, int depth);
+
+        // distancias al cuadrado de la cubeta [b, e) a q
+        void BucketD2(int b, int e, const float q[3], float* out) const;
+
+        bool Alive(int pos) const { return alive.empty() || alive[pos] != 0; }
+
+        // rd distancia al cuadrado de la consulta a la caja del rango y off su desglose por eje
+        // bound radio al cuadrado maximo mientras no tenemos k
+        void KnnRange(int b, int e, const float q[3], float rd, float off[3], float bound, int k, int& n, int* bestIdx, float* bestD2) const;
+
+        // posiciones en el arbol, no indices originales
+        template <class F>
+        void RadiusRange(int b, int e, const float q[3], float r2, F&& f) const;
+
+        void BoxRange(int b, int e, const float mn[3], const float mx[3], std::vector<int>& out) const;
+
+        int leafSize = 16;
+
+        std::vector<float> xs, ys, zs;
+        std::vector<int> idx;
+
+        // eje de corte de cada rango guardado en la posicion de su mediana
+        std::vector<uint8_t> axis;
+
+        // mascara en orden del arbol, vacia es todo vivo
+        std::vector<uint8_t> alive;
+    };
+}
@@ -0,0 +1,149 @@
+#include "BBBLatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace BBB
+{
+    static const int kSubBits = LatencyHistogram::kSubBits;
+    static const int kSub = 1 << kSubBits;
+    static const int kMaxExp = LatencyHistogram::kMaxExp;
+    static const int kBuckets = LatencyHistogram::kBucketCount;
+
+    LatencyHistogram::LatencyHistogram() : buckets(kBuckets, 0)
+    {
+    }
+
+    LatencyHistogram LatencyHistogram::FromCounts(const uint64_t* counts, uint64_t count,
+        double sumUs, double sumSqUs, double minUs, double maxUs)
+    {
+        LatencyHistogram h;
+        std::copy(counts, counts + kBuckets, h.buckets.begin());
+        h.count = count;
+        h.sumUs = sumUs;
+        h.sumSqUs = sumSqUs;
+        h.minUs = minUs;
+        h.maxUs = maxUs;
+        return h;
+    }
+
+    void LatencyHistogram::Merge(const LatencyHistogram& o)
+    {
+        if (o.count == 0) return;
+
+        for (int b = 0; b < kBuckets; ++b) buckets[b] += o.buckets[b];
+
+        if (count == 0 || o.minUs < minUs) minUs = o.minUs;
+        maxUs = (std::max)(maxUs, o.maxUs);
+        count += o.count;
+        sumUs += o.sumUs;
+        sumSqUs += o.sumSqUs;
+    }
+
+    int LatencyHistogram::BucketOf(uint64_t us)
+    {
+        // lo que pase del maximo va a la ultima cubeta
+        if (us < (uint64_t)kSub) return (int)us;
+
+        int msb = 0;
+        for (uint64_t v = us; v > 1; v >>= 1) msb++;
+        if (msb > kMaxExp) return kBuckets - 1;
+
+        const int sub = (int)((us >> (msb - kSubBits)) & (kSub - 1));
+        return (msb - kSubBits + 1) * kSub + sub;
+    }
+
+    uint64_t LatencyHistogram::BucketUpper(int b)
+    {
+        if (b < kSub) return (uint64_t)b;
+
+        const int msb = b / kSub + kSubBits - 1;
+        const uint64_t sub = (uint64_t)(b % kSub);
+        return ((kSub + sub + 1) << (msb - kSubBits)) - 1;
+    }
+
+    void LatencyHistogram::Add(double us)
+    {
+        if (!(us >= 0.0)) us = 0.0;
+
+        buckets[BucketOf((uint64_t)us)]++;
+
+        if (count == 0 || us < minUs) minUs = us;
+        if (us > maxUs) maxUs = us;
+        count++;
+        sumUs += us;
+        sumSqUs += us * us;
+    }
+
+    void LatencyHistogram::Clear()
+    {
+        std::fill(buckets.begin(), buckets.end(), 0);
+        count = 0;
+        sumUs = sumSqUs = minUs = maxUs = 0.0;
+    }
+
+    double LatencyHistogram::StdDev() const
+    {
+        if (count < 2) return 0.0;
+        const double m = Mean();
+        return std::sqrt((std::max)(0.0, sumSqUs / (double)count - m * m));
+    }
+
+    double LatencyHistogram::Percentile(double p) const
+    {
+        if (count == 0) return 0.0;
+
+        const uint64_t rank = (uint64_t)std::ceil((std::min)(100.0, (std::max)(0.0, p)) / 100.0 * (double)count);
+        uint64_t acc = 0;
+        for (int b = 0; b < kBuckets; ++b)
+        {
+            acc += buckets[b];
+            if (acc >= rank && acc > 0)
+                return (std::min)((double)BucketUpper(b), maxUs);
+        }
+        return maxUs;
+    }
+
+    void LatencyHistogram::Print(std::ostream& os, const std::string& label, bool bars) const
+    {
+        const std::ios::fmtflags flags = os.flags();
+        const std::streamsize prec = os.precision();
+
+        os << std::fixed << std::setprecision(2)
+            << label << " n " << count
+            << " min " << Min() / 1000.0
+            << " p50 " << Percentile(50.0) / 1000.0
+            << " p90 " << Percentile(90.0) / 1000.0
+            << " p99 " << Percentile(99.0) / 1000.0
+            << " max " << Max() / 1000.0
+            << " jitter p99-p50 " << (Percentile(99.0) - Percentile(50.0)) / 1000.0
+            << " desv " << StdDev() / 1000.0 << " ms\n";
+
+        if (bars && count > 0)
+        {
+            // juntamos las cubetas por potencia de dos para que quepa en consola
+            std::vector<uint64_t> coarse;
+            for (int b = 0; b < kBuckets; ++b)
+            {
+                const size_t e = b < kSub ? (size_t)(b == 0 ? 0 : (int)std::log2((double)b) + 1) : (size_t)(b / kSub + kSubBits);
+                if (coarse.size() <= e) coarse.resize(e + 1, 0);
+                coarse[e] += buckets[b];
+            }
+
+            const uint64_t peak = *std::max_element(coarse.begin(), coarse.end());
+            for (size_t e = 0; e < coarse.size(); ++e)
+            {
+                if (coarse[e] == 0) continue;
+
+                const double upMs = (double)((uint64_t)1 << e) / 1000.0;
+                const int len = (int)std::ceil(40.0 * (double)coarse[e] / (double)peak);
+                os << "   < " << std::setw(9) << upMs << " ms " << std::setw(7) << coarse[e] << " "
+                    << std::string((size_t)len, '#') << "\n";
+            }
+        }
+
+        os.flags(flags);
+        os.precision(prec);
+    }
+}
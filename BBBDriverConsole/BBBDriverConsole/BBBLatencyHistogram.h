@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace BBB
+{
+    // histograma de latencias en microsegundos con cubetas log lineales
+    // 16 cubetas por potencia de dos, el error relativo queda por debajo del 7 por ciento
+    // lo escribe un hilo, para leerlo desde otro hace falta que ese hilo haya acabado
+    class LatencyHistogram
+    {
+    public:
+        // 16 cubetas por potencia de dos hasta 2^40 us, unos doce dias
+        static constexpr int kSubBits = 4;
+        static constexpr int kMaxExp = 40;
+        static constexpr int kBucketCount = (kMaxExp - kSubBits + 2) << kSubBits;
+
+        LatencyHistogram();
+
+        // para quien cuenta las cubetas por su cuenta, por ejemplo con atomicos por hilo
+        static int BucketOf(uint64_t us);
+        static LatencyHistogram FromCounts(const uint64_t* counts, uint64_t count,
+            double sumUs, double sumSqUs, double minUs, double maxUs);
+
+        void Merge(const LatencyHistogram& o);
+
+        void Add(double us);
+        void Clear();
+
+        uint64_t Count() const { return count; }
+        double Min() const { return count ? minUs : 0.0; }
+        double Max() const { return maxUs; }
+        double Mean() const { return count ? sumUs / (double)count : 0.0; }
+        double StdDev() const;
+
+        // p entre 0 y 100, devolvemos el limite superior de la cubeta
+        double Percentile(double p) const;
+
+        // resumen en una linea, con bars anadimos una barra por potencia de dos
+        void Print(std::ostream& os, const std::string& label, bool bars) const;
+
+    private:
+        static uint64_t BucketUpper(int b);
+
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0;
+        double sumUs = 0.0;
+        double sumSqUs = 0.0;
+        double minUs = 0.0;
+        double maxUs = 0.0;
+    };
+}
@@ -0,0 +1,309 @@
+#include "BBBMeasurement.h"
+
+#include "BBBParallel.h"
+#include "BBBRegistration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace BBB
+{
+    static float Cross(const P2& o, const P2& a, const P2& b)
+    {
+        return (a.x - o.x) * (b.z - o.z) - (a.z - o.z) * (b.x - o.x);
+    }
+
+    static float Dot2(const P2& a, float ex, float ez)
+    {
+        return a.x * ex + a.z * ez;
+    }
+
+    // percentil sin ordenar todo el vector, ojo reordena v
+    static float SelectPercentile(std::vector<float>& v, float q)
+    {
+        if (v.empty()) return 0.0f;
+
+        q = std::clamp(q, 0.0f, 1.0f);
+        float idx = q * (float)(v.size() - 1);
+        size_t i0 = (size_t)idx;
+        size_t i1 = (std::min)(i0 + 1, v.size() - 1);
+
+        std::nth_element(v.begin(), v.begin() + i0, v.end());
+        float a = v[i0];
+        float b = (i1 == i0) ? a : *std::min_element(v.begin() + i0 + 1, v.end());
+
+        float t = idx - (float)i0;
+        return a * (1.f - t) + b * t;
+    }
+
+    void Measurement::ConvexHull(std::vector<P2>& pts, std::vector<P2>& hull)
+    {
+        hull.clear();
+
+        const int n = (int)pts.size();
+        if (n < 3)
+        {
+            hull = pts;
+            return;
+        }
+
+        std::sort(pts.begin(), pts.end(), [](const P2& a, const P2& b)
+            {
+                return a.x < b.x || (a.x == b.x && a.z < b.z);
+            });
+
+        hull.resize(2 * n);
+        int k = 0;
+
+        // cadena inferior
+        for (int i = 0; i < n; ++i)
+        {
+            while (k >= 2 && Cross(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+            hull[k++] = pts[i];
+        }
+
+        // cadena superior
+        for (int i = n - 2, t = k + 1; i >= 0; --i)
+        {
+            while (k >= t && Cross(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+            hull[k++] = pts[i];
+        }
+
+        hull.resize(k - 1);
+    }
+
+    void Measurement::ConvexHullParallel(const std::vector<P2>& pts, std::vector<P2>& hull)
+    {
+        hull.clear();
+        if (pts.size() < 3)
+        {
+            hull = pts;
+            return;
+        }
+
+        // extremos en 8 direcciones, el octogono que forman queda dentro del casco
+        // y todo punto estrictamente dentro se puede tirar sin ordenar (Akl Toussaint)
+        static const float dirs[8][2] = {
+            { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+        };
+
+        int ext[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        std::mutex mtx;
+
+        Parallel::For(0, (int)pts.size(), 16384, [&](int b, int e)
+            {
+                int loc[8];
+                float best[8];
+                for (int d = 0; d < 8; ++d)
+                {
+                    loc[d] = b;
+                    best[d] = Dot2(pts[b], dirs[d][0], dirs[d][1]);
+                }
+
+                for (int i = b + 1; i < e; ++i)
+                {
+                    for (int d = 0; d < 8; ++d)
+                    {
+                        float v = Dot2(pts[i], dirs[d][0], dirs[d][1]);
+                        if (v > best[d]) { best[d] = v; loc[d] = i; }
+                    }
+                }
+
+                std::lock_guard<std::mutex> lk(mtx);
+                for (int d = 0; d < 8; ++d)
+                    if (best[d] > Dot2(pts[ext[d]], dirs[d][0], dirs[d][1])) ext[d] = loc[d];
+            });
+
+        // quitamos extremos repetidos, un lado de longitud cero lo dejaria todo fuera
+        P2 oct[8];
+        int nOct = 0;
+        for (int d = 0; d < 8; ++d)
+        {
+            const P2& q = pts[ext[d]];
+            if (nOct > 0 && oct[nOct - 1].x == q.x && oct[nOct - 1].z == q.z) continue;
+            oct[nOct++] = q;
+        }
+        while (nOct > 1 && oct[nOct - 1].x == oct[0].x && oct[nOct - 1].z == oct[0].z) nOct--;
+
+        auto InsideOct = [&](const P2& q) -> bool
+            {
+                if (nOct < 3) return false;
+                for (int d = 0; d < nOct; ++d)
+                    if (Cross(oct[d], oct[(d + 1) % nOct], q) <= 0) return false;
+                return true;
+            };
+
+        // cascos parciales sobre lo que sobrevive y casco final de sus vertices
+        std::vector<P2> merged(oct, oct + nOct);
+
+        Parallel::For(0, (int)pts.size(), 8192, [&](int b, int e)
+            {
+                std::vector<P2> part;
+                part.reserve((e - b) / 8 + 8);
+                for (int i = b; i < e; ++i)
+                    if (!InsideOct(pts[i])) part.push_back(pts[i]);
+
+                std::vector<P2> partHull;
+                ConvexHull(part, partHull);
+
+                std::lock_guard<std::mutex> lk(mtx);
+                merged.insert(merged.end(), partHull.begin(), partHull.end());
+            });
+
+        ConvexHull(merged, hull);
+    }
+
+    bool Measurement::MinAreaRect(const std::vector<P2>& hull, OrientedBox& out)
+    {
+        const int n = (int)hull.size();
+        if (n < 3) return false;
+
+        float bestArea = -1.0f;
+        float bestEx = 1, bestEz = 0;
+        float bestLen = 0, bestWid = 0;
+        float bestCx = 0, bestCz = 0;
+
+        // los tres calibres solo avanzan, la proyeccion sobre un casco convexo es unimodal
+        // cota de n pasos para no dar vueltas con empates
+        auto advance = [&](int& idx, float dx, float dz, float sign)
+            {
+                for (int s = 0; s < n; ++s)
+                {
+                    int nxt = (idx + 1) % n;
+                    if (sign * Dot2(hull[nxt], dx, dz) > sign * Dot2(hull[idx], dx, dz)) idx = nxt;
+                    else break;
+                }
+            };
+
+        int j = 0, k = 0, l = 0;
+        bool first = true;
+
+        for (int i = 0; i < n; ++i)
+        {
+            const P2& a = hull[i];
+            const P2& b = hull[(i + 1) % n];
+
+            float ex = b.x - a.x;
+            float ez = b.z - a.z;
+            float len = std::sqrt(ex * ex + ez * ez);
+            if (len < 1e-9f) continue;
+            ex /= len; ez /= len;
+
+            // normal hacia dentro, el casco va antihorario
+            float nx = -ez, nz = ex;
+
+            // en el primer lado valido buscamos los tres extremos recorriendo todo el casco
+            // el minimo sobre el lado puede ser el propio vertice i si el angulo es agudo
+            if (first)
+            {
+                for (int v = 0; v < n; ++v)
+                {
+                    if (Dot2(hull[v], ex, ez) > Dot2(hull[j], ex, ez)) j = v;
+                    if (Dot2(hull[v], nx, nz) > Dot2(hull[k], nx, nz)) k = v;
+                    if (Dot2(hull[v], ex, ez) < Dot2(hull[l], ex, ez)) l = v;
+                }
+                first = false;
+            }
+
+            // extremo mas lejano sobre el lado
+            advance(j, ex, ez, 1.0f);
+            // extremo mas lejano en la normal
+            advance(k, nx, nz, 1.0f);
+            // extremo mas atras sobre el lado
+            advance(l, ex, ez, -1.0f);
+
+            float eMin = Dot2(hull[l], ex, ez);
+            float eMax = Dot2(hull[j], ex, ez);
+            float nMin = Dot2(a, nx, nz);
+            float nMax = Dot2(hull[k], nx, nz);
+
+            float w = eMax - eMin;
+            float h = nMax - nMin;
+            float area = w * h;
+
+            if (bestArea < 0.0f || area < bestArea)
+            {
+                bestArea = area;
+                bestEx = ex; bestEz = ez;
+                bestLen = w; bestWid = h;
+
+                float ce = 0.5f * (eMin + eMax);
+                float cn = 0.5f * (nMin + nMax);
+                bestCx = ce * ex + cn * nx;
+                bestCz = ce * ez + cn * nz;
+            }
+        }
+
+        if (bestArea < 0.0f) return false;
+
+        // el largo es el lado mayor
+        float dx = bestEx, dz = bestEz;
+        if (bestWid > bestLen)
+        {
+            std::swap(bestLen, bestWid);
+            dx = -bestEz; dz = bestEx;
+        }
+
+        float yaw = std::atan2(dx, dz) * 180.0f / 3.14159265358979323846f;
+        if (yaw > 90.0f) yaw -= 180.0f;
+        if (yaw <= -90.0f) yaw += 180.0f;
+
+        out.lengthM = bestLen;
+        out.widthM = bestWid;
+        out.yawDeg = yaw;
+        out.centerX = bestCx;
+        out.centerZ = bestCz;
+        out.hullPoints = n;
+        return true;
+    }
+
+    bool Measurement::MeasureOrientedBox(
+        const std::vector<Pt>& pts,
+        const BBBCameraMount& mount,
+        float minHeightM,
+        float qHigh,
+        OrientedBox& out)
+    {
+        out = OrientedBox{};
+        if (pts.size() < 3) return false;
+
+        const Rigid T = Registration::MountToWorld(mount);
+
+        // pasamos al arco en paralelo y luego compactamos
+        std::vector<P2> ground(pts.size());
+        std::vector<float> heights(pts.size());
+
+        Parallel::For(0, (int)pts.size(), 8192, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& p = pts[i];
+                    ground[i].x = T.r[0] * p.x + T.r[1] * p.y + T.r[2] * p.z + T.t[0];
+                    heights[i] = T.r[3] * p.x + T.r[4] * p.y + T.r[5] * p.z + T.t[1];
+                    ground[i].z = T.r[6] * p.x + T.r[7] * p.y + T.r[8] * p.z + T.t[2];
+                }
+            });
+
+        size_t n = 0;
+        for (size_t i = 0; i < pts.size(); ++i)
+        {
+            if (!std::isfinite(heights[i]) || heights[i] < minHeightM) continue;
+            ground[n] = ground[i];
+            heights[n] = heights[i];
+            n++;
+        }
+        ground.resize(n);
+        heights.resize(n);
+
+        if (n < 3) return false;
+
+        std::vector<P2> hull;
+        ConvexHullParallel(ground, hull);
+
+        if (!MinAreaRect(hull, out)) return false;
+
+        out.heightM = SelectPercentile(heights, qHigh);
+        return true;
+    }
+}
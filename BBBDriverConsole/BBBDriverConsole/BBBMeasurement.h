@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "BBBConfig.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // punto proyectado en el suelo del arco, X lateral y Z delante
+    struct P2
+    {
+        float x = 0, z = 0;
+    };
+
+    // caja orientada minima sobre el suelo
+    struct OrientedBox
+    {
+        float lengthM = 0.0f;
+        float widthM = 0.0f;
+        float heightM = 0.0f;
+
+        // giro del lado largo respecto al eje Z del arco
+        float yawDeg = 0.0f;
+
+        float centerX = 0.0f;
+        float centerZ = 0.0f;
+
+        int hullPoints = 0;
+    };
+
+    class Measurement
+    {
+    public:
+        // casco convexo por cadena monotona, hull sale en sentido antihorario sin repetir el primero
+        // ojo reordena pts
+        static void ConvexHull(std::vector<P2>& pts, std::vector<P2>& hull);
+
+        // casco en paralelo por bloques y casco final sobre los vertices de cada bloque
+        static void ConvexHullParallel(const std::vector<P2>& pts, std::vector<P2>& hull);
+
+        // rectangulo de area minima con calibres rotatorios sobre el casco
+        static bool MinAreaRect(const std::vector<P2>& hull, OrientedBox& out);
+
+        // medimos el bulto en sistema camara, pasamos al arco con el montaje
+        // largo ancho y yaw por caja minima, alto por percentil qHigh de la altura
+        static bool MeasureOrientedBox(
+            const std::vector<Pt>& pts,
+            const BBBCameraMount& mount,
+            float minHeightM,
+            float qHigh,
+            OrientedBox& out
+        );
+    };
+}
@@ -0,0 +1,273 @@
+#include "BBBMetrics.h"
+
+#include "BBBProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace BBB
+{
+    struct NamedCamera
+    {
+        std::string name;
+        CameraMetrics m;
+    };
+
+    struct Gauge
+    {
+        std::string name;
+        std::string help;
+        std::string camera;
+        std::string labelKey;
+        std::string labelValue;
+        std::function<double()> read;
+    };
+
+    static std::mutex& RegistryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    // deque para que los punteros que damos no se muevan al crecer
+    static std::deque<NamedCamera>& Cameras()
+    {
+        static std::deque<NamedCamera> c;
+        return c;
+    }
+
+    static std::vector<Gauge>& Gauges()
+    {
+        static std::vector<Gauge> g;
+        return g;
+    }
+
+    CameraMetrics* Metrics::Camera(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        for (auto& c : Cameras())
+            if (c.name == name) return &c.m;
+
+        Cameras().emplace_back();
+        Cameras().back().name = name;
+        return &Cameras().back().m;
+    }
+
+    void Metrics::AddGauge(const std::string& name, const std::string& help,
+        const std::string& camera, const std::string& labelKey, const std::string& labelValue,
+        std::function<double()> read)
+    {
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        Gauges().push_back(Gauge{ name, help, camera, labelKey, labelValue, std::move(read) });
+    }
+
+    // valor de etiqueta con barra, comillas y saltos escapados como pide el formato
+    static std::string Label(const std::string& v)
+    {
+        std::string out;
+        out.reserve(v.size());
+        for (char c : v)
+        {
+            if (c == '\\') out += "\\\\";
+            else if (c == '"') out += "\\\"";
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        return out;
+    }
+
+    static void Header(std::ostringstream& os, const char* name, const char* type, const char* help)
+    {
+        os << "# HELP " << name << " " << help << "\n";
+        os << "# TYPE " << name << " " << type << "\n";
+    }
+
+    std::string Metrics::Render()
+    {
+        std::ostringstream os;
+        os << std::setprecision(9);
+
+        {
+            std::lock_guard<std::mutex> lk(RegistryMutex());
+            const auto& cams = Cameras();
+
+            struct Counter
+            {
+                const char* name;
+                const char* help;
+                std::atomic<uint64_t> CameraMetrics::* field;
+            };
+
+            const Counter counters[] = {
+                { "bbb_frames_captured_total", "Sets capturados por camara", &CameraMetrics::framesCaptured },
+                { "bbb_frames_dropped_total", "Capturas fallidas o incompletas por camara", &CameraMetrics::framesDropped },
+                { "bbb_disk_files_written_total", "Ficheros guardados por camara", &CameraMetrics::filesWritten },
+                { "bbb_disk_written_bytes_total", "Bytes guardados en disco por camara", &CameraMetrics::bytesWritten },
+            };
+
+            for (const auto& c : counters)
+            {
+                Header(os, c.name, "counter", c.help);
+                for (const auto& cam : cams)
+                    os << c.name << "{camera=\"" << Label(cam.name) << "\"} " << (cam.m.*c.field).load(std::memory_order_relaxed) << "\n";
+            }
+
+            Header(os, "bbb_measurements_total", "counter", "Medidas del bulto por camara y resultado");
+            for (const auto& cam : cams)
+            {
+                os << "bbb_measurements_total{camera=\"" << Label(cam.name) << "\",result=\"ok\"} " << cam.m.measureOk.load(std::memory_order_relaxed) << "\n";
+                os << "bbb_measurements_total{camera=\"" << Label(cam.name) << "\",result=\"fail\"} " << cam.m.measureFail.load(std::memory_order_relaxed) << "\n";
+            }
+
+            // gauges agrupadas por nombre, HELP y TYPE una vez por nombre
+            std::vector<std::string> done;
+            for (const auto& g : Gauges())
+            {
+                if (std::find(done.begin(), done.end(), g.name) != done.end()) continue;
+                done.push_back(g.name);
+
+                Header(os, g.name.c_str(), "gauge", g.help.c_str());
+                for (const auto& o : Gauges())
+                {
+                    if (o.name != g.name) continue;
+                    os << o.name << "{camera=\"" << Label(o.camera) << "\"";
+                    if (!o.labelKey.empty()) os << "," << o.labelKey << "=\"" << Label(o.labelValue) << "\"";
+                    os << "} " << o.read() << "\n";
+                }
+            }
+        }
+
+        // etapas del Profiler como summary en segundos, y puntos de entrada y salida
+        Header(os, "bbb_stage_latency_seconds", "summary", "Tiempo por etapa del ciclo");
+        std::ostringstream pin, pout;
+        for (int i = 0; i < (int)Stage::Count; ++i)
+        {
+            size_t in = 0, out = 0;
+            const LatencyHistogram h = Profiler::Snapshot((Stage)i, in, out);
+            if (h.Count() == 0) continue;
+
+            const std::string stage = Profiler::StageName((Stage)i);
+            const double q[] = { 0.5, 0.9, 0.99 };
+            for (double qq : q)
+                os << "bbb_stage_latency_seconds{stage=\"" << Label(stage) << "\",quantile=\"" << qq << "\"} "
+                << h.Percentile(qq * 100.0) / 1e6 << "\n";
+            os << "bbb_stage_latency_seconds_sum{stage=\"" << Label(stage) << "\"} " << h.Mean() * (double)h.Count() / 1e6 << "\n";
+            os << "bbb_stage_latency_seconds_count{stage=\"" << Label(stage) << "\"} " << h.Count() << "\n";
+
+            pin << "bbb_stage_points_in_total{stage=\"" << Label(stage) << "\"} " << in << "\n";
+            pout << "bbb_stage_points_out_total{stage=\"" << Label(stage) << "\"} " << out << "\n";
+        }
+
+        Header(os, "bbb_stage_points_in_total", "counter", "Puntos que entran en cada etapa");
+        os << pin.str();
+        Header(os, "bbb_stage_points_out_total", "counter", "Puntos que salen de cada etapa");
+        os << pout.str();
+
+        return os.str();
+    }
+
+    bool Metrics::WriteTextfile(const std::string& path)
+    {
+        const std::string text = Render();
+        const std::string tmp = path + ".tmp";
+
+        {
+            std::ofstream f(tmp, std::ios::binary);
+            if (!f.is_open()) return false;
+            f << text;
+            if (!f.good()) return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    // hilo que reescribe el fichero, mismo esquema que el resumen del Profiler
+    class TextfileWriter
+    {
+    public:
+        ~TextfileWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                quit = true;
+            }
+            cv.notify_all();
+            if (worker.joinable()) worker.join();
+        }
+
+        // al apagar esperamos a la escritura en curso, las gauges pueden apuntar a algo que se va a liberar
+        void Set(const std::string& p, int sec)
+        {
+            {
+                std::unique_lock<std::mutex> lk(m);
+                path = p;
+                intervalSec = (p.empty() || sec <= 0) ? 0 : sec;
+                changed = true;
+                cv.notify_all();
+
+                if (intervalSec == 0) cv.wait(lk, [&]() { return !writing; });
+            }
+
+            if (intervalSec > 0 && !worker.joinable())
+                worker = std::thread([this]() { Run(); });
+        }
+
+    private:
+        void Run()
+        {
+            bool warned = false;
+
+            std::unique_lock<std::mutex> lk(m);
+            while (!quit)
+            {
+                if (intervalSec == 0)
+                {
+                    cv.wait(lk, [&]() { return quit || changed; });
+                    changed = false;
+                    continue;
+                }
+
+                const std::string p = path;
+                writing = true;
+                lk.unlock();
+                const bool ok = Metrics::WriteTextfile(p);
+                lk.lock();
+                writing = false;
+                cv.notify_all();
+
+                if (!ok && !warned) std::cout << "No se pudieron escribir las metricas en " << p << "\n";
+                warned = !ok;
+
+                changed = false;
+                cv.wait_for(lk, std::chrono::seconds(intervalSec), [&]() { return quit || changed; });
+            }
+        }
+
+        std::mutex m;
+        std::condition_variable cv;
+        std::thread worker;
+        std::string path;
+        int intervalSec = 0;
+        bool changed = false;
+        bool writing = false;
+        bool quit = false;
+    };
+
+    void Metrics::SetTextfile(const std::string& path, int intervalSec)
+    {
+        static TextfileWriter writer;
+        writer.Set(path, intervalSec);
+    }
+}
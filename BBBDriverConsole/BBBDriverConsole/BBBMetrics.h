@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace BBB
+{
+    // contadores de una camara, se reservan al arrancar y en el ciclo solo hay fetch_add
+    struct CameraMetrics
+    {
+        std::atomic<uint64_t> framesCaptured{ 0 };
+        std::atomic<uint64_t> framesDropped{ 0 };
+        std::atomic<uint64_t> measureOk{ 0 };
+        std::atomic<uint64_t> measureFail{ 0 };
+        std::atomic<uint64_t> filesWritten{ 0 };
+        std::atomic<uint64_t> bytesWritten{ 0 };
+
+        // copia de ActiveCam::available para el hilo que escribe las metricas
+        std::atomic<bool> available{ false };
+    };
+
+    // metricas en formato texto de Prometheus
+    // un hilo reescribe el fichero cada pocos segundos para el textfile collector de node_exporter
+    // o windows_exporter, escribimos en .tmp y renombramos para que nunca lea uno a medias
+    // tiempos y puntos por etapa salen del Profiler, el tiempo de disco son las etapas escribir
+    class Metrics
+    {
+    public:
+        static void Inc(std::atomic<uint64_t>& c, uint64_t v = 1) { c.fetch_add(v, std::memory_order_relaxed); }
+
+        // una vez por camara al arrancar, el puntero vale hasta el final del proceso
+        static CameraMetrics* Camera(const std::string& name);
+
+        // gauge que se lee al escribir, por ejemplo la cola de un hilo
+        static void AddGauge(const std::string& name, const std::string& help,
+            const std::string& camera, const std::string& labelKey, const std::string& labelValue,
+            std::function<double()> read);
+
+        // texto completo tal como va al fichero
+        static std::string Render();
+
+        // path vacio o intervalo 0 para el hilo
+        static void SetTextfile(const std::string& path, int intervalSec);
+
+        static bool WriteTextfile(const std::string& path);
+    };
+}
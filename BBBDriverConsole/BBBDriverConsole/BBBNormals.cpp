@@ -0,0 +1,333 @@
+#include "BBBNormals.h"
+
+#include "BBBParallel.h"
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace BBB
+{
+    void OrganizedCloud::Reset(int w, int h, int px0, int py0, int pstep)
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const size_t n = (size_t)(std::max)(0, w) * (size_t)(std::max)(0, h);
+
+        width = w;
+        height = h;
+        x0 = px0;
+        y0 = py0;
+        step = pstep;
+
+        x.assign(n, nan);
+        y.assign(n, nan);
+        z.assign(n, nan);
+    }
+
+    bool OrganizedCloud::CropToBox(const float boxMin[3], const float boxMax[3], int marginCells, OrganizedCloud& out) const
+    {
+        auto Inside = [&](size_t k) -> bool
+            {
+                return x[k] >= boxMin[0] && x[k] <= boxMax[0] &&
+                    y[k] >= boxMin[1] && y[k] <= boxMax[1] &&
+                    z[k] >= boxMin[2] && z[k] <= boxMax[2];
+            };
+
+        int iMin = width, iMax = -1, jMin = height, jMax = -1;
+        for (int j = 0; j < height; ++j)
+        {
+            for (int i = 0; i < width; ++i)
+            {
+                if (!Inside((size_t)j * width + i)) continue;
+                iMin = (std::min)(iMin, i); iMax = (std::max)(iMax, i);
+                jMin = (std::min)(jMin, j); jMax = (std::max)(jMax, j);
+            }
+        }
+
+        if (iMax < 0)
+        {
+            out.Reset(0, 0, x0, y0, step);
+            return false;
+        }
+
+        iMin = (std::max)(0, iMin - marginCells); iMax = (std::min)(width - 1, iMax + marginCells);
+        jMin = (std::max)(0, jMin - marginCells); jMax = (std::min)(height - 1, jMax + marginCells);
+
+        out.Reset(iMax - iMin + 1, jMax - jMin + 1, x0 + iMin * step, y0 + jMin * step, step);
+
+        for (int j = jMin; j <= jMax; ++j)
+        {
+            for (int i = iMin; i <= iMax; ++i)
+            {
+                const size_t k = (size_t)j * width + i;
+                if (!Inside(k)) continue;
+
+                const size_t o = (size_t)(j - jMin) * out.width + (i - iMin);
+                out.x[o] = x[k];
+                out.y[o] = y[k];
+                out.z[o] = z[k];
+            }
+        }
+
+        return true;
+    }
+
+    // distancia en celdas al salto de profundidad mas cercano, chamfer de dos pasadas
+    static void DepthEdgeDistance(const OrganizedCloud& cloud, float maxDepthChange, std::vector<float>& dist)
+    {
+        const int w = cloud.width;
+        const int h = cloud.height;
+        const float far = 1e9f;
+
+        dist.assign((size_t)w * h, far);
+
+        auto Jump = [&](size_t a, size_t b) -> bool
+            {
+                if (!cloud.Valid((int)b)) return false;
+                return std::fabs(cloud.z[a] - cloud.z[b]) > maxDepthChange * cloud.z[a];
+            };
+
+        Parallel::For(0, h, 16, [&](int jb, int je)
+            {
+                for (int j = jb; j < je; ++j)
+                {
+                    for (int i = 0; i < w; ++i)
+                    {
+                        const size_t k = (size_t)j * w + i;
+                        if (!cloud.Valid((int)k)) continue;
+
+                        if ((i > 0 && Jump(k, k - 1)) || (i + 1 < w && Jump(k, k + 1)) ||
+                            (j > 0 && Jump(k, k - w)) || (j + 1 < h && Jump(k, k + w)))
+                            dist[k] = 0.0f;
+                    }
+                }
+            });
+
+        const float d1 = 1.0f, d2 = 1.4142135f;
+
+        for (int j = 0; j < h; ++j)
+        {
+            for (int i = 0; i < w; ++i)
+            {
+                float& d = dist[(size_t)j * w + i];
+                if (i > 0) d = (std::min)(d, dist[(size_t)j * w + i - 1] + d1);
+                if (j > 0)
+                {
+                    d = (std::min)(d, dist[(size_t)(j - 1) * w + i] + d1);
+                    if (i > 0) d = (std::min)(d, dist[(size_t)(j - 1) * w + i - 1] + d2);
+                    if (i + 1 < w) d = (std::min)(d, dist[(size_t)(j - 1) * w + i + 1] + d2);
+                }
+            }
+        }
+
+        for (int j = h - 1; j >= 0; --j)
+        {
+            for (int i = w - 1; i >= 0; --i)
+            {
+                float& d = dist[(size_t)j * w + i];
+                if (i + 1 < w) d = (std::min)(d, dist[(size_t)j * w + i + 1] + d1);
+                if (j + 1 < h)
+                {
+                    d = (std::min)(d, dist[(size_t)(j + 1) * w + i] + d1);
+                    if (i + 1 < w) d = (std::min)(d, dist[(size_t)(j + 1) * w + i + 1] + d2);
+                    if (i > 0) d = (std::min)(d, dist[(size_t)(j + 1) * w + i - 1] + d2);
+                }
+            }
+        }
+    }
+
+    bool Normals::EstimateIntegral(
+        const OrganizedCloud& cloud,
+        int radiusPx,
+        int minPoints,
+        float maxDepthChange,
+        NormalMap& out)
+    {
+        const int w = cloud.width;
+        const int h = cloud.height;
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+
+        out.width = w;
+        out.height = h;
+        out.nx.assign((size_t)w * h, nan);
+        out.ny.assign((size_t)w * h, nan);
+        out.nz.assign((size_t)w * h, nan);
+        out.curvature.assign((size_t)w * h, nan);
+
+        if (w <= 0 || h <= 0) return false;
+
+        const int r = (std::max)(1, radiusPx);
+        minPoints = (std::max)(3, minPoints);
+
+        // centramos en la media para no perder precision en los productos
+        double cx = 0, cy = 0, cz = 0;
+        size_t nValid = 0;
+        for (size_t i = 0; i < (size_t)w * h; ++i)
+        {
+            if (!cloud.Valid((int)i)) continue;
+            cx += cloud.x[i]; cy += cloud.y[i]; cz += cloud.z[i];
+            nValid++;
+        }
+        if (nValid < (size_t)minPoints) return false;
+
+        cx /= (double)nValid; cy /= (double)nValid; cz /= (double)nValid;
+
+        const bool edges = maxDepthChange > 0.0f;
+        std::vector<float>& edgeDist = out.edgeDist;
+        if (edges) DepthEdgeDistance(cloud, maxDepthChange, edgeDist);
+
+        // integral con una fila y columna extra a cero
+        // primero prefijo de cada fila en paralelo y luego bajamos por bloques de columnas
+        // se escriben todas las celdas, resize sin limpiar basta
+        const int iw = w + 1;
+        std::vector<Moments>& integ = out.integral;
+        integ.resize((size_t)iw * (h + 1));
+
+        for (int i = 0; i < iw; ++i)
+            for (double& m : integ[i].v) m = 0.0;
+
+        Parallel::For(0, h, 16, [&](int jb, int je)
+            {
+                for (int j = jb; j < je; ++j)
+                {
+                    Moments* dst = &integ[(size_t)(j + 1) * iw];
+
+                    Moments row;
+                    for (double& m : row.v) m = 0.0;
+                    dst[0] = row;
+
+                    for (int i = 0; i < w; ++i)
+                    {
+                        const size_t k = (size_t)j * w + i;
+                        if (cloud.Valid((int)k))
+                        {
+                            double px = cloud.x[k] - cx;
+                            double py = cloud.y[k] - cy;
+                            double pz = cloud.z[k] - cz;
+
+                            row.v[0] += 1.0;
+                            row.v[1] += px; row.v[2] += py; row.v[3] += pz;
+                            row.v[4] += px * px; row.v[5] += px * py; row.v[6] += px * pz;
+                            row.v[7] += py * py; row.v[8] += py * pz; row.v[9] += pz * pz;
+                        }
+
+                        dst[i + 1] = row;
+                    }
+                }
+            });
+
+        Parallel::For(1, iw, 64, [&](int ib, int ie)
+            {
+                for (int j = 1; j <= h; ++j)
+                {
+                    Moments* dst = &integ[(size_t)j * iw];
+                    const Moments* up = &integ[(size_t)(j - 1) * iw];
+
+                    for (int i = ib; i < ie; ++i)
+                        for (int c = 0; c < 10; ++c) dst[i].v[c] += up[i].v[c];
+                }
+            });
+
+        Parallel::For(0, h, 8, [&](int jb, int je)
+            {
+                for (int j = jb; j < je; ++j)
+                {
+                    for (int i = 0; i < w; ++i)
+                    {
+                        const size_t k = (size_t)j * w + i;
+                        if (!cloud.Valid((int)k)) continue;
+
+                        // ventana adaptada para no mezclar planos a los dos lados de un salto
+                        int rk = r;
+                        if (edges)
+                        {
+                            rk = (std::min)(r, (int)edgeDist[k]);
+                            if (rk < 1) continue;
+                        }
+
+                        const int ya = (std::max)(0, j - rk);
+                        const int yb = (std::min)(h, j + rk + 1);
+                        const int xa = (std::max)(0, i - rk);
+                        const int xb = (std::min)(w, i + rk + 1);
+
+                        const Moments& A = integ[(size_t)yb * iw + xb];
+                        const Moments& B = integ[(size_t)ya * iw + xb];
+                        const Moments& C = integ[(size_t)yb * iw + xa];
+                        const Moments& D = integ[(size_t)ya * iw + xa];
+
+                        double s[10];
+                        for (int c = 0; c < 10; ++c) s[c] = A.v[c] - B.v[c] - C.v[c] + D.v[c];
+
+                        // con ventana pequena pedimos menos puntos
+                        const int need = (std::min)(minPoints, (2 * rk + 1) * (2 * rk + 1) / 2 + 1);
+                        if (s[0] < (double)need) continue;
+
+                        const double inv = 1.0 / s[0];
+                        const double mx = s[1] * inv, my = s[2] * inv, mz = s[3] * inv;
+
+                        double cov[6] = {
+                            s[4] * inv - mx * mx, s[5] * inv - mx * my, s[6] * inv - mx * mz,
+                            s[7] * inv - my * my, s[8] * inv - my * mz,
+                            s[9] * inv - mz * mz
+                        };
+
+                        float n[3], l0, tr;
+                        if (!VisionMath::SmallestEigenVector3(cov, n, l0, tr)) continue;
+
+                        // hacia la camara que esta en el origen
+                        if (n[0] * cloud.x[k] + n[1] * cloud.y[k] + n[2] * cloud.z[k] > 0.0f)
+                        {
+                            n[0] = -n[0]; n[1] = -n[1]; n[2] = -n[2];
+                        }
+
+                        out.nx[k] = n[0];
+                        out.ny[k] = n[1];
+                        out.nz[k] = n[2];
+                        out.curvature[k] = tr > 0.0f ? (std::max)(0.0f, l0) / tr : 0.0f;
+                    }
+                }
+            });
+
+        return true;
+    }
+
+    void Normals::Gather(
+        const NormalMap& map,
+        const OrganizedCloud& grid,
+        int pixWidth,
+        const std::vector<Pt>& pts,
+        PointNormals& out)
+    {
+        const size_t n = pts.size();
+        out.nx.assign(n, 0.0f);
+        out.ny.assign(n, 0.0f);
+        out.nz.assign(n, 0.0f);
+
+        if (pixWidth <= 0 || grid.step <= 0 || map.width != grid.width || map.height != grid.height) return;
+
+        Parallel::For(0, (int)n, 16384, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    const int pix = pts[i].pix;
+                    if (pix < 0) continue;
+
+                    const int dx = pix % pixWidth - grid.x0;
+                    const int dy = pix / pixWidth - grid.y0;
+                    if (dx < 0 || dy < 0) continue;
+
+                    const int gx = dx / grid.step;
+                    const int gy = dy / grid.step;
+                    if (gx >= grid.width || gy >= grid.height) continue;
+
+                    const int k = gy * grid.width + gx;
+                    if (!map.Valid(k)) continue;
+
+                    out.nx[i] = map.nx[k];
+                    out.ny[i] = map.ny[k];
+                    out.nz[i] = map.nz[k];
+                }
+            });
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // nube organizada sobre la rejilla ROI con paso de decimacion
+    // celda (i, j) es el pixel (x0 + i * step, y0 + j * step), NaN donde no hay punto
+    struct OrganizedCloud
+    {
+        int width = 0;
+        int height = 0;
+        int x0 = 0;
+        int y0 = 0;
+        int step = 1;
+
+        std::vector<float> x, y, z;
+
+        // reservamos y dejamos todo a NaN, no liberamos entre frames
+        void Reset(int w, int h, int px0, int py0, int pstep);
+
+        bool Valid(int i) const { return z[i] == z[i]; }
+
+        // recorte a las celdas con punto dentro de la caja en sistema camara, con margen en celdas
+        // lo de fuera de la caja queda NaN, devolvemos false si no queda nada
+        bool CropToBox(const float boxMin[3], const float boxMax[3], int marginCells, OrganizedCloud& out) const;
+    };
+
+    // momentos acumulados de una celda de la integral
+    // n x y z xx xy xz yy yz zz
+    struct Moments
+    {
+        double v[10];
+    };
+
+    // normal por celda orientada hacia la camara, NaN donde no se pudo estimar
+    // curvatura l0 / (l0 + l1 + l2), cero en un plano perfecto
+    struct NormalMap
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> nx, ny, nz, curvature;
+
+        // memoria de trabajo, 80 bytes por celda la integral, no liberamos entre frames
+        std::vector<Moments> integral;
+        std::vector<float> edgeDist;
+
+        bool Valid(int i) const { return nx[i] == nx[i]; }
+    };
+
+    class Normals
+    {
+    public:
+        // covarianza en ventana (2r+1)x(2r+1) con imagenes integrales de X Y Z y sus productos
+        // coste O(1) por celda sea cual sea el radio, integral y normales por filas en paralelo
+        // con maxDepthChange > 0 marcamos saltos de profundidad relativos a z entre vecinas
+        // y la ventana se encoge para no cruzarlos, las celdas del salto quedan sin normal
+        static bool EstimateIntegral(
+            const OrganizedCloud& cloud,
+            int radiusPx,
+            int minPoints,
+            float maxDepthChange,
+            NormalMap& out
+        );
+
+        // normal de cada punto por su pix sobre la rejilla con la que se estimo el mapa
+        // pixWidth es el ancho con el que se codifico pix, los puntos sin normal quedan a cero
+        static void Gather(
+            const NormalMap& map,
+            const OrganizedCloud& grid,
+            int pixWidth,
+            const std::vector<Pt>& pts,
+            PointNormals& out
+        );
+    };
+}
@@ -0,0 +1,291 @@
+#include "BBBOctreeLod.h"
+
+#include "BBBParallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+
+namespace BBB
+{
+    // separamos los 10 bits bajos de v de dos en dos huecos
+    static uint32_t SpreadBits3(uint32_t v)
+    {
+        v &= 0x3ff;
+        v = (v | (v << 16)) & 0x030000ff;
+        v = (v | (v << 8)) & 0x0300f00f;
+        v = (v | (v << 4)) & 0x030c30c3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    static uint32_t Morton3(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return SpreadBits3(x) | (SpreadBits3(y) << 1) | (SpreadBits3(z) << 2);
+    }
+
+    // clave Morton arriba e indice del punto abajo
+    // radix de 10 bits por pasada sobre los 30 bits del codigo, el indice ya sale estable
+    static void RadixSortKeys(std::vector<uint64_t>& keys)
+    {
+        std::vector<uint64_t> tmp(keys.size());
+        std::vector<uint32_t> count(1024);
+
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            const int shift = 32 + pass * 10;
+            std::fill(count.begin(), count.end(), 0u);
+
+            for (uint64_t k : keys) count[(k >> shift) & 0x3ff]++;
+
+            uint32_t sum = 0;
+            for (auto& c : count)
+            {
+                uint32_t t = c;
+                c = sum;
+                sum += t;
+            }
+
+            for (uint64_t k : keys) tmp[count[(k >> shift) & 0x3ff]++] = k;
+            keys.swap(tmp);
+        }
+    }
+
+    bool OctreeLod::Build(const std::vector<Pt>& pts, int levels, float finestCellM, LodCloud& out)
+    {
+        out.levels.clear();
+        out.pts.clear();
+        out.src.clear();
+
+        const int n = (int)pts.size();
+        if (n == 0 || levels < 1 || finestCellM <= 1e-6f) return false;
+
+        // caja de la nube por bloques
+        float lo[3] = { +std::numeric_limits<float>::max(), +std::numeric_limits<float>::max(), +std::numeric_limits<float>::max() };
+        float hi[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+        std::mutex mtx;
+
+        Parallel::For(0, n, 16384, [&](int b, int e)
+            {
+                float l[3] = { lo[0], lo[1], lo[2] };
+                float h[3] = { hi[0], hi[1], hi[2] };
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& p = pts[i];
+                    l[0] = (std::min)(l[0], p.x); h[0] = (std::max)(h[0], p.x);
+                    l[1] = (std::min)(l[1], p.y); h[1] = (std::max)(h[1], p.y);
+                    l[2] = (std::min)(l[2], p.z); h[2] = (std::max)(h[2], p.z);
+                }
+
+                std::lock_guard<std::mutex> lk(mtx);
+                for (int a = 0; a < 3; ++a)
+                {
+                    lo[a] = (std::min)(lo[a], l[a]);
+                    hi[a] = (std::max)(hi[a], h[a]);
+                }
+            });
+
+        // cubo con un pelo de margen para que el maximo no caiga fuera de la ultima celda
+        float size = (std::max)({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-3f }) * 1.0001f;
+
+        out.origin[0] = lo[0];
+        out.origin[1] = lo[1];
+        out.origin[2] = lo[2];
+        out.sizeM = size;
+
+        const int res = 1 << kMaxDepth;
+        const float scale = (float)res / size;
+
+        std::vector<uint64_t> keys(n);
+        Parallel::For(0, n, 16384, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& p = pts[i];
+                    uint32_t cx = (uint32_t)std::clamp((int)((p.x - lo[0]) * scale), 0, res - 1);
+                    uint32_t cy = (uint32_t)std::clamp((int)((p.y - lo[1]) * scale), 0, res - 1);
+                    uint32_t cz = (uint32_t)std::clamp((int)((p.z - lo[2]) * scale), 0, res - 1);
+                    keys[i] = ((uint64_t)Morton3(cx, cy, cz) << 32) | (uint32_t)i;
+                }
+            });
+
+        RadixSortKeys(keys);
+
+        // en orden Morton cada celda de cualquier profundidad es un tramo contiguo
+        // repartimos el vector en bloques fijos y cada celda es del bloque donde empieza
+        std::vector<uint8_t> used(n, 0);
+        const int nChunks = std::clamp(n / 8192, 1, 64);
+        std::vector<std::vector<int>> picks(nChunks);
+
+        out.pts.reserve(n);
+        out.src.reserve(n);
+
+        int prevDepth = -1;
+        for (int l = 0; l + 1 < levels; ++l)
+        {
+            const float cell = finestCellM * (float)(1 << (levels - 2 - l));
+            const int depth = std::clamp((int)std::ceil(std::log2(size / cell)), 0, kMaxDepth);
+            if (depth <= prevDepth) continue;
+            prevDepth = depth;
+
+            const int shift = 32 + 3 * (kMaxDepth - depth);
+
+            Parallel::For(0, nChunks, 1, [&](int cb, int ce)
+                {
+                    for (int c = cb; c < ce; ++c)
+                    {
+                        std::vector<int>& pick = picks[c];
+                        pick.clear();
+
+                        int b = (int)((int64_t)n * c / nChunks);
+                        const int e = (int)((int64_t)n * (c + 1) / nChunks);
+                        while (b > 0 && b < e && (keys[b] >> shift) == (keys[b - 1] >> shift)) b++;
+
+                        int i = b;
+                        while (i < e)
+                        {
+                            const uint64_t code = keys[i] >> shift;
+
+                            bool taken = false;
+                            double sx = 0, sy = 0, sz = 0;
+                            int j = i;
+                            for (; j < n && (keys[j] >> shift) == code; ++j)
+                            {
+                                taken = taken || used[j];
+                                const Pt& p = pts[(uint32_t)keys[j]];
+                                sx += p.x; sy += p.y; sz += p.z;
+                            }
+
+                            if (!taken)
+                            {
+                                const double inv = 1.0 / (double)(j - i);
+                                const float mx = (float)(sx * inv), my = (float)(sy * inv), mz = (float)(sz * inv);
+
+                                int best = i;
+                                float bestD2 = std::numeric_limits<float>::max();
+                                for (int k = i; k < j; ++k)
+                                {
+                                    const Pt& p = pts[(uint32_t)keys[k]];
+                                    float dx = p.x - mx, dy = p.y - my, dz = p.z - mz;
+                                    float d2 = dx * dx + dy * dy + dz * dz;
+                                    if (d2 < bestD2) { bestD2 = d2; best = k; }
+                                }
+                                pick.push_back(best);
+                            }
+
+                            i = j;
+                        }
+                    }
+                });
+
+            LodLevel lv;
+            lv.depth = depth;
+            lv.cellM = size / (float)(1 << depth);
+            lv.first = (uint32_t)out.pts.size();
+
+            for (const auto& pick : picks)
+            {
+                for (int k : pick)
+                {
+                    used[k] = 1;
+                    out.pts.push_back(pts[(uint32_t)keys[k]]);
+                    out.src.push_back((uint32_t)keys[k]);
+                }
+            }
+
+            lv.count = (uint32_t)out.pts.size() - lv.first;
+            out.levels.push_back(lv);
+        }
+
+        // el ultimo nivel completa la nube
+        LodLevel rest;
+        rest.depth = kMaxDepth;
+        rest.cellM = 0.0f;
+        rest.first = (uint32_t)out.pts.size();
+
+        for (int k = 0; k < n; ++k)
+        {
+            if (used[k]) continue;
+            out.pts.push_back(pts[(uint32_t)keys[k]]);
+            out.src.push_back((uint32_t)keys[k]);
+        }
+
+        rest.count = (uint32_t)out.pts.size() - rest.first;
+        out.levels.push_back(rest);
+
+        return true;
+    }
+
+    template <class T>
+    static void Put(std::vector<char>& buf, size_t& at, const T& v)
+    {
+        std::memcpy(buf.data() + at, &v, sizeof(T));
+        at += sizeof(T);
+    }
+
+    bool OctreeLod::Write(const std::string& filePath, const LodCloud& lod, const PointNormals* normals)
+    {
+        const bool withNormals = normals && normals->Size() > 0 && lod.src.size() == lod.pts.size();
+
+        const size_t headerBytes = 8 + 4 * sizeof(uint32_t) + 4 * sizeof(float);
+        const size_t levelBytes = 2 * sizeof(uint32_t) + sizeof(float) + sizeof(uint64_t);
+        const size_t recBytes = (withNormals ? 6 : 3) * sizeof(float) + 3;
+
+        const size_t dataStart = headerBytes + lod.levels.size() * levelBytes;
+        std::vector<char> buf(dataStart + lod.pts.size() * recBytes);
+
+        size_t at = 0;
+        const char magic[8] = { 'B', 'B', 'B', 'L', 'O', 'D', '1', '\0' };
+        std::memcpy(buf.data(), magic, 8);
+        at += 8;
+
+        Put(buf, at, (uint32_t)1);
+        Put(buf, at, (uint32_t)lod.levels.size());
+        Put(buf, at, (uint32_t)lod.pts.size());
+        Put(buf, at, (uint32_t)(withNormals ? 1 : 0));
+        Put(buf, at, lod.origin[0]);
+        Put(buf, at, lod.origin[1]);
+        Put(buf, at, lod.origin[2]);
+        Put(buf, at, lod.sizeM);
+
+        for (const auto& lv : lod.levels)
+        {
+            Put(buf, at, (uint32_t)lv.depth);
+            Put(buf, at, lv.cellM);
+            Put(buf, at, (uint64_t)(dataStart + (size_t)lv.first * recBytes));
+            Put(buf, at, lv.count);
+        }
+
+        // registros de tamano fijo, cada bloque escribe los suyos
+        Parallel::For(0, (int)lod.pts.size(), 16384, [&](int b, int e)
+            {
+                size_t pos = dataStart + (size_t)b * recBytes;
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& q = lod.pts[i];
+                    Put(buf, pos, q.x);
+                    Put(buf, pos, q.y);
+                    Put(buf, pos, q.z);
+                    if (withNormals)
+                    {
+                        const uint32_t s = lod.src[i];
+                        Put(buf, pos, normals->nx[s]);
+                        Put(buf, pos, normals->ny[s]);
+                        Put(buf, pos, normals->nz[s]);
+                    }
+                    Put(buf, pos, q.r);
+                    Put(buf, pos, q.g);
+                    Put(buf, pos, q.b);
+                }
+            });
+
+        std::ofstream f(filePath, std::ios::binary);
+        if (!f.is_open()) return false;
+
+        f.write(buf.data(), (std::streamsize)buf.size());
+        return (bool)f;
+    }
+}
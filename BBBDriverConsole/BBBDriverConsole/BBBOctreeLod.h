@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // un nivel del fichero, sus puntos se suman a los de los niveles anteriores
+    // depth es la profundidad del octree, cellM 0 en el ultimo que lleva el resto de la nube
+    struct LodLevel
+    {
+        int depth = 0;
+        float cellM = 0.0f;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    // nube reordenada por niveles, pts[first, first + count) de cada nivel en orden Morton
+    struct LodCloud
+    {
+        float origin[3] = { 0, 0, 0 };
+        float sizeM = 0.0f;
+        std::vector<LodLevel> levels;
+        std::vector<Pt> pts;
+
+        // indice en la nube de entrada de cada punto, para sacar sus normales al escribir
+        std::vector<uint32_t> src;
+    };
+
+    class OctreeLod
+    {
+    public:
+        // profundidad maxima del octree, 10 bits por eje en el codigo Morton
+        static constexpr int kMaxDepth = 10;
+
+        // levels niveles, el penultimo con celda finestCellM y cada uno anterior el doble
+        // por celda ocupada de un nivel sale un punto, el mas cercano al centroide de la celda
+        // salvo que un nivel anterior ya tenga uno dentro
+        static bool Build(const std::vector<Pt>& pts, int levels, float finestCellM, LodCloud& out);
+
+        // formato binario little endian
+        //   char[8] "BBBLOD1\0", uint32 version, uint32 niveles, uint32 puntos, uint32 flags (1 normales)
+        //   float origen[3], float lado del cubo
+        //   por nivel uint32 depth, float cellM, uint64 offset en bytes desde el inicio, uint32 puntos
+        //   puntos float x y z, float nx ny nz si hay normales, uchar r g b, igual que el PLY binario
+        // un visor lee la cabecera y los niveles que quiera de una sola lectura contigua
+        // normals por indice de la nube de entrada de Build, nullptr sin normales
+        static bool Write(const std::string& filePath, const LodCloud& lod, const PointNormals* normals);
+    };
+}
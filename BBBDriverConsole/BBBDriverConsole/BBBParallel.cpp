@@ -0,0 +1,182 @@
+#include "BBBParallel.h"
+#include "BBBPerfCounters.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+namespace BBB
+{
+    // trabajo repartido en bloques, lo cogen el pool y el llamante
+    struct ParallelJob
+    {
+        const std::function<void(int, int)>* fn = nullptr;
+        int begin = 0;
+        int chunk = 1;
+        int end = 0;
+        int nChunks = 0;
+
+        // etapa del llamante que esta contando, los hilos del pool le suman sus bloques
+        PerfAccumulator* sink = nullptr;
+
+        std::atomic<int> next{ 0 };
+        std::atomic<int> done{ 0 };
+
+        std::mutex m;
+        std::condition_variable cv;
+
+        // devolvemos false cuando ya no quedan bloques
+        // el llamante ya cuenta lo suyo con sus contadores, pooled solo en los hilos del pool
+        bool RunOne(bool pooled)
+        {
+            int c = next.fetch_add(1);
+            if (c >= nChunks) return false;
+
+            int b = begin + c * chunk;
+            int e = (std::min)(end, b + chunk);
+
+            PerfSample c0;
+            const bool counting = pooled && sink && PerfCounters::Read(c0);
+            if (counting)
+            {
+                // un For anidado dentro del bloque suma a la misma etapa
+                PerfCounters::SetSink(sink);
+                (*fn)(b, e);
+                PerfCounters::SetSink(nullptr);
+
+                // antes de done, el llamante lee la suma al despertar
+                PerfSample c1;
+                if (PerfCounters::Read(c1)) sink->Add(PerfCounters::Delta(c0, c1));
+            }
+            else
+            {
+                (*fn)(b, e);
+            }
+
+            if (done.fetch_add(1) + 1 == nChunks)
+            {
+                std::lock_guard<std::mutex> lk(m);
+                cv.notify_all();
+            }
+            return true;
+        }
+    };
+
+    class ThreadPool
+    {
+    public:
+        ThreadPool()
+        {
+            unsigned int hc = std::thread::hardware_concurrency();
+            nThreads = (int)(std::max)(1u, hc);
+
+            for (int i = 1; i < nThreads; ++i)
+                workers.emplace_back([this]() { Loop(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                stop = true;
+            }
+            cv.notify_all();
+            for (auto& t : workers) t.join();
+        }
+
+        int Size() const { return nThreads; }
+
+        void Post(const std::shared_ptr<ParallelJob>& job)
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                jobs.push_back(job);
+            }
+            cv.notify_all();
+        }
+
+    private:
+        void Loop()
+        {
+            while (true)
+            {
+                std::shared_ptr<ParallelJob> job;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv.wait(lk, [this]() { return stop || !jobs.empty(); });
+                    if (stop) return;
+
+                    job = jobs.front();
+
+                    // si ya se repartio entero lo sacamos de la cola
+                    if (job->next.load() >= job->nChunks)
+                    {
+                        jobs.pop_front();
+                        continue;
+                    }
+                }
+
+                while (job->RunOne(true)) {}
+            }
+        }
+
+        int nThreads = 1;
+        std::vector<std::thread> workers;
+        std::deque<std::shared_ptr<ParallelJob>> jobs;
+        std::mutex m;
+        std::condition_variable cv;
+        bool stop = false;
+    };
+
+    static ThreadPool& Pool()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    int Parallel::ThreadCount()
+    {
+        return Pool().Size();
+    }
+
+    void Parallel::For(int begin, int end, int minChunk, const std::function<void(int, int)>& fn)
+    {
+        const int n = end - begin;
+        if (n <= 0) return;
+
+        minChunk = (std::max)(1, minChunk);
+
+        ThreadPool& pool = Pool();
+
+        // pocos elementos o un solo hilo, lo hacemos aqui
+        if (pool.Size() <= 1 || n <= minChunk)
+        {
+            fn(begin, end);
+            return;
+        }
+
+        // unos 4 bloques por hilo para equilibrar carga
+        int target = pool.Size() * 4;
+        int chunk = (std::max)(minChunk, (n + target - 1) / target);
+
+        auto job = std::make_shared<ParallelJob>();
+        job->fn = &fn;
+        job->begin = begin;
+        job->end = end;
+        job->chunk = chunk;
+        job->nChunks = (n + chunk - 1) / chunk;
+        job->sink = PerfCounters::Enabled() ? PerfCounters::Sink() : nullptr;
+
+        pool.Post(job);
+
+        while (job->RunOne(false)) {}
+
+        std::unique_lock<std::mutex> lk(job->m);
+        job->cv.wait(lk, [&]() { return job->done.load() >= job->nChunks; });
+    }
+}
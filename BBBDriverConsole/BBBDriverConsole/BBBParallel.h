@@ -0,0 +1,18 @@
+#pragma once
+
+#include <functional>
+
+namespace BBB
+{
+    class Parallel
+    {
+    public:
+        // numero de hilos que usamos contando el que llama
+        static int ThreadCount();
+
+        // repartimos [begin, end) en bloques de al menos minChunk y llamamos fn(b, e)
+        // el hilo que llama tambien trabaja y volvemos cuando han acabado todos los bloques
+        // se puede anidar, si el pool esta ocupado el llamante hace el trabajo solo
+        static void For(int begin, int end, int minChunk, const std::function<void(int, int)>& fn);
+    };
+}
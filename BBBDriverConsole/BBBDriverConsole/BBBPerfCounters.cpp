@@ -0,0 +1,226 @@
+#include "BBBPerfCounters.h"
+
+#include <atomic>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace BBB
+{
+    static std::atomic<bool> gEnabled{ false };
+
+    void PerfCounters::SetEnabled(bool on)
+    {
+        gEnabled.store(on, std::memory_order_relaxed);
+    }
+
+    bool PerfCounters::Enabled()
+    {
+        return gEnabled.load(std::memory_order_relaxed);
+    }
+
+    PerfSample PerfCounters::Delta(const PerfSample& begin, const PerfSample& end)
+    {
+        PerfSample d;
+        d.valid = begin.valid & end.valid;
+        if (d.valid & PerfSample::kCycles) d.cycles = end.cycles - begin.cycles;
+        if (d.valid & PerfSample::kInstructions) d.instructions = end.instructions - begin.instructions;
+        if (d.valid & PerfSample::kCacheMisses) d.cacheMisses = end.cacheMisses - begin.cacheMisses;
+        if (d.valid & PerfSample::kBranchMisses) d.branchMisses = end.branchMisses - begin.branchMisses;
+        if (d.valid & PerfSample::kPageFaults) d.pageFaults = end.pageFaults - begin.pageFaults;
+        return d;
+    }
+
+    void PerfAccumulator::Add(const PerfSample& d)
+    {
+        if (d.valid == 0) return;
+
+        cycles.fetch_add(d.cycles, std::memory_order_relaxed);
+        instructions.fetch_add(d.instructions, std::memory_order_relaxed);
+        cacheMisses.fetch_add(d.cacheMisses, std::memory_order_relaxed);
+        branchMisses.fetch_add(d.branchMisses, std::memory_order_relaxed);
+        pageFaults.fetch_add(d.pageFaults, std::memory_order_relaxed);
+        valid.fetch_and(d.valid, std::memory_order_relaxed);
+        adds.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    PerfSample PerfAccumulator::Load() const
+    {
+        PerfSample r;
+        if (adds.load(std::memory_order_relaxed) == 0) return r;
+
+        r.cycles = cycles.load(std::memory_order_relaxed);
+        r.instructions = instructions.load(std::memory_order_relaxed);
+        r.cacheMisses = cacheMisses.load(std::memory_order_relaxed);
+        r.branchMisses = branchMisses.load(std::memory_order_relaxed);
+        r.pageFaults = pageFaults.load(std::memory_order_relaxed);
+        r.valid = valid.load(std::memory_order_relaxed);
+        return r;
+    }
+
+    PerfSample PerfAccumulator::AddTo(const PerfSample& d) const
+    {
+        // sin sumas del pool no recortamos valid
+        const PerfSample p = Load();
+        if (p.valid == 0) return d;
+
+        PerfSample r;
+        r.valid = d.valid & p.valid;
+        if (r.valid & PerfSample::kCycles) r.cycles = d.cycles + p.cycles;
+        if (r.valid & PerfSample::kInstructions) r.instructions = d.instructions + p.instructions;
+        if (r.valid & PerfSample::kCacheMisses) r.cacheMisses = d.cacheMisses + p.cacheMisses;
+        if (r.valid & PerfSample::kBranchMisses) r.branchMisses = d.branchMisses + p.branchMisses;
+        if (r.valid & PerfSample::kPageFaults) r.pageFaults = d.pageFaults + p.pageFaults;
+        return r;
+    }
+
+    static thread_local PerfAccumulator* tSink = nullptr;
+
+    PerfAccumulator* PerfCounters::Sink()
+    {
+        return tSink;
+    }
+
+    void PerfCounters::SetSink(PerfAccumulator* acc)
+    {
+        tSink = acc;
+    }
+
+#ifdef __linux__
+
+    static const int kMaxCounters = 5;
+
+    // grupo de contadores del hilo, el primero que abre es el lider y se leen todos de una vez
+    struct ThreadGroup
+    {
+        bool tried = false;
+        int leader = -1;
+        int fds[kMaxCounters] = { -1, -1, -1, -1, -1 };
+        uint32_t bits[kMaxCounters] = {};
+        int n = 0;
+
+        ~ThreadGroup()
+        {
+            for (int i = 0; i < n; ++i) close(fds[i]);
+        }
+
+        bool Open(uint32_t type, uint64_t config, uint32_t bit)
+        {
+            perf_event_attr a;
+            std::memset(&a, 0, sizeof(a));
+            a.size = sizeof(a);
+            a.type = type;
+            a.config = config;
+            a.exclude_kernel = 1;
+            a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            a.disabled = leader < 0 ? 1 : 0;
+
+            const int fd = (int)syscall(SYS_perf_event_open, &a, 0, -1, leader, 0);
+            if (fd < 0) return false;
+
+            if (leader < 0) leader = fd;
+            fds[n] = fd;
+            bits[n] = bit;
+            n++;
+            return true;
+        }
+
+        void TryOpen()
+        {
+            tried = true;
+
+            // ciclos de lider, si no hay PMU el grupo va con los fallos de pagina que son software
+            Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, PerfSample::kCycles);
+            Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, PerfSample::kInstructions);
+            Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, PerfSample::kCacheMisses);
+            Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, PerfSample::kBranchMisses);
+            Open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, PerfSample::kPageFaults);
+
+            if (leader >= 0)
+            {
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+        }
+
+        bool Read(PerfSample& out)
+        {
+            if (!tried) TryOpen();
+            if (leader < 0) return false;
+
+            // nr, tiempo activo, tiempo contando y un valor por contador en orden de apertura
+            uint64_t buf[3 + kMaxCounters];
+            const ssize_t got = read(leader, buf, sizeof(buf));
+            if (got < (ssize_t)(3 * sizeof(uint64_t))) return false;
+
+            const uint64_t nr = buf[0];
+            const uint64_t enabled = buf[1];
+            const uint64_t running = buf[2];
+
+            // si el kernel reparte la PMU entre grupos escalamos al tiempo total
+            const double scale = (running > 0 && running < enabled) ? (double)enabled / (double)running : 1.0;
+
+            out = PerfSample{};
+            for (uint64_t i = 0; i < nr && i < (uint64_t)n; ++i)
+            {
+                const uint64_t v = (uint64_t)((double)buf[3 + i] * scale);
+                switch (bits[i])
+                {
+                case PerfSample::kCycles: out.cycles = v; break;
+                case PerfSample::kInstructions: out.instructions = v; break;
+                case PerfSample::kCacheMisses: out.cacheMisses = v; break;
+                case PerfSample::kBranchMisses: out.branchMisses = v; break;
+                case PerfSample::kPageFaults: out.pageFaults = v; break;
+                }
+                out.valid |= bits[i];
+            }
+            return out.valid != 0;
+        }
+    };
+
+    static ThreadGroup& Mine()
+    {
+        static thread_local ThreadGroup group;
+        return group;
+    }
+
+    bool PerfCounters::Read(PerfSample& out)
+    {
+        return Mine().Read(out);
+    }
+
+    std::string PerfCounters::Describe()
+    {
+        PerfSample s;
+        if (!Read(s)) return "sin contadores, perf_event_open no disponible";
+
+        std::string d;
+        if (s.valid & PerfSample::kCycles) d += " ciclos";
+        if (s.valid & PerfSample::kInstructions) d += " instrucciones";
+        if (s.valid & PerfSample::kCacheMisses) d += " fallos_cache";
+        if (s.valid & PerfSample::kBranchMisses) d += " fallos_salto";
+        if (s.valid & PerfSample::kPageFaults) d += " fallos_pagina";
+        return "contadores" + d;
+    }
+
+#else
+
+    bool PerfCounters::Read(PerfSample& out)
+    {
+        out = PerfSample{};
+        return false;
+    }
+
+    std::string PerfCounters::Describe()
+    {
+        return "sin contadores, solo hay perf_event_open en Linux";
+    }
+
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace BBB
+{
+    // contadores de una etapa, los que el sistema no dio quedan a 0 y sin su bit en valid
+    struct PerfSample
+    {
+        enum : uint32_t
+        {
+            kCycles = 1u << 0,
+            kInstructions = 1u << 1,
+            kCacheMisses = 1u << 2,
+            kBranchMisses = 1u << 3,
+            kPageFaults = 1u << 4
+        };
+
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t branchMisses = 0;
+        uint64_t pageFaults = 0;
+        uint32_t valid = 0;
+    };
+
+    // suma de lo que hacen los hilos del pool para una etapa, cada hilo suma su resta al acabar un bloque
+    // valid es el y de los hilos que sumaron, adds cuantos lo hicieron
+    struct PerfAccumulator
+    {
+        std::atomic<uint64_t> cycles{ 0 };
+        std::atomic<uint64_t> instructions{ 0 };
+        std::atomic<uint64_t> cacheMisses{ 0 };
+        std::atomic<uint64_t> branchMisses{ 0 };
+        std::atomic<uint64_t> pageFaults{ 0 };
+        std::atomic<uint32_t> valid{ ~0u };
+        std::atomic<uint32_t> adds{ 0 };
+
+        void Add(const PerfSample& d);
+
+        // lo acumulado, valid a 0 si nadie sumo
+        PerfSample Load() const;
+
+        // d mas lo acumulado, solo quedan validos los contadores que tenian todos
+        PerfSample AddTo(const PerfSample& d) const;
+    };
+
+    // contadores de CPU del hilo que llama con perf_event_open, en Linux
+    // cada hilo abre su grupo la primera vez que lee, sin permisos o en una VM sin PMU
+    // bajamos a lo que haya, como minimo fallos de pagina, y si no hay nada Read devuelve false
+    // Read solo cuenta el hilo que llama, lo que reparte Parallel::For en el pool lo suma
+    // cada hilo del pool al acumulador que tenga puesto el llamante con SetSink
+    class PerfCounters
+    {
+    public:
+        static void SetEnabled(bool on);
+        static bool Enabled();
+
+        // valores acumulados del hilo, la etapa es la resta de dos lecturas
+        static bool Read(PerfSample& out);
+
+        static PerfSample Delta(const PerfSample& begin, const PerfSample& end);
+
+        // acumulador de la etapa abierta en este hilo, nullptr si no hay ninguna contando
+        static PerfAccumulator* Sink();
+        static void SetSink(PerfAccumulator* acc);
+
+        // que contadores tenemos en este hilo, para avisar en consola
+        static std::string Describe();
+    };
+}
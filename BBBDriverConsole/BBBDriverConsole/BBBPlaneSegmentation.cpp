@@ -0,0 +1,416 @@
+#include "BBBPlaneSegmentation.h"
+
+#include "BBBRegistration.h"
+#include "BBBSimd.h"
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace BBB
+{
+    static float SelectPercentile(std::vector<float>& v, float q)
+    {
+        if (v.empty()) return 0.0f;
+
+        q = std::clamp(q, 0.0f, 1.0f);
+        size_t i = (size_t)std::lround(q * (float)(v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + i, v.end());
+        return v[i];
+    }
+
+    // momentos de la region que crece, para reajustar el plano sin volver a recorrerla
+    struct RegionAcc
+    {
+        double s[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        double ref[3] = { 0, 0, 0 };
+
+        void Add(float x, float y, float z)
+        {
+            double px = x - ref[0], py = y - ref[1], pz = z - ref[2];
+            s[0] += 1.0;
+            s[1] += px; s[2] += py; s[3] += pz;
+            s[4] += px * px; s[5] += px * py; s[6] += px * pz;
+            s[7] += py * py; s[8] += py * pz; s[9] += pz * pz;
+        }
+
+        // normal y punto medio, devolvemos false si no se puede
+        bool Plane(float n[3], float c[3]) const
+        {
+            if (s[0] < 3.0) return false;
+
+            const double inv = 1.0 / s[0];
+            const double mx = s[1] * inv, my = s[2] * inv, mz = s[3] * inv;
+
+            double cov[6] = {
+                s[4] * inv - mx * mx, s[5] * inv - mx * my, s[6] * inv - mx * mz,
+                s[7] * inv - my * my, s[8] * inv - my * mz,
+                s[9] * inv - mz * mz
+            };
+
+            float l0, tr;
+            if (!VisionMath::SmallestEigenVector3(cov, n, l0, tr)) return false;
+
+            c[0] = (float)(mx + ref[0]);
+            c[1] = (float)(my + ref[1]);
+            c[2] = (float)(mz + ref[2]);
+            return true;
+        }
+    };
+
+    bool PlaneSegmentation::FitPlaneLeastSquares(const float* xs, const float* ys, const float* zs, int n, PlaneFit& out)
+    {
+        if (n < 3) return false;
+
+        // centramos en el primer punto, las sumas en float van por bloques y se vuelcan a double
+        const float rx = xs[0], ry = ys[0], rz = zs[0];
+        double s[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+        const int block = 4096;
+        int i = 0;
+
+#if defined(BBB_SIMD_SSE2)
+        const __m128 vrx = _mm_set1_ps(rx);
+        const __m128 vry = _mm_set1_ps(ry);
+        const __m128 vrz = _mm_set1_ps(rz);
+
+        while (i + 4 <= n)
+        {
+            const int end = (std::min)(n, i + block);
+
+            __m128 sx = _mm_setzero_ps(), sy = _mm_setzero_ps(), sz = _mm_setzero_ps();
+            __m128 sxx = _mm_setzero_ps(), sxy = _mm_setzero_ps(), sxz = _mm_setzero_ps();
+            __m128 syy = _mm_setzero_ps(), syz = _mm_setzero_ps(), szz = _mm_setzero_ps();
+
+            for (; i + 4 <= end; i += 4)
+            {
+                __m128 x = _mm_sub_ps(_mm_loadu_ps(xs + i), vrx);
+                __m128 y = _mm_sub_ps(_mm_loadu_ps(ys + i), vry);
+                __m128 z = _mm_sub_ps(_mm_loadu_ps(zs + i), vrz);
+
+                sx = _mm_add_ps(sx, x);
+                sy = _mm_add_ps(sy, y);
+                sz = _mm_add_ps(sz, z);
+                sxx = _mm_add_ps(sxx, _mm_mul_ps(x, x));
+                sxy = _mm_add_ps(sxy, _mm_mul_ps(x, y));
+                sxz = _mm_add_ps(sxz, _mm_mul_ps(x, z));
+                syy = _mm_add_ps(syy, _mm_mul_ps(y, y));
+                syz = _mm_add_ps(syz, _mm_mul_ps(y, z));
+                szz = _mm_add_ps(szz, _mm_mul_ps(z, z));
+            }
+
+            const __m128 acc[9] = { sx, sy, sz, sxx, sxy, sxz, syy, syz, szz };
+            for (int c = 0; c < 9; ++c)
+            {
+                alignas(16) float lanes[4];
+                _mm_store_ps(lanes, acc[c]);
+                s[c] += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+        }
+#endif
+
+        for (; i < n; ++i)
+        {
+            double x = xs[i] - rx, y = ys[i] - ry, z = zs[i] - rz;
+            s[0] += x; s[1] += y; s[2] += z;
+            s[3] += x * x; s[4] += x * y; s[5] += x * z;
+            s[6] += y * y; s[7] += y * z; s[8] += z * z;
+        }
+
+        const double inv = 1.0 / (double)n;
+        const double mx = s[0] * inv, my = s[1] * inv, mz = s[2] * inv;
+
+        double cov[6] = {
+            s[3] * inv - mx * mx, s[4] * inv - mx * my, s[5] * inv - mx * mz,
+            s[6] * inv - my * my, s[7] * inv - my * mz,
+            s[8] * inv - mz * mz
+        };
+
+        double evals[3], evecs[9];
+        VisionMath::SymEigen3(cov, evals, evecs);
+
+        float nx = (float)evecs[0], ny = (float)evecs[1], nz = (float)evecs[2];
+        float cx = (float)(mx + rx), cy = (float)(my + ry), cz = (float)(mz + rz);
+
+        // hacia la camara
+        if (nx * cx + ny * cy + nz * cz > 0.0f)
+        {
+            nx = -nx; ny = -ny; nz = -nz;
+        }
+
+        out.n[0] = nx; out.n[1] = ny; out.n[2] = nz;
+        out.centroid[0] = cx; out.centroid[1] = cy; out.centroid[2] = cz;
+        out.d = -(nx * cx + ny * cy + nz * cz);
+        out.rmsM = (float)std::sqrt((std::max)(0.0, evals[0]));
+        out.points = n;
+        return true;
+    }
+
+    const char* PlaneSegmentation::FaceName(FaceKind k)
+    {
+        switch (k)
+        {
+        case FaceKind::Top: return "superior";
+        case FaceKind::Side: return "lateral";
+        default: return "frontal";
+        }
+    }
+
+    bool PlaneSegmentation::SegmentBoxFaces(
+        const OrganizedCloud& cloud,
+        const NormalMap& normals,
+        const BBBCameraMount& mount,
+        const FaceSegParams& prm,
+        std::vector<BoxFace>& out)
+    {
+        out.clear();
+
+        const int w = cloud.width;
+        const int h = cloud.height;
+        if (w <= 0 || h <= 0 || normals.width != w || normals.height != h) return false;
+
+        const size_t n = (size_t)w * h;
+
+        const int kFree = -1;
+        const int kOut = -2;
+        const int kSmall = -3;
+
+        // celdas utiles, con punto y normal
+        std::vector<int> label(n, kOut);
+        for (size_t k = 0; k < n; ++k)
+            if (cloud.Valid((int)k) && normals.Valid((int)k)) label[k] = kFree;
+
+        // semillas por curvatura creciente con un reparto en cubetas, sin ordenar del todo
+        const int nBuckets = 64;
+        const float seedMax = (std::max)(1e-6f, prm.seedMaxCurvature);
+        std::vector<int> bucketCount(nBuckets + 1, 0);
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (label[k] != kFree || !(normals.curvature[k] < seedMax)) continue;
+            int b = (std::min)(nBuckets - 1, (int)(normals.curvature[k] / seedMax * nBuckets));
+            bucketCount[b + 1]++;
+        }
+        for (int b = 0; b < nBuckets; ++b) bucketCount[b + 1] += bucketCount[b];
+
+        std::vector<int> seeds(bucketCount[nBuckets]);
+        {
+            std::vector<int> pos(bucketCount.begin(), bucketCount.end() - 1);
+            for (size_t k = 0; k < n; ++k)
+            {
+                if (label[k] != kFree || !(normals.curvature[k] < seedMax)) continue;
+                int b = (std::min)(nBuckets - 1, (int)(normals.curvature[k] / seedMax * nBuckets));
+                seeds[pos[b]++] = (int)k;
+            }
+        }
+
+        const float cosThr = std::cos(prm.angleDeg * 3.14159265358979323846f / 180.0f);
+        const float distThr = prm.distM;
+
+        struct Region
+        {
+            int id = 0;
+            std::vector<int> cells;
+        };
+
+        std::vector<Region> regions;
+        std::vector<int> queue;
+        queue.reserve(4096);
+
+        int nextId = 0;
+
+        for (int seed : seeds)
+        {
+            if (label[seed] != kFree) continue;
+
+            const int id = nextId++;
+
+            RegionAcc acc;
+            acc.ref[0] = cloud.x[seed]; acc.ref[1] = cloud.y[seed]; acc.ref[2] = cloud.z[seed];
+
+            float pn[3] = { normals.nx[seed], normals.ny[seed], normals.nz[seed] };
+            float pc[3] = { cloud.x[seed], cloud.y[seed], cloud.z[seed] };
+            int nextRefit = 32;
+
+            Region reg;
+            reg.id = id;
+
+            queue.clear();
+            queue.push_back(seed);
+            label[seed] = id;
+
+            for (size_t qi = 0; qi < queue.size(); ++qi)
+            {
+                const int k = queue[qi];
+                reg.cells.push_back(k);
+                acc.Add(cloud.x[k], cloud.y[k], cloud.z[k]);
+
+                // reajustamos el plano cada vez que la region dobla su tamano
+                if ((int)reg.cells.size() >= nextRefit)
+                {
+                    float nn[3], cc[3];
+                    if (acc.Plane(nn, cc))
+                    {
+                        if (nn[0] * pn[0] + nn[1] * pn[1] + nn[2] * pn[2] < 0.0f)
+                        {
+                            nn[0] = -nn[0]; nn[1] = -nn[1]; nn[2] = -nn[2];
+                        }
+                        pn[0] = nn[0]; pn[1] = nn[1]; pn[2] = nn[2];
+                        pc[0] = cc[0]; pc[1] = cc[1]; pc[2] = cc[2];
+                    }
+                    nextRefit *= 2;
+                }
+
+                const int ci = k % w;
+                const int cj = k / w;
+
+                const int nb[4][2] = { { ci - 1, cj }, { ci + 1, cj }, { ci, cj - 1 }, { ci, cj + 1 } };
+                for (const auto& q : nb)
+                {
+                    if (q[0] < 0 || q[1] < 0 || q[0] >= w || q[1] >= h) continue;
+
+                    const int m = q[1] * w + q[0];
+                    if (label[m] != kFree && label[m] != kSmall) continue;
+
+                    float dot = normals.nx[m] * pn[0] + normals.ny[m] * pn[1] + normals.nz[m] * pn[2];
+                    if (dot < cosThr) continue;
+
+                    float dist = (cloud.x[m] - pc[0]) * pn[0] + (cloud.y[m] - pc[1]) * pn[1] + (cloud.z[m] - pc[2]) * pn[2];
+                    if (std::fabs(dist) > distThr) continue;
+
+                    label[m] = id;
+                    queue.push_back(m);
+                }
+            }
+
+            if ((int)reg.cells.size() < prm.minRegionPoints)
+            {
+                // la dejamos absorber por otra region pero ya no sembramos aqui
+                for (int k : reg.cells) label[k] = kSmall;
+                continue;
+            }
+
+            regions.push_back(std::move(reg));
+        }
+
+        if (regions.empty()) return false;
+
+        std::sort(regions.begin(), regions.end(), [](const Region& a, const Region& b)
+            {
+                return a.cells.size() > b.cells.size();
+            });
+
+        const int nPlanes = (std::min)((int)regions.size(), (std::max)(1, prm.maxPlanes));
+        const Rigid T = Registration::MountToWorld(mount);
+
+        std::vector<float> xs, ys, zs, us, vs;
+
+        for (int r = 0; r < nPlanes; ++r)
+        {
+            const Region& reg = regions[r];
+            const int m = (int)reg.cells.size();
+
+            xs.resize(m); ys.resize(m); zs.resize(m);
+            for (int i = 0; i < m; ++i)
+            {
+                const int k = reg.cells[i];
+                xs[i] = cloud.x[k]; ys[i] = cloud.y[k]; zs[i] = cloud.z[k];
+            }
+
+            BoxFace face;
+            if (!FitPlaneLeastSquares(xs.data(), ys.data(), zs.data(), m, face.plane)) continue;
+
+            const float* pn = face.plane.n;
+            float nw[3] = {
+                T.r[0] * pn[0] + T.r[1] * pn[1] + T.r[2] * pn[2],
+                T.r[3] * pn[0] + T.r[4] * pn[1] + T.r[5] * pn[2],
+                T.r[6] * pn[0] + T.r[7] * pn[1] + T.r[8] * pn[2]
+            };
+            face.normalWorld[0] = nw[0];
+            face.normalWorld[1] = nw[1];
+            face.normalWorld[2] = nw[2];
+
+            // base del plano en el arco
+            // vertical u horizontal y v hacia arriba, superior u en X del arco y luego giramos a sus ejes
+            float u[3], v[3];
+            const bool top = nw[1] > 0.7f;
+            face.kind = top ? FaceKind::Top : FaceKind::Front;
+
+            if (top)
+            {
+                u[0] = 1.0f - nw[0] * nw[0]; u[1] = -nw[0] * nw[1]; u[2] = -nw[0] * nw[2];
+            }
+            else
+            {
+                // arriba x normal queda horizontal dentro del plano
+                u[0] = nw[2]; u[1] = 0.0f; u[2] = -nw[0];
+            }
+
+            float ul = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+            if (ul < 1e-6f) continue;
+            u[0] /= ul; u[1] /= ul; u[2] /= ul;
+
+            v[0] = nw[1] * u[2] - nw[2] * u[1];
+            v[1] = nw[2] * u[0] - nw[0] * u[2];
+            v[2] = nw[0] * u[1] - nw[1] * u[0];
+
+            us.resize(m); vs.resize(m);
+            for (int i = 0; i < m; ++i)
+            {
+                float wx = T.r[0] * xs[i] + T.r[1] * ys[i] + T.r[2] * zs[i];
+                float wy = T.r[3] * xs[i] + T.r[4] * ys[i] + T.r[5] * zs[i];
+                float wz = T.r[6] * xs[i] + T.r[7] * ys[i] + T.r[8] * zs[i];
+                us[i] = wx * u[0] + wy * u[1] + wz * u[2];
+                vs[i] = wx * v[0] + wy * v[1] + wz * v[2];
+            }
+
+            if (top)
+            {
+                // la superior puede estar girada en el suelo, ejes principales de u v
+                double mu = 0, mv = 0;
+                for (int i = 0; i < m; ++i) { mu += us[i]; mv += vs[i]; }
+                mu /= m; mv /= m;
+
+                double cuu = 0, cuv = 0, cvv = 0;
+                for (int i = 0; i < m; ++i)
+                {
+                    double du = us[i] - mu, dv = vs[i] - mv;
+                    cuu += du * du; cuv += du * dv; cvv += dv * dv;
+                }
+
+                const float th = 0.5f * (float)std::atan2(2.0 * cuv, cuu - cvv);
+                const float c = std::cos(th), sn = std::sin(th);
+                for (int i = 0; i < m; ++i)
+                {
+                    float a = us[i], b = vs[i];
+                    us[i] = c * a + sn * b;
+                    vs[i] = -sn * a + c * b;
+                }
+            }
+
+            float uLo = SelectPercentile(us, prm.qLow), uHi = SelectPercentile(us, prm.qHigh);
+            float vLo = SelectPercentile(vs, prm.qLow), vHi = SelectPercentile(vs, prm.qHigh);
+
+            face.widthM = uHi - uLo;
+            face.heightM = vHi - vLo;
+
+            // en la superior el ancho es el lado corto
+            if (top && face.widthM > face.heightM) std::swap(face.widthM, face.heightM);
+            face.areaM2 = face.widthM * face.heightM;
+
+            out.push_back(face);
+        }
+
+        // de las verticales la frontal es la que mas mira a la camara, el resto laterales
+        int front = -1;
+        for (int i = 0; i < (int)out.size(); ++i)
+        {
+            if (out[i].kind == FaceKind::Top) continue;
+            if (front < 0 || out[i].normalWorld[2] < out[front].normalWorld[2]) front = i;
+        }
+        for (int i = 0; i < (int)out.size(); ++i)
+            if (out[i].kind != FaceKind::Top && i != front) out[i].kind = FaceKind::Side;
+
+        return !out.empty();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include "BBBConfig.h"
+#include "BBBNormals.h"
+
+namespace BBB
+{
+    // plano n.p + d = 0 en sistema camara con n unitaria hacia la camara
+    struct PlaneFit
+    {
+        float n[3] = { 0, 0, -1 };
+        float d = 0.0f;
+        float centroid[3] = { 0, 0, 0 };
+        float rmsM = 0.0f;
+        int points = 0;
+    };
+
+    enum class FaceKind
+    {
+        Front = 0,
+        Top = 1,
+        Side = 2
+    };
+
+    struct BoxFace
+    {
+        FaceKind kind = FaceKind::Front;
+        PlaneFit plane;
+
+        // normal en el arco X lateral Y arriba Z delante
+        float normalWorld[3] = { 0, 0, -1 };
+
+        // medidas en coordenadas del plano
+        // caras verticales ancho horizontal y alto, cara superior ancho y largo en sus ejes principales
+        float widthM = 0.0f;
+        float heightM = 0.0f;
+        float areaM2 = 0.0f;
+    };
+
+    struct FaceSegParams
+    {
+        // crecimiento de region, angulo y distancia al plano de la region
+        float angleDeg = 12.0f;
+        float distM = 0.015f;
+
+        // semillas solo en celdas planas
+        float seedMaxCurvature = 0.01f;
+
+        int minRegionPoints = 300;
+        int maxPlanes = 3;
+
+        float qLow = 0.02f;
+        float qHigh = 0.98f;
+    };
+
+    class PlaneSegmentation
+    {
+    public:
+        // ajuste por minimos cuadrados sobre arrays SoA, sumas con SSE2 si hay
+        static bool FitPlaneLeastSquares(const float* xs, const float* ys, const float* zs, int n, PlaneFit& out);
+
+        // hasta maxPlanes planos dominantes del bulto por crecimiento de region con semillas
+        // ordenadas por curvatura, etiquetados frontal superior o lateral segun la normal en el arco
+        static bool SegmentBoxFaces(
+            const OrganizedCloud& cloud,
+            const NormalMap& normals,
+            const BBBCameraMount& mount,
+            const FaceSegParams& prm,
+            std::vector<BoxFace>& out
+        );
+
+        static const char* FaceName(FaceKind k);
+    };
+}
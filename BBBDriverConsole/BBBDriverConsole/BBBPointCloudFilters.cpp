@@ -1,7 +1,8 @@
 #include "BBBPointCloudFilters.h"
 
+#include "BBBKdTree.h"
+
 #include <unordered_map>
-#include <queue>
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
@@ -48,8 +49,9 @@ namespace BBB
         struct Acc
         {
             double sx = 0, sy = 0, sz = 0;
-            double sr = 0, sg = 0, sb = 0;
             int n = 0;
+            float bestD2 = 0;
+            int32_t pix = -1;
         };
 
         std::unordered_map<Key3, Acc, Key3Hash> m;
@@ -63,10 +65,21 @@ namespace BBB
             a.sx += p.x;
             a.sy += p.y;
             a.sz += p.z;
-            a.sr += p.r;
-            a.sg += p.g;
-            a.sb += p.b;
             a.n += 1;
+
+            // representante para el color y la normal diferidos, el mas cercano al centro de la celda
+            if (p.pix >= 0)
+            {
+                const float dx = p.x - ((float)k.x + 0.5f) * leaf;
+                const float dy = p.y - ((float)k.y + 0.5f) * leaf;
+                const float dz = p.z - ((float)k.z + 0.5f) * leaf;
+                const float d2 = dx * dx + dy * dy + dz * dz;
+                if (a.pix < 0 || d2 < a.bestD2)
+                {
+                    a.bestD2 = d2;
+                    a.pix = p.pix;
+                }
+            }
         }
 
         std::vector<Pt> out;
@@ -81,9 +94,7 @@ namespace BBB
             p.x = (float)(a.sx / a.n);
             p.y = (float)(a.sy / a.n);
             p.z = (float)(a.sz / a.n);
-            p.r = (uint8_t)std::clamp((int)std::lround(a.sr / a.n), 0, 255);
-            p.g = (uint8_t)std::clamp((int)std::lround(a.sg / a.n), 0, 255);
-            p.b = (uint8_t)std::clamp((int)std::lround(a.sb / a.n), 0, 255);
+            p.pix = a.pix;
 
             out.push_back(p);
         }
@@ -91,113 +102,120 @@ namespace BBB
         return out;
     }
 
-    std::vector<Pt> CloudFilters::RadiusOutlierRemoval(const std::vector<Pt>& in, float radius, int minNeighbors)
+    std::vector<Pt> CloudFilters::Compact(const std::vector<Pt>& in, const std::vector<uint8_t>& keep)
     {
-        if (in.empty()) return in;
-        if (radius <= 1e-6f) return in;
-        if (minNeighbors <= 1) return in;
+        std::vector<Pt> out;
+        out.reserve(in.size());
 
-        const float cell = radius;
-        const float r2 = radius * radius;
+        for (size_t i = 0; i < in.size() && i < keep.size(); ++i)
+            if (keep[i]) out.push_back(in[i]);
 
-        std::unordered_map<Key3, std::vector<int>, Key3Hash> grid;
-        grid.reserve(in.size());
+        return out;
+    }
 
-        for (int i = 0; i < (int)in.size(); ++i)
-        {
-            Key3 k = CellKey(in[i].x, in[i].y, in[i].z, cell);
-            grid[k].push_back(i);
-        }
+    void CloudFilters::RadiusOutlierMask(KdTree& index, float radius, int minNeighbors, std::vector<uint8_t>& keep)
+    {
+        if (radius <= 1e-6f || minNeighbors <= 1) return;
 
-        std::vector<Pt> out;
-        out.reserve(in.size());
+        index.SetMask(&keep);
 
-        for (int i = 0; i < (int)in.size(); ++i)
-        {
-            const Pt& p = in[i];
-            Key3 ck = CellKey(p.x, p.y, p.z, cell);
+        std::vector<int> counts;
+        index.RadiusCountAll(radius, minNeighbors, counts);
 
-            int neighbors = 0;
+        index.SetMask(nullptr);
 
-            for (int dz = -1; dz <= 1; ++dz)
-                for (int dy = -1; dy <= 1; ++dy)
-                    for (int dx = -1; dx <= 1; ++dx)
-                    {
-                        Key3 nk{ ck.x + dx, ck.y + dy, ck.z + dz };
-                        auto it = grid.find(nk);
-                        if (it == grid.end()) continue;
+        for (size_t i = 0; i < keep.size(); ++i)
+            if (keep[i] && counts[i] < minNeighbors) keep[i] = 0;
+    }
 
-                        const auto& lst = it->second;
-                        for (int j : lst)
-                        {
-                            if (j == i) continue;
-                            const Pt& q = in[j];
-
-                            float dx2 = p.x - q.x;
-                            float dy2 = p.y - q.y;
-                            float dz2 = p.z - q.z;
-                            float d2 = dx2 * dx2 + dy2 * dy2 + dz2 * dz2;
-
-                            if (d2 <= r2)
-                            {
-                                neighbors++;
-                                if (neighbors >= minNeighbors) break;
-                            }
-                        }
+    void CloudFilters::StatisticalOutlierMask(KdTree& index, int meanK, float stdMul, std::vector<uint8_t>& keep)
+    {
+        if (meanK <= 0) return;
+
+        index.SetMask(&keep);
+
+        std::vector<float> md;
+        index.MeanKnnDistanceAll(meanK, md);
 
-                        if (neighbors >= minNeighbors) break;
-                    }
+        index.SetMask(nullptr);
 
-            if (neighbors >= minNeighbors)
-                out.push_back(p);
+        double s = 0.0, s2 = 0.0;
+        size_t n = 0;
+        for (size_t i = 0; i < md.size(); ++i)
+        {
+            if (!keep[i]) continue;
+            s += md[i];
+            s2 += (double)md[i] * md[i];
+            n++;
         }
 
-        return out;
+        if (n <= (size_t)meanK) return;
+
+        const double mean = s / (double)n;
+        const double var = (std::max)(0.0, s2 / (double)n - mean * mean);
+        const float thr = (float)(mean + stdMul * std::sqrt(var));
+
+        for (size_t i = 0; i < keep.size(); ++i)
+            if (keep[i] && md[i] > thr) keep[i] = 0;
     }
 
-    std::vector<Pt> CloudFilters::KeepLargestCluster(const std::vector<Pt>& in, float cellSize)
+    void CloudFilters::LargestClusterMask(const std::vector<Pt>& pts, float cellSize, std::vector<uint8_t>& keep)
     {
-        if (in.empty()) return in;
-        if (cellSize <= 1e-6f) return in;
+        if (cellSize <= 1e-6f) return;
+
+        const int n = (int)pts.size();
 
-        std::unordered_map<Key3, std::vector<int>, Key3Hash> cells;
-        cells.reserve(in.size());
+        // celda de cada punto vivo, ids densos para no guardar un vector por celda
+        std::unordered_map<Key3, int, Key3Hash> cellId;
+        cellId.reserve(n / 4 + 16);
 
-        for (int i = 0; i < (int)in.size(); ++i)
+        std::vector<Key3> keys;
+        std::vector<int> cellCount;
+        std::vector<int> cellOf(n, -1);
+
+        for (int i = 0; i < n; ++i)
         {
-            Key3 k = CellKey(in[i].x, in[i].y, in[i].z, cellSize);
-            cells[k].push_back(i);
+            if (!keep[i]) continue;
+
+            Key3 k = CellKey(pts[i].x, pts[i].y, pts[i].z, cellSize);
+            auto it = cellId.try_emplace(k, (int)keys.size());
+            if (it.second)
+            {
+                keys.push_back(k);
+                cellCount.push_back(0);
+            }
+            cellOf[i] = it.first->second;
+            cellCount[it.first->second]++;
         }
 
-        std::unordered_map<Key3, int, Key3Hash> visited;
-        visited.reserve(cells.size());
+        const int nCells = (int)keys.size();
+        if (nCells <= 1) return;
 
-        int bestCount = -1;
-        std::vector<Key3> bestKeys;
+        // BFS por celdas con las 26 vecinas
+        std::vector<int> comp(nCells, -1);
+        std::vector<int> queue;
+        queue.reserve(nCells);
 
-        std::queue<Key3> q;
+        int bestComp = -1;
+        int bestCount = -1;
+        int nComp = 0;
 
-        for (auto& it : cells)
+        for (int start = 0; start < nCells; ++start)
         {
-            const Key3 start = it.first;
-            if (visited.find(start) != visited.end()) continue;
+            if (comp[start] >= 0) continue;
 
-            std::vector<Key3> compKeys;
+            const int c = nComp++;
             int compCount = 0;
 
-            visited[start] = 1;
-            q.push(start);
+            comp[start] = c;
+            queue.clear();
+            queue.push_back(start);
 
-            while (!q.empty())
+            for (size_t qi = 0; qi < queue.size(); ++qi)
             {
-                Key3 cur = q.front();
-                q.pop();
-
-                auto itc = cells.find(cur);
-                if (itc == cells.end()) continue;
-
-                compKeys.push_back(cur);
-                compCount += (int)itc->second.size();
+                const int cur = queue[qi];
+                const Key3 k = keys[cur];
+                compCount += cellCount[cur];
 
                 for (int dz = -1; dz <= 1; ++dz)
                     for (int dy = -1; dy <= 1; ++dy)
@@ -205,39 +223,62 @@ namespace BBB
                         {
                             if (dx == 0 && dy == 0 && dz == 0) continue;
 
-                            Key3 nb{ cur.x + dx, cur.y + dy, cur.z + dz };
-                            if (cells.find(nb) == cells.end()) continue;
-                            if (visited.find(nb) != visited.end()) continue;
+                            auto it = cellId.find(Key3{ k.x + dx, k.y + dy, k.z + dz });
+                            if (it == cellId.end() || comp[it->second] >= 0) continue;
 
-                            visited[nb] = 1;
-                            q.push(nb);
+                            comp[it->second] = c;
+                            queue.push_back(it->second);
                         }
             }
 
             if (compCount > bestCount)
             {
                 bestCount = compCount;
-                bestKeys.swap(compKeys);
+                bestComp = c;
             }
         }
 
-        if (bestCount <= 0) return in;
+        if (nComp <= 1) return;
 
-        std::unordered_map<Key3, int, Key3Hash> keep;
-        keep.reserve(bestKeys.size());
-        for (const auto& k : bestKeys) keep[k] = 1;
+        for (int i = 0; i < n; ++i)
+            if (cellOf[i] >= 0 && comp[cellOf[i]] != bestComp) keep[i] = 0;
+    }
 
-        std::vector<Pt> out;
-        out.reserve(bestCount);
+    std::vector<Pt> CloudFilters::RadiusOutlierRemoval(const std::vector<Pt>& in, float radius, int minNeighbors)
+    {
+        if (in.empty()) return in;
+        if (radius <= 1e-6f) return in;
+        if (minNeighbors <= 1) return in;
 
-        for (auto& it : cells)
-        {
-            if (keep.find(it.first) == keep.end()) continue;
-            for (int idx : it.second)
-                out.push_back(in[idx]);
-        }
+        KdTree index;
+        index.Build(in);
 
-        return out;
+        std::vector<uint8_t> keep(in.size(), 1);
+        RadiusOutlierMask(index, radius, minNeighbors, keep);
+        return Compact(in, keep);
+    }
+
+    std::vector<Pt> CloudFilters::StatisticalOutlierRemoval(const std::vector<Pt>& in, int meanK, float stdMul)
+    {
+        if (in.empty()) return in;
+        if (meanK <= 0 || (int)in.size() <= meanK) return in;
+
+        KdTree index;
+        index.Build(in);
+
+        std::vector<uint8_t> keep(in.size(), 1);
+        StatisticalOutlierMask(index, meanK, stdMul, keep);
+        return Compact(in, keep);
+    }
+
+    std::vector<Pt> CloudFilters::KeepLargestCluster(const std::vector<Pt>& in, float cellSize)
+    {
+        if (in.empty()) return in;
+        if (cellSize <= 1e-6f) return in;
+
+        std::vector<uint8_t> keep(in.size(), 1);
+        LargestClusterMask(in, cellSize, keep);
+        return Compact(in, keep);
     }
 
     // restamos vectores
@@ -1,15 +1,28 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace BBB
 {
-    // punto con color
+    // punto con color, 20 bytes para que los filtros recorran poca memoria
+    // pix es el pixel de origen y * ancho + x, -1 si no viene de una imagen
+    // el color se pone al final solo a los que sobreviven, ver Colorize
     struct Pt
     {
         float x = 0, y = 0, z = 0;
         uint8_t r = 0, g = 0, b = 0;
+        int32_t pix = -1;
+    };
+
+    // normales de una nube aparte en SoA, mismo indice que sus puntos
+    // solo se rellenan al exportar, ver Normals::Gather, a cero donde no hay normal
+    struct PointNormals
+    {
+        std::vector<float> nx, ny, nz;
+
+        size_t Size() const { return nx.size(); }
     };
 
     // vector 3 para plano suelo
@@ -24,18 +37,36 @@ namespace BBB
         float a = 0, b = 0, c = 0, d = 0;
     };
 
+    class KdTree;
+
     class CloudFilters
     {
     public:
         // voxel downsample promediando por celda
+        // pix es el del punto mas cercano al centro de la celda, el color sale a 0 y se pone despues por pix
         static std::vector<Pt> VoxelDownsample(const std::vector<Pt>& in, float leaf);
 
         // quitamos puntos aislados por radio y vecinos
         static std::vector<Pt> RadiusOutlierRemoval(const std::vector<Pt>& in, float radius, int minNeighbors);
 
-        // nos quedamos con el cluster mas grande en grid
+        // filtro estadistico con k-d tree, distancia media a meanK vecinos por punto
+        // quitamos los que pasan de la media global mas stdMul desviaciones
+        static std::vector<Pt> StatisticalOutlierRemoval(const std::vector<Pt>& in, int meanK, float stdMul);
+
+        // nos quedamos con el cluster mas grande, BFS por celdas de lado cellSize con las 26 vecinas
         static std::vector<Pt> KeepLargestCluster(const std::vector<Pt>& in, float cellSize);
 
+        // versiones sobre un indice ya construido para pagar el arbol una vez por nube
+        // keep va por indice de la nube del indice, solo miran los puntos a 1 y solo ponen ceros
+        static void RadiusOutlierMask(KdTree& index, float radius, int minNeighbors, std::vector<uint8_t>& keep);
+        static void StatisticalOutlierMask(KdTree& index, int meanK, float stdMul, std::vector<uint8_t>& keep);
+
+        // el cluster va por celdas, no necesita el indice, misma convencion de keep
+        static void LargestClusterMask(const std::vector<Pt>& pts, float cellSize, std::vector<uint8_t>& keep);
+
+        // copiamos solo los puntos con keep a 1
+        static std::vector<Pt> Compact(const std::vector<Pt>& in, const std::vector<uint8_t>& keep);
+
         // ransac de plano del suelo usando candidatos de la parte baja
         static bool FitGroundPlaneRANSAC(const std::vector<V3>& candidates, int iters, float thrM, float pitchDeg, Plane& bestPlane);
 
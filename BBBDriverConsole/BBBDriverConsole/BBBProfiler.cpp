@@ -0,0 +1,357 @@
+#include "BBBProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace BBB
+{
+    static const int kStages = (int)Stage::Count;
+    static const int kBuckets = LatencyHistogram::kBucketCount;
+
+    // un solo escritor por hueco, load y store relajados bastan y no hay RMW
+    template <typename T>
+    static inline void Bump(std::atomic<T>& a, T v)
+    {
+        a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    struct StageSlot
+    {
+        std::atomic<uint64_t> buckets[kBuckets];
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<double> sumUs{ 0.0 };
+        std::atomic<double> sumSqUs{ 0.0 };
+        std::atomic<double> minUs{ 0.0 };
+        std::atomic<double> maxUs{ 0.0 };
+        std::atomic<uint64_t> pointsIn{ 0 };
+        std::atomic<uint64_t> pointsOut{ 0 };
+
+        // contadores de CPU, solo de las llamadas que los pudieron leer
+        std::atomic<uint64_t> counterCalls{ 0 };
+        std::atomic<uint64_t> counterPoints{ 0 };
+        std::atomic<uint64_t> cycles{ 0 };
+        std::atomic<uint64_t> instructions{ 0 };
+        std::atomic<uint64_t> cacheMisses{ 0 };
+        std::atomic<uint64_t> branchMisses{ 0 };
+        std::atomic<uint64_t> pageFaults{ 0 };
+        std::atomic<uint32_t> counterValid{ 0 };
+
+        StageSlot()
+        {
+            for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct ThreadSlots
+    {
+        StageSlot stages[kStages];
+    };
+
+    // el registro solo se toca al aparecer un hilo nuevo y al sacar el resumen
+    static std::mutex& RegistryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<std::unique_ptr<ThreadSlots>>& Registry()
+    {
+        static std::vector<std::unique_ptr<ThreadSlots>> r;
+        return r;
+    }
+
+    static ThreadSlots& Mine()
+    {
+        static thread_local ThreadSlots* mine = nullptr;
+        if (!mine)
+        {
+            auto slots = std::make_unique<ThreadSlots>();
+            mine = slots.get();
+
+            std::lock_guard<std::mutex> lk(RegistryMutex());
+            Registry().push_back(std::move(slots));
+        }
+        return *mine;
+    }
+
+    const char* Profiler::StageName(Stage s)
+    {
+        switch (s)
+        {
+        case Stage::Capture: return "captura";
+        case Stage::Speckle: return "speckle";
+        case Stage::GuidedFill: return "relleno";
+        case Stage::Reprojection: return "mediana+reproy";
+        case Stage::Normals: return "normales";
+        case Stage::FrontClamp: return "corte fondo";
+        case Stage::Voxel: return "voxel";
+        case Stage::Outlier: return "outlier";
+        case Stage::Cluster: return "cluster";
+        case Stage::Measurement: return "medida";
+        case Stage::Colorize: return "color";
+        case Stage::WritePGM: return "escribir PGM";
+        case Stage::WritePNG: return "escribir PNG";
+        case Stage::WritePLY: return "escribir PLY";
+        case Stage::WriteLOD: return "escribir LOD";
+        default: return "?";
+        }
+    }
+
+    void Profiler::Record(Stage s, double us, size_t pointsIn, size_t pointsOut)
+    {
+        if ((int)s < 0 || (int)s >= kStages) return;
+        if (!(us >= 0.0)) us = 0.0;
+
+        StageSlot& st = Mine().stages[(int)s];
+
+        Bump(st.buckets[LatencyHistogram::BucketOf((uint64_t)us)], (uint64_t)1);
+
+        const uint64_t n = st.count.load(std::memory_order_relaxed);
+        if (n == 0 || us < st.minUs.load(std::memory_order_relaxed)) st.minUs.store(us, std::memory_order_relaxed);
+        if (us > st.maxUs.load(std::memory_order_relaxed)) st.maxUs.store(us, std::memory_order_relaxed);
+
+        Bump(st.sumUs, us);
+        Bump(st.sumSqUs, us * us);
+        Bump(st.pointsIn, (uint64_t)pointsIn);
+        Bump(st.pointsOut, (uint64_t)pointsOut);
+
+        // count el ultimo, quien lo lea con acquire ve el resto de la muestra
+        st.count.store(n + 1, std::memory_order_release);
+    }
+
+    void Profiler::RecordCounters(Stage s, const PerfSample& d, size_t points)
+    {
+        if ((int)s < 0 || (int)s >= kStages || d.valid == 0) return;
+
+        StageSlot& st = Mine().stages[(int)s];
+
+        Bump(st.cycles, d.cycles);
+        Bump(st.instructions, d.instructions);
+        Bump(st.cacheMisses, d.cacheMisses);
+        Bump(st.branchMisses, d.branchMisses);
+        Bump(st.pageFaults, d.pageFaults);
+        Bump(st.counterPoints, (uint64_t)points);
+        st.counterValid.store(st.counterValid.load(std::memory_order_relaxed) | d.valid, std::memory_order_relaxed);
+        st.counterCalls.store(st.counterCalls.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // suma de contadores de todos los hilos para una etapa
+    struct CounterTotals
+    {
+        uint64_t calls = 0;
+        uint64_t points = 0;
+        PerfSample sum;
+    };
+
+    static CounterTotals SnapshotCounters(int s)
+    {
+        CounterTotals t;
+
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        for (const auto& th : Registry())
+        {
+            const StageSlot& st = th->stages[s];
+
+            const uint64_t n = st.counterCalls.load(std::memory_order_acquire);
+            if (n == 0) continue;
+
+            t.calls += n;
+            t.points += st.counterPoints.load(std::memory_order_relaxed);
+            t.sum.cycles += st.cycles.load(std::memory_order_relaxed);
+            t.sum.instructions += st.instructions.load(std::memory_order_relaxed);
+            t.sum.cacheMisses += st.cacheMisses.load(std::memory_order_relaxed);
+            t.sum.branchMisses += st.branchMisses.load(std::memory_order_relaxed);
+            t.sum.pageFaults += st.pageFaults.load(std::memory_order_relaxed);
+            t.sum.valid |= st.counterValid.load(std::memory_order_relaxed);
+        }
+
+        return t;
+    }
+
+    LatencyHistogram Profiler::Snapshot(Stage s, size_t& pointsIn, size_t& pointsOut)
+    {
+        LatencyHistogram all;
+        pointsIn = pointsOut = 0;
+        if ((int)s < 0 || (int)s >= kStages) return all;
+
+        std::vector<uint64_t> counts(kBuckets);
+
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        for (const auto& t : Registry())
+        {
+            const StageSlot& st = t->stages[(int)s];
+
+            const uint64_t n = st.count.load(std::memory_order_acquire);
+            if (n == 0) continue;
+
+            // el escritor puede ir por delante, el total lo sacamos de las cubetas leidas
+            uint64_t inBuckets = 0;
+            for (int b = 0; b < kBuckets; ++b)
+            {
+                counts[b] = st.buckets[b].load(std::memory_order_relaxed);
+                inBuckets += counts[b];
+            }
+
+            all.Merge(LatencyHistogram::FromCounts(counts.data(), inBuckets,
+                st.sumUs.load(std::memory_order_relaxed), st.sumSqUs.load(std::memory_order_relaxed),
+                st.minUs.load(std::memory_order_relaxed), st.maxUs.load(std::memory_order_relaxed)));
+
+            pointsIn += (size_t)st.pointsIn.load(std::memory_order_relaxed);
+            pointsOut += (size_t)st.pointsOut.load(std::memory_order_relaxed);
+        }
+
+        return all;
+    }
+
+    void Profiler::Print(std::ostream& os)
+    {
+        const std::ios::fmtflags flags = os.flags();
+        const std::streamsize prec = os.precision();
+
+        os << "Tiempos por etapa en ms, puntos medios por llamada\n";
+        os << std::left << std::setw(16) << "etapa" << std::right
+            << std::setw(8) << "n" << std::setw(10) << "media" << std::setw(10) << "p50"
+            << std::setw(10) << "p99" << std::setw(10) << "max"
+            << std::setw(12) << "entran" << std::setw(12) << "salen" << "\n";
+
+        os << std::fixed << std::setprecision(2);
+        for (int i = 0; i < kStages; ++i)
+        {
+            size_t in = 0, out = 0;
+            const LatencyHistogram h = Snapshot((Stage)i, in, out);
+            if (h.Count() == 0) continue;
+
+            const double n = (double)h.Count();
+            os << std::left << std::setw(16) << StageName((Stage)i) << std::right
+                << std::setw(8) << h.Count()
+                << std::setw(10) << h.Mean() / 1000.0
+                << std::setw(10) << h.Percentile(50.0) / 1000.0
+                << std::setw(10) << h.Percentile(99.0) / 1000.0
+                << std::setw(10) << h.Max() / 1000.0
+                << std::setw(12) << std::setprecision(0) << (double)in / n
+                << std::setw(12) << (double)out / n << std::setprecision(2) << "\n";
+        }
+
+        os.flags(flags);
+        os.precision(prec);
+
+        PrintCounters(os);
+    }
+
+    void Profiler::PrintCounters(std::ostream& os)
+    {
+        const std::ios::fmtflags flags = os.flags();
+
+        // IPC bajo y muchos fallos de cache por punto apuntan a etapa limitada por memoria
+        bool header = false;
+        for (int i = 0; i < kStages; ++i)
+        {
+            const CounterTotals t = SnapshotCounters(i);
+            if (t.calls == 0) continue;
+
+            if (!header)
+            {
+                os << "Contadores de CPU por punto, - si el sistema no lo da\n";
+                os << std::left << std::setw(16) << "etapa" << std::right
+                    << std::setw(8) << "n" << std::setw(8) << "IPC" << std::setw(12) << "ciclos"
+                    << std::setw(12) << "f cache" << std::setw(12) << "f salto" << std::setw(12) << "f pagina" << "\n";
+                header = true;
+            }
+
+            const double pts = (double)(std::max)((uint64_t)1, t.points);
+            auto PerPoint = [&](uint32_t bit, uint64_t v, int prec)
+                {
+                    std::ostringstream s;
+                    if (t.sum.valid & bit) s << std::fixed << std::setprecision(prec) << (double)v / pts;
+                    else s << "-";
+                    return s.str();
+                };
+
+            std::ostringstream ipc;
+            if ((t.sum.valid & PerfSample::kCycles) && (t.sum.valid & PerfSample::kInstructions) && t.sum.cycles > 0)
+                ipc << std::fixed << std::setprecision(2) << (double)t.sum.instructions / (double)t.sum.cycles;
+            else
+                ipc << "-";
+
+            os << std::left << std::setw(16) << StageName((Stage)i) << std::right
+                << std::setw(8) << t.calls
+                << std::setw(8) << ipc.str()
+                << std::setw(12) << PerPoint(PerfSample::kCycles, t.sum.cycles, 1)
+                << std::setw(12) << PerPoint(PerfSample::kCacheMisses, t.sum.cacheMisses, 3)
+                << std::setw(12) << PerPoint(PerfSample::kBranchMisses, t.sum.branchMisses, 3)
+                << std::setw(12) << PerPoint(PerfSample::kPageFaults, t.sum.pageFaults, 4) << "\n";
+        }
+
+        os.flags(flags);
+    }
+
+    // hilo del resumen periodico, arranca con el primer intervalo distinto de 0
+    class ProfileReporter
+    {
+    public:
+        ~ProfileReporter()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                intervalSec = 0;
+                quit = true;
+            }
+            cv.notify_all();
+            if (worker.joinable()) worker.join();
+        }
+
+        void SetInterval(int sec)
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                intervalSec = sec > 0 ? sec : 0;
+            }
+            cv.notify_all();
+
+            if (sec > 0 && !worker.joinable())
+                worker = std::thread([this]() { Run(); });
+        }
+
+    private:
+        void Run()
+        {
+            std::unique_lock<std::mutex> lk(m);
+            while (!quit)
+            {
+                if (intervalSec == 0)
+                {
+                    cv.wait(lk);
+                    continue;
+                }
+
+                const int sec = intervalSec;
+                if (cv.wait_for(lk, std::chrono::seconds(sec), [&]() { return quit || intervalSec != sec; }))
+                    continue;
+
+                lk.unlock();
+                Profiler::Print(std::cout);
+                lk.lock();
+            }
+        }
+
+        std::mutex m;
+        std::condition_variable cv;
+        std::thread worker;
+        int intervalSec = 0;
+        bool quit = false;
+    };
+
+    void Profiler::SetReportInterval(int sec)
+    {
+        static ProfileReporter reporter;
+        reporter.SetInterval(sec);
+    }
+}
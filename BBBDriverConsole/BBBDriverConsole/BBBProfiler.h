@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include "BBBLatencyHistogram.h"
+#include "BBBPerfCounters.h"
+#include "BBBTrace.h"
+
+namespace BBB
+{
+    // etapas del ciclo de una camara, el orden es el de la tabla del resumen
+    enum class Stage : int
+    {
+        Capture,
+        Speckle,
+        GuidedFill,
+        Reprojection,
+        Normals,
+        FrontClamp,
+        Voxel,
+        Outlier,
+        Cluster,
+        Measurement,
+        Colorize,
+        WritePGM,
+        WritePNG,
+        WritePLY,
+        WriteLOD,
+        Count
+    };
+
+    // tiempos y puntos por etapa, cada hilo escribe solo en sus contadores sin locks
+    // el resumen junta los de todos los hilos, tambien los de hilos ya terminados
+    class Profiler
+    {
+    public:
+        static const char* StageName(Stage s);
+
+        static void Record(Stage s, double us, size_t pointsIn, size_t pointsOut);
+
+        // contadores de CPU de una llamada, points es con lo que se reparten por punto
+        static void RecordCounters(Stage s, const PerfSample& delta, size_t points);
+
+        // acumulado de todos los hilos desde el arranque
+        static LatencyHistogram Snapshot(Stage s, size_t& pointsIn, size_t& pointsOut);
+
+        // tabla con una fila por etapa que tenga llamadas, y la de contadores si hay
+        static void Print(std::ostream& os);
+
+        // solo la de contadores, nada si ninguna etapa los pudo leer
+        static void PrintCounters(std::ostream& os);
+
+        // hilo que imprime la tabla cada sec segundos, 0 lo para
+        static void SetReportInterval(int sec);
+    };
+
+    // cronometro de una etapa, registra al salir del ambito y si hay traza deja su tramo
+    // con PerfCounters encendido lee los contadores del hilo al entrar y al salir
+    // y les suma lo que los hilos del pool hicieron para ella dentro de Parallel::For
+    class ScopedStage
+    {
+    public:
+        explicit ScopedStage(Stage s, size_t pointsIn = 0) : stage(s), in(pointsIn), out(pointsIn)
+        {
+            counting = PerfCounters::Enabled() && PerfCounters::Read(c0);
+            if (counting)
+            {
+                outer = PerfCounters::Sink();
+                PerfCounters::SetSink(&pool);
+            }
+            t0 = std::chrono::steady_clock::now();
+        }
+
+        ~ScopedStage() { Stop(); }
+
+        // registra ya, para cuando la etapa acaba antes que el ambito
+        void Stop()
+        {
+            if (stopped) return;
+            stopped = true;
+
+            const auto t1 = std::chrono::steady_clock::now();
+
+            if (counting)
+            {
+                PerfCounters::SetSink(outer);
+
+                // lo del pool tambien es de la etapa de fuera, el hilo ya lo lleva en sus contadores
+                if (outer) outer->Add(pool.Load());
+
+                PerfSample c1;
+                if (PerfCounters::Read(c1))
+                    Profiler::RecordCounters(stage, pool.AddTo(PerfCounters::Delta(c0, c1)), in > 0 ? in : out);
+            }
+
+            Profiler::Record(stage, std::chrono::duration<double, std::micro>(t1 - t0).count(), in, out);
+            if (Trace::Enabled()) Trace::Complete(Profiler::StageName(stage), t0, t1);
+        }
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+        void PointsIn(size_t n) { in = n; }
+        void PointsOut(size_t n) { out = n; }
+
+    private:
+        Stage stage;
+        size_t in;
+        size_t out;
+        bool stopped = false;
+        bool counting = false;
+        PerfSample c0;
+        PerfAccumulator pool;
+        PerfAccumulator* outer = nullptr;
+        std::chrono::steady_clock::time_point t0;
+    };
+}
@@ -0,0 +1,373 @@
+#include "BBBRegistration.h"
+
+#include "BBBKdTree.h"
+#include "BBBParallel.h"
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+namespace BBB
+{
+    static void TransformPoint(const Rigid& T, float x, float y, float z, float& ox, float& oy, float& oz)
+    {
+        ox = T.r[0] * x + T.r[1] * y + T.r[2] * z + T.t[0];
+        oy = T.r[3] * x + T.r[4] * y + T.r[5] * z + T.t[1];
+        oz = T.r[6] * x + T.r[7] * y + T.r[8] * z + T.t[2];
+    }
+
+    // matriz de rotacion desde vector eje angulo
+    static void RotationFromOmega(double wx, double wy, double wz, float r[9])
+    {
+        double th = std::sqrt(wx * wx + wy * wy + wz * wz);
+        if (th < 1e-12)
+        {
+            float id[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+            std::copy(id, id + 9, r);
+            return;
+        }
+
+        double kx = wx / th, ky = wy / th, kz = wz / th;
+        double c = std::cos(th), s = std::sin(th), v = 1.0 - c;
+
+        r[0] = (float)(c + kx * kx * v);
+        r[1] = (float)(kx * ky * v - kz * s);
+        r[2] = (float)(kx * kz * v + ky * s);
+        r[3] = (float)(ky * kx * v + kz * s);
+        r[4] = (float)(c + ky * ky * v);
+        r[5] = (float)(ky * kz * v - kx * s);
+        r[6] = (float)(kz * kx * v - ky * s);
+        r[7] = (float)(kz * ky * v + kx * s);
+        r[8] = (float)(c + kz * kz * v);
+    }
+
+    // resolvemos A x = b con A 6x6 simetrica definida positiva
+    static bool SolveCholesky6(double A[36], double b[6], double x[6])
+    {
+        double L[36] = { 0 };
+
+        for (int i = 0; i < 6; ++i)
+        {
+            for (int j = 0; j <= i; ++j)
+            {
+                double s = A[i * 6 + j];
+                for (int k = 0; k < j; ++k) s -= L[i * 6 + k] * L[j * 6 + k];
+
+                if (i == j)
+                {
+                    if (s <= 1e-18) return false;
+                    L[i * 6 + i] = std::sqrt(s);
+                }
+                else
+                {
+                    L[i * 6 + j] = s / L[j * 6 + j];
+                }
+            }
+        }
+
+        double y[6];
+        for (int i = 0; i < 6; ++i)
+        {
+            double s = b[i];
+            for (int k = 0; k < i; ++k) s -= L[i * 6 + k] * y[k];
+            y[i] = s / L[i * 6 + i];
+        }
+        for (int i = 5; i >= 0; --i)
+        {
+            double s = y[i];
+            for (int k = i + 1; k < 6; ++k) s -= L[k * 6 + i] * x[k];
+            x[i] = s / L[i * 6 + i];
+        }
+        return true;
+    }
+
+    // normales del destino por PCA de vecinos en radio
+    static void EstimateNormals(const std::vector<Pt>& pts, const KdTree& index, float radius, std::vector<V3>& normals, std::vector<uint8_t>& valid)
+    {
+        normals.assign(pts.size(), V3{});
+        valid.assign(pts.size(), 0);
+
+        Parallel::For(0, (int)pts.size(), 256, [&](int b, int e)
+            {
+                std::vector<int> nb;
+
+                for (int i = b; i < e; ++i)
+                {
+                    const Pt& p = pts[i];
+
+                    double sx = 0, sy = 0, sz = 0;
+                    double sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+                    int n = 0;
+
+                    index.RadiusSearch(p.x, p.y, p.z, radius, nb);
+                    for (int j : nb)
+                    {
+                        const Pt& q = pts[j];
+                        double dx = q.x - p.x, dy = q.y - p.y, dz = q.z - p.z;
+
+                        sx += dx; sy += dy; sz += dz;
+                        sxx += dx * dx; sxy += dx * dy; sxz += dx * dz;
+                        syy += dy * dy; syz += dy * dz; szz += dz * dz;
+                        n++;
+                    }
+
+                    if (n < 5) continue;
+
+                    double inv = 1.0 / n;
+                    double mx = sx * inv, my = sy * inv, mz = sz * inv;
+                    double cov[6] = {
+                        sxx * inv - mx * mx, sxy * inv - mx * my, sxz * inv - mx * mz,
+                        syy * inv - my * my, syz * inv - my * mz, szz * inv - mz * mz
+                    };
+
+                    double ev[3], evec[9];
+                    VisionMath::SymEigen3(cov, ev, evec);
+
+                    // descartamos zonas casi isotropas donde la normal no significa nada
+                    double sum = ev[0] + ev[1] + ev[2];
+                    if (sum <= 1e-12 || ev[0] / sum > 0.15) continue;
+
+                    normals[i] = V3{ (float)evec[0], (float)evec[1], (float)evec[2] };
+                    valid[i] = 1;
+                }
+            });
+    }
+
+    bool Registration::AlignPointToPlane(
+        const std::vector<Pt>& source,
+        const std::vector<Pt>& target,
+        const Rigid& initial,
+        const IcpParams& prm,
+        IcpResult& out)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+
+        out = IcpResult{};
+        out.transform = initial;
+
+        if (source.empty() || target.empty() || prm.voxelSchedule.empty()) return false;
+
+        Rigid T = initial;
+        bool anyLevelOk = false;
+
+        for (float leaf : prm.voxelSchedule)
+        {
+            if (leaf <= 1e-6f) continue;
+
+            std::vector<Pt> src = CloudFilters::VoxelDownsample(source, leaf);
+            std::vector<Pt> tgt = CloudFilters::VoxelDownsample(target, leaf);
+
+            const float maxCorr = leaf * prm.maxCorrLeafFactor;
+            const float maxCorr2 = maxCorr * maxCorr;
+            const float huber = leaf;
+
+            KdTree index;
+            index.Build(tgt);
+
+            std::vector<V3> normals;
+            std::vector<uint8_t> valid;
+            EstimateNormals(tgt, index, (std::min)(maxCorr, leaf * prm.normalRadiusLeafFactor), normals, valid);
+
+            // las correspondencias solo contra puntos con normal
+            index.SetMask(&valid);
+
+            bool levelOk = false;
+
+            for (int it = 0; it < prm.maxItersPerLevel; ++it)
+            {
+                double A[36] = { 0 };
+                double bvec[6] = { 0 };
+                double sumSq = 0.0;
+                int count = 0;
+
+                std::mutex mtx;
+
+                // acumulamos JtJ y Jtr por bloques y luego sumamos
+                Parallel::For(0, (int)src.size(), 512, [&](int b, int e)
+                    {
+                        double lA[36] = { 0 };
+                        double lb[6] = { 0 };
+                        double lSq = 0.0;
+                        int lCount = 0;
+
+                        for (int i = b; i < e; ++i)
+                        {
+                            float px, py, pz;
+                            TransformPoint(T, src[i].x, src[i].y, src[i].z, px, py, pz);
+
+                            int best = -1;
+                            float bestD2 = maxCorr2;
+                            if (!index.Nearest(px, py, pz, maxCorr2, best, bestD2)) continue;
+
+                            const V3& n = normals[best];
+                            const Pt& q = tgt[best];
+
+                            double r = n.x * (px - q.x) + n.y * (py - q.y) + n.z * (pz - q.z);
+                            double ar = std::fabs(r);
+                            double w = (ar <= huber) ? 1.0 : huber / ar;
+
+                            // J = [p x n, n]
+                            double J[6] = {
+                                py * n.z - pz * n.y,
+                                pz * n.x - px * n.z,
+                                px * n.y - py * n.x,
+                                n.x, n.y, n.z
+                            };
+
+                            for (int a = 0; a < 6; ++a)
+                            {
+                                for (int c = a; c < 6; ++c) lA[a * 6 + c] += w * J[a] * J[c];
+                                lb[a] -= w * J[a] * r;
+                            }
+
+                            lSq += r * r;
+                            lCount++;
+                        }
+
+                        std::lock_guard<std::mutex> lk(mtx);
+                        for (int k = 0; k < 36; ++k) A[k] += lA[k];
+                        for (int k = 0; k < 6; ++k) bvec[k] += lb[k];
+                        sumSq += lSq;
+                        count += lCount;
+                    });
+
+                if (count < prm.minCorrespondences) break;
+
+                for (int a = 0; a < 6; ++a)
+                    for (int c = 0; c < a; ++c)
+                        A[a * 6 + c] = A[c * 6 + a];
+
+                // amortiguamos un poco para que no reviente con geometria degenerada
+                for (int a = 0; a < 6; ++a) A[a * 6 + a] += 1e-6 * (A[a * 6 + a] + 1.0);
+
+                double x[6];
+                if (!SolveCholesky6(A, bvec, x)) break;
+
+                Rigid D;
+                RotationFromOmega(x[0], x[1], x[2], D.r);
+                D.t[0] = (float)x[3];
+                D.t[1] = (float)x[4];
+                D.t[2] = (float)x[5];
+
+                T = Compose(D, T);
+
+                out.iterations++;
+                out.correspondences = count;
+                out.rmsM = (float)std::sqrt(sumSq / count);
+                levelOk = true;
+
+                double rotDeg = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]) * 180.0 / 3.14159265358979323846;
+                double trans = std::sqrt(x[3] * x[3] + x[4] * x[4] + x[5] * x[5]);
+                if (rotDeg < prm.stopRotDeg && trans < prm.stopTransM) break;
+            }
+
+            anyLevelOk = anyLevelOk || levelOk;
+        }
+
+        out.transform = T;
+        out.converged = anyLevelOk;
+        out.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        return anyLevelOk;
+    }
+
+    void Registration::Apply(const Rigid& T, std::vector<Pt>& pts)
+    {
+        Parallel::For(0, (int)pts.size(), 4096, [&](int b, int e)
+            {
+                for (int i = b; i < e; ++i)
+                {
+                    Pt& p = pts[i];
+                    float x, y, z;
+                    TransformPoint(T, p.x, p.y, p.z, x, y, z);
+                    p.x = x; p.y = y; p.z = z;
+                }
+            });
+    }
+
+    Rigid Registration::Compose(const Rigid& a, const Rigid& b)
+    {
+        Rigid o;
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+                o.r[i * 3 + j] = a.r[i * 3 + 0] * b.r[0 + j] + a.r[i * 3 + 1] * b.r[3 + j] + a.r[i * 3 + 2] * b.r[6 + j];
+
+            o.t[i] = a.r[i * 3 + 0] * b.t[0] + a.r[i * 3 + 1] * b.t[1] + a.r[i * 3 + 2] * b.t[2] + a.t[i];
+        }
+        return o;
+    }
+
+    Rigid Registration::Inverse(const Rigid& T)
+    {
+        Rigid o;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                o.r[i * 3 + j] = T.r[j * 3 + i];
+
+        for (int i = 0; i < 3; ++i)
+            o.t[i] = -(o.r[i * 3 + 0] * T.t[0] + o.r[i * 3 + 1] * T.t[1] + o.r[i * 3 + 2] * T.t[2]);
+        return o;
+    }
+
+    // R = Ry(yaw) Rx(pitch) Rz(roll) F con F dando la vuelta a Y de camara
+    // con yaw y roll a cero coincide con VisionMath::HeightAboveGroundM
+    Rigid Registration::MountToWorld(const BBBCameraMount& mount)
+    {
+        double a = VisionMath::DegToRad(mount.yawDeg);
+        double b = VisionMath::DegToRad(mount.pitchDeg);
+        double c = VisionMath::DegToRad(mount.rollDeg);
+
+        double ca = std::cos(a), sa = std::sin(a);
+        double cb = std::cos(b), sb = std::sin(b);
+        double cc = std::cos(c), sc = std::sin(c);
+
+        double M[9] = {
+            ca * cc + sa * sb * sc, -ca * sc + sa * sb * cc, sa * cb,
+            cb * sc, cb * cc, -sb,
+            -sa * cc + ca * sb * sc, sa * sc + ca * sb * cc, ca * cb
+        };
+
+        Rigid T;
+        for (int i = 0; i < 3; ++i)
+        {
+            T.r[i * 3 + 0] = (float)M[i * 3 + 0];
+            T.r[i * 3 + 1] = (float)-M[i * 3 + 1];
+            T.r[i * 3 + 2] = (float)M[i * 3 + 2];
+        }
+
+        T.t[0] = mount.posXM;
+        T.t[1] = mount.alturaCamaraM;
+        T.t[2] = mount.posZM;
+        return T;
+    }
+
+    void Registration::WorldToMount(const Rigid& camToWorld, BBBCameraMount& mount)
+    {
+        // quitamos F para quedarnos con Ry Rx Rz
+        double M[9];
+        for (int i = 0; i < 3; ++i)
+        {
+            M[i * 3 + 0] = camToWorld.r[i * 3 + 0];
+            M[i * 3 + 1] = -camToWorld.r[i * 3 + 1];
+            M[i * 3 + 2] = camToWorld.r[i * 3 + 2];
+        }
+
+        const double rad2deg = 180.0 / 3.14159265358979323846;
+
+        double b = std::asin(std::clamp(-M[5], -1.0, 1.0));
+        double a = std::atan2(M[2], M[8]);
+        double c = std::atan2(M[3], M[4]);
+
+        mount.yawDeg = (float)(a * rad2deg);
+        mount.pitchDeg = (float)(b * rad2deg);
+        mount.rollDeg = (float)(c * rad2deg);
+
+        mount.posXM = camToWorld.t[0];
+        mount.alturaCamaraM = camToWorld.t[1];
+        mount.posZM = camToWorld.t[2];
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "BBBConfig.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    // transformacion rigida p' = R p + t con R por filas
+    struct Rigid
+    {
+        float r[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+        float t[3] = { 0, 0, 0 };
+    };
+
+    struct IcpParams
+    {
+        // leafs de grueso a fino, en cada nivel bajamos resolucion de las dos nubes
+        std::vector<float> voxelSchedule = { 0.08f, 0.04f, 0.02f };
+
+        int maxItersPerLevel = 20;
+
+        // distancia maxima de correspondencia en multiplos del leaf del nivel
+        float maxCorrLeafFactor = 3.0f;
+
+        // radio para normales del destino en multiplos del leaf
+        float normalRadiusLeafFactor = 2.5f;
+
+        // paramos el nivel cuando el paso es menor que esto
+        float stopRotDeg = 0.01f;
+        float stopTransM = 0.0002f;
+
+        int minCorrespondences = 150;
+    };
+
+    struct IcpResult
+    {
+        Rigid transform;
+        float rmsM = 0.0f;
+        int correspondences = 0;
+        int iterations = 0;
+        bool converged = false;
+        double elapsedMs = 0.0;
+    };
+
+    class Registration
+    {
+    public:
+        // ICP punto a plano de source sobre target partiendo de initial
+        // el resultado lleva source al sistema de target
+        static bool AlignPointToPlane(
+            const std::vector<Pt>& source,
+            const std::vector<Pt>& target,
+            const Rigid& initial,
+            const IcpParams& prm,
+            IcpResult& out
+        );
+
+        // aplicamos T a todos los puntos
+        static void Apply(const Rigid& T, std::vector<Pt>& pts);
+
+        // a * b, primero b y luego a
+        static Rigid Compose(const Rigid& a, const Rigid& b);
+
+        static Rigid Inverse(const Rigid& T);
+
+        // camara X derecha Y abajo Z delante a arco X lateral Y arriba Z delante
+        static Rigid MountToWorld(const BBBCameraMount& mount);
+
+        // inverso de MountToWorld, rellenamos altura pitch yaw roll y posicion
+        static void WorldToMount(const Rigid& camToWorld, BBBCameraMount& mount);
+    };
+}
@@ -0,0 +1,207 @@
+#include "BBBReprojection.h"
+
+#include "BBBVisionMath.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace BBB
+{
+    // bits de la variante, el indice de la tabla es la suma
+    enum : int
+    {
+        kFlag16 = 8,
+        kFlagMedian = 4,
+        kFlagInvalid = 2,
+        kFlagGround = 1
+    };
+
+    template <bool k16>
+    static inline uint16_t ReadRaw(const uint8_t* row, int x)
+    {
+        if (k16) return ((const uint16_t*)row)[x];
+        return (uint16_t)row[x];
+    }
+
+    template <bool kInvalid>
+    static inline bool IsValidRaw(uint16_t raw, uint16_t invalidValue)
+    {
+        return (raw != 0) & (!kInvalid | (raw != invalidValue));
+    }
+
+    // mediana de los validos del 3x3 recortado a la imagen, 0 si no hay ninguno
+    // como mucho 9 valores, la insercion gana a std::sort
+    template <bool k16, bool kInvalid>
+    static inline uint16_t MedianRaw3x3(const DisparityView& disp, int x, int y, uint16_t invalidValue)
+    {
+        uint16_t vals[9];
+        int n = 0;
+
+        const int yA = (std::max)(0, y - 1), yB = (std::min)(disp.height - 1, y + 1);
+        const int xA = (std::max)(0, x - 1), xB = (std::min)(disp.width - 1, x + 1);
+
+        for (int yy = yA; yy <= yB; ++yy)
+        {
+            const uint8_t* row = disp.data + (size_t)yy * disp.strideBytes;
+            for (int xx = xA; xx <= xB; ++xx)
+            {
+                uint16_t r = ReadRaw<k16>(row, xx);
+                if (!IsValidRaw<kInvalid>(r, invalidValue)) continue;
+
+                int j = n++;
+                while (j > 0 && vals[j - 1] > r)
+                {
+                    vals[j] = vals[j - 1];
+                    --j;
+                }
+                vals[j] = r;
+            }
+        }
+
+        return n > 0 ? vals[n / 2] : 0;
+    }
+
+    template <int kFlags>
+    static void Kernel(const DisparityView& disp, const ReprojectParams& prm, std::vector<Pt>& pts, std::vector<int>& cells)
+    {
+        constexpr bool k16 = (kFlags & kFlag16) != 0;
+        constexpr bool kMedian = (kFlags & kFlagMedian) != 0;
+        constexpr bool kInvalid = (kFlags & kFlagInvalid) != 0;
+        constexpr bool kGround = (kFlags & kFlagGround) != 0;
+
+        const int x0 = prm.roi.x0, x1 = prm.roi.x1;
+        const int y0 = prm.roi.y0, y1 = prm.roi.y1;
+        const int step = prm.step;
+        const int gw = (x1 - x0 + step - 1) / step;
+
+        const uint16_t inv = prm.invalidValue;
+        const float scale = prm.scale;
+        const float offset = prm.offset;
+        const float focal = prm.focal;
+        const float fB = prm.focal * prm.baselineM;
+        const float u = prm.principalU;
+        const float v = prm.principalV;
+        const float minZ = prm.minZ;
+        const float maxZ = prm.maxZ;
+        const float gMin = prm.groundMinHeightM;
+
+        std::vector<uint16_t> rowRaw(kGround ? gw : 0);
+        std::vector<float> rowX(kGround ? gw : 0), rowY(kGround ? gw : 0), rowZ(kGround ? gw : 0), rowH(kGround ? gw : 0);
+
+        for (int y = y0; y < y1; y += step)
+        {
+            const uint8_t* row = disp.data + (size_t)y * disp.strideBytes;
+            const int cellRow = ((y - y0) / step) * gw;
+
+            // sin suelo no hay nada que vectorizar por fila, un solo pase salta los invalidos antes de dividir
+            if (!kGround)
+            {
+                for (int k = 0, x = x0; k < gw; ++k, x += step)
+                {
+                    const uint16_t raw = kMedian ? MedianRaw3x3<k16, kInvalid>(disp, x, y, inv) : ReadRaw<k16>(row, x);
+                    if (!IsValidRaw<kInvalid>(raw, inv)) continue;
+
+                    const float d = (float)raw * scale + offset;
+                    if (!(d > 1e-6f)) continue;
+
+                    const float z = fB / d;
+                    if (!((z >= minZ) & (z <= maxZ))) continue;
+
+                    Pt q;
+                    q.x = ((float)x - u) * z / focal;
+                    q.y = ((float)y - v) * z / focal;
+                    q.z = z;
+                    q.pix = y * disp.width + x;
+                    pts.push_back(q);
+                    cells.push_back(cellRow + k);
+                }
+                continue;
+            }
+
+            for (int k = 0, x = x0; k < gw; ++k, x += step)
+            {
+                if (kMedian) rowRaw[k] = MedianRaw3x3<k16, kInvalid>(disp, x, y, inv);
+                else rowRaw[k] = ReadRaw<k16>(row, x);
+            }
+
+            // lo descartado queda con z = 0
+            const float Yn = (float)y - v;
+            for (int k = 0; k < gw; ++k)
+            {
+                const uint16_t raw = rowRaw[k];
+                const float d = (float)raw * scale + offset;
+                const float z = fB / d;
+
+                // & y no && para que no haya saltos y el bucle vectorice
+                const bool ok = IsValidRaw<kInvalid>(raw, inv) & (d > 1e-6f) & (z >= minZ) & (z <= maxZ);
+
+                rowZ[k] = ok ? z : 0.0f;
+                rowX[k] = ((float)(x0 + k * step) - u) * z / focal;
+                rowY[k] = Yn * z / focal;
+            }
+
+            if (kGround)
+                VisionMath::HeightAboveGroundBatch(rowY.data(), rowZ.data(), gw, prm.camHeightM, prm.pitchDownDeg, rowH.data());
+
+            for (int k = 0; k < gw; ++k)
+            {
+                if (rowZ[k] == 0.0f) continue;
+                if (kGround && !(rowH[k] >= gMin)) continue;
+
+                Pt q;
+                q.x = rowX[k];
+                q.y = rowY[k];
+                q.z = rowZ[k];
+                q.pix = y * disp.width + x0 + k * step;
+                pts.push_back(q);
+                cells.push_back(cellRow + k);
+            }
+        }
+    }
+
+    using KernelFn = void (*)(const DisparityView&, const ReprojectParams&, std::vector<Pt>&, std::vector<int>&);
+
+    // tabla con todas las variantes instanciadas, indice = bits de la variante
+    template <int... I>
+    struct KernelTable
+    {
+        static constexpr KernelFn fns[sizeof...(I)] = { &Kernel<I>... };
+    };
+
+    template <int... I>
+    static constexpr const KernelFn* MakeKernelTable(std::integer_sequence<int, I...>)
+    {
+        return KernelTable<I...>::fns;
+    }
+
+    int Reprojection::Variant(const DisparityView& disp, const ReprojectParams& prm)
+    {
+        if (disp.bpp != 8 && disp.bpp != 16) return -1;
+
+        return (disp.bpp == 16 ? kFlag16 : 0) |
+            (prm.median3x3 ? kFlagMedian : 0) |
+            (prm.invalidFlag ? kFlagInvalid : 0) |
+            (prm.groundFilter ? kFlagGround : 0);
+    }
+
+    bool Reprojection::Run(const DisparityView& disp, const ReprojectParams& prm, std::vector<Pt>& pts, std::vector<int>& cells)
+    {
+        pts.clear();
+        cells.clear();
+
+        const int variant = Variant(disp, prm);
+        if (variant < 0 || !disp.data || prm.step < 1) return false;
+        if (prm.focal <= 1e-6f || prm.baselineM <= 1e-9f) return false;
+        if (prm.roi.x0 < 0 || prm.roi.y0 < 0 || prm.roi.x1 > disp.width || prm.roi.y1 > disp.height) return false;
+        if (prm.roi.x1 <= prm.roi.x0 || prm.roi.y1 <= prm.roi.y0) return true;
+
+        static constexpr const KernelFn* table = MakeKernelTable(std::make_integer_sequence<int, kVariants>{});
+
+        const size_t expect = (size_t)((prm.roi.x1 - prm.roi.x0) / prm.step + 1) * ((prm.roi.y1 - prm.roi.y0) / prm.step + 1);
+        pts.reserve(expect);
+        cells.reserve(expect);
+
+        table[variant](disp, prm, pts, cells);
+        return true;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BBBDisparity.h"
+#include "BBBPointCloudFilters.h"
+
+namespace BBB
+{
+    struct ReprojectParams
+    {
+        // pixeles [x0, x1) x [y0, y1) cada step
+        PixelRoi roi;
+        int step = 1;
+
+        // disparidad = raw * scale + offset y z = focal * baseline / disparidad
+        float scale = 1.0f;
+        float offset = 0.0f;
+        float focal = 0.0f;
+        float baselineM = 0.0f;
+        float principalU = 0.0f;
+        float principalV = 0.0f;
+
+        // raw 0 siempre es invalido, invalidValue solo si invalidFlag
+        bool invalidFlag = false;
+        uint16_t invalidValue = 0;
+
+        // z aceptada en [minZ, maxZ]
+        float minZ = 0.0f;
+        float maxZ = 0.0f;
+
+        // mediana 3x3 de los validos antes de convertir
+        bool median3x3 = false;
+
+        // descartamos lo que quede por debajo de groundMinHeightM sobre el suelo
+        bool groundFilter = false;
+        float camHeightM = 0.0f;
+        float pitchDownDeg = 0.0f;
+        float groundMinHeightM = 0.0f;
+    };
+
+    class Reprojection
+    {
+    public:
+        // nube de la disparidad con pix de cada punto, sin color
+        // hay una variante compilada por cada combinacion de 8 o 16 bits, mediana, valor invalido
+        // y filtro de suelo, Run elige una por frame con una tabla y el bucle no tiene ramas de
+        // configuracion, cada fila se lee, se convierte a xyz en un bucle que vectoriza y se compacta
+        // cells da la celda de cada punto en la rejilla organizada de ancho (x1 - x0 + step - 1) / step
+        static bool Run(const DisparityView& disp, const ReprojectParams& prm, std::vector<Pt>& pts, std::vector<int>& cells);
+
+        // indice de la variante que usaria Run, -1 si el formato no vale
+        static int Variant(const DisparityView& disp, const ReprojectParams& prm);
+
+        static constexpr int kVariants = 16;
+    };
+}
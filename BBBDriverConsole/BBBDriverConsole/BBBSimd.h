@@ -0,0 +1,7 @@
+#pragma once
+
+// detectamos SSE2, en x64 siempre esta y en ARM caemos al camino escalar
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BBB_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
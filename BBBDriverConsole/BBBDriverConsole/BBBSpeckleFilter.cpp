@@ -0,0 +1,176 @@
+#include "BBBSpeckleFilter.h"
+
+#include "BBBParallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace BBB
+{
+    // la raiz de cada arbol es siempre su indice menor, asi el aplanado final va en una pasada
+    static int FindRoot(std::vector<int>& parent, int i)
+    {
+        int r = i;
+        while (parent[r] != r) r = parent[r];
+
+        while (parent[i] != r)
+        {
+            int next = parent[i];
+            parent[i] = r;
+            i = next;
+        }
+        return r;
+    }
+
+    static void Union(std::vector<int>& parent, int a, int b)
+    {
+        a = FindRoot(parent, a);
+        b = FindRoot(parent, b);
+        if (a == b) return;
+        if (a < b) parent[b] = a;
+        else parent[a] = b;
+    }
+
+    template <class T>
+    static void Label(
+        const DisparityView& in,
+        int rx0, int ry0, int rw, int rh,
+        int maxDiff,
+        uint16_t invalidValue,
+        std::vector<int>& parent)
+    {
+        auto Px = [&](int x, int y) -> int
+            {
+                return (int)((const T*)(in.data + (size_t)(ry0 + y) * in.strideBytes))[rx0 + x];
+            };
+
+        auto Valid = [&](int v) -> bool
+            {
+                return v != 0 && v != (int)invalidValue;
+            };
+
+        // bandas de filas, cada una con su union find local sin tocar las demas
+        const int nStripes = std::clamp(rh / 32, 1, Parallel::ThreadCount() * 4);
+
+        Parallel::For(0, nStripes, 1, [&](int sb, int se)
+            {
+                for (int s = sb; s < se; ++s)
+                {
+                    const int y0 = rh * s / nStripes;
+                    const int y1 = rh * (s + 1) / nStripes;
+
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        for (int x = 0; x < rw; ++x)
+                        {
+                            const int i = y * rw + x;
+                            const int v = Px(x, y);
+                            if (!Valid(v))
+                            {
+                                parent[i] = -1;
+                                continue;
+                            }
+                            parent[i] = i;
+
+                            if (x > 0 && parent[i - 1] >= 0 && std::abs(v - Px(x - 1, y)) <= maxDiff)
+                                Union(parent, i, i - 1);
+
+                            if (y > y0 && parent[i - rw] >= 0 && std::abs(v - Px(x, y - 1)) <= maxDiff)
+                                Union(parent, i, i - rw);
+                        }
+                    }
+                }
+            });
+
+        // fronteras entre bandas, pocas filas y en serie
+        for (int s = 1; s < nStripes; ++s)
+        {
+            const int y = rh * s / nStripes;
+            for (int x = 0; x < rw; ++x)
+            {
+                const int i = y * rw + x;
+                if (parent[i] < 0 || parent[i - rw] < 0) continue;
+                if (std::abs(Px(x, y) - Px(x, y - 1)) <= maxDiff) Union(parent, i, i - rw);
+            }
+        }
+    }
+
+    template <class T>
+    static void Paint(const std::vector<int>& parent, const std::vector<int>& count, int maxSpeckleSize,
+        int rx0, int ry0, int rw, int rh, uint16_t invalidValue, DisparityBuffer& out)
+    {
+        Parallel::For(0, rh, 16, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    T* row = (T*)(out.bytes.data() + (size_t)(ry0 + y) * out.strideBytes) + rx0;
+                    const int* pr = parent.data() + (size_t)y * rw;
+                    for (int x = 0; x < rw; ++x)
+                        if (pr[x] >= 0 && count[pr[x]] <= maxSpeckleSize) row[x] = (T)invalidValue;
+                }
+            });
+    }
+
+    bool SpeckleFilter::Apply(
+        const DisparityView& in,
+        const PixelRoi& roi,
+        int marginPx,
+        int maxSpeckleSize,
+        int speckleThreshold,
+        float scale,
+        uint16_t invalidValue,
+        DisparityBuffer& out)
+    {
+        if (!in.data || in.width <= 0 || in.height <= 0) return false;
+        if (in.bpp != 8 && in.bpp != 16) return false;
+
+        // copia entera, fuera de la zona queda igual que la entrada
+        const size_t rowBytes = (size_t)in.width * (in.bpp / 8);
+        out.width = in.width;
+        out.height = in.height;
+        out.bpp = in.bpp;
+        out.strideBytes = (int)rowBytes;
+        out.bytes.resize(rowBytes * in.height);
+
+        Parallel::For(0, in.height, 64, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                    std::memcpy(out.bytes.data() + (size_t)y * rowBytes, in.data + (size_t)y * in.strideBytes, rowBytes);
+            });
+
+        if (maxSpeckleSize <= 0) return true;
+
+        // con menos margen una region grande que sale de la zona se contaria pequena y se borraria
+        const int m = (std::max)(marginPx, maxSpeckleSize);
+        const int rx0 = std::clamp(roi.x0 - m, 0, in.width);
+        const int rx1 = std::clamp(roi.x1 + m, 0, in.width);
+        const int ry0 = std::clamp(roi.y0 - m, 0, in.height);
+        const int ry1 = std::clamp(roi.y1 + m, 0, in.height);
+
+        const int rw = rx1 - rx0;
+        const int rh = ry1 - ry0;
+        if (rw <= 0 || rh <= 0) return true;
+
+        // umbral en pixeles de disparidad pasado a unidades crudas
+        const int maxDiff = scale > 1e-9f ? (int)std::floor((float)speckleThreshold / scale) : speckleThreshold;
+
+        std::vector<int> parent((size_t)rw * rh);
+        if (in.bpp == 8) Label<uint8_t>(in, rx0, ry0, rw, rh, maxDiff, invalidValue, parent);
+        else Label<uint16_t>(in, rx0, ry0, rw, rh, maxDiff, invalidValue, parent);
+
+        // aplanado en orden, el padre de cada pixel ya apunta a su raiz final
+        std::vector<int> count(parent.size(), 0);
+        for (size_t i = 0; i < parent.size(); ++i)
+        {
+            if (parent[i] < 0) continue;
+            parent[i] = parent[parent[i]];
+            count[parent[i]]++;
+        }
+
+        if (in.bpp == 8) Paint<uint8_t>(parent, count, maxSpeckleSize, rx0, ry0, rw, rh, invalidValue, out);
+        else Paint<uint16_t>(parent, count, maxSpeckleSize, rx0, ry0, rw, rh, invalidValue, out);
+
+        return true;
+    }
+}
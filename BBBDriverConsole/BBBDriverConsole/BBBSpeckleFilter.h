@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "BBBDisparity.h"
+
+namespace BBB
+{
+    // disparidad en memoria nuestra con el mismo formato que la de la camara
+    struct DisparityBuffer
+    {
+        int width = 0;
+        int height = 0;
+        int bpp = 16;
+        int strideBytes = 0;
+        std::vector<uint8_t> bytes;
+
+        DisparityView View() const
+        {
+            DisparityView v;
+            v.data = bytes.data();
+            v.width = width;
+            v.height = height;
+            v.strideBytes = strideBytes;
+            v.bpp = bpp;
+            return v;
+        }
+    };
+
+    class SpeckleFilter
+    {
+    public:
+        // mismos parametros que ImageUtilityStereo::FilterSpecklesFromImage
+        // regiones 4 conexas donde vecinos difieren como mucho speckleThreshold pixeles de disparidad
+        // (speckleThreshold / scale en crudo), las de maxSpeckleSize pixeles o menos pasan a invalidValue
+        // el 0 y invalidValue no forman region
+        //
+        // solo etiquetamos el ROI mas marginPx por cada lado, fuera copiamos tal cual
+        // una region que entra en el ROI y tiene mas de maxSpeckleSize pixeles conserva al menos
+        // marginPx dentro de la zona, por eso marginPx nunca baja de maxSpeckleSize
+        // y dentro del ROI el resultado es el del SDK
+        //
+        // etiquetado union find por bandas de filas en paralelo y luego unimos las fronteras
+        // no toca la entrada, el resultado va a out que reutiliza su memoria entre frames
+        static bool Apply(
+            const DisparityView& in,
+            const PixelRoi& roi,
+            int marginPx,
+            int maxSpeckleSize,
+            int speckleThreshold,
+            float scale,
+            uint16_t invalidValue,
+            DisparityBuffer& out
+        );
+    };
+}
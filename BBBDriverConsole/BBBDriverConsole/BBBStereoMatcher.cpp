@@ -0,0 +1,377 @@
+#include "BBBStereoMatcher.h"
+
+#include "BBBParallel.h"
+#include "BBBSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace BBB
+{
+    static const int kCensusR = 3;
+    static const int kCensusBits = (2 * kCensusR + 1) * (2 * kCensusR + 1) - 1;
+
+    // relleno a cada lado de una linea de costes agregados para leer d - 1 y d + 1 sin comprobar
+    static const int kPad = 8;
+    static const uint16_t kBig = 0x3fff;
+
+    static int Popcount64(uint64_t v)
+    {
+        v = v - ((v >> 1) & 0x5555555555555555ull);
+        v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+        v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return (int)((v * 0x0101010101010101ull) >> 56);
+    }
+
+    // census 7x7 sin el centro, bit a 1 si el vecino es mas oscuro, borde replicado
+    // solo las columnas [x0, x1), el resto de la fila queda sin tocar
+    static void Census(const DisparityView& img, int y0, int y1, int x0, int x1, std::vector<uint64_t>& out)
+    {
+        const int w = img.width;
+        const int h = img.height;
+        out.resize((size_t)(y1 - y0) * w);
+
+        Parallel::For(y0, y1, 8, [&](int b, int e)
+            {
+                const uint8_t* rows[2 * kCensusR + 1];
+
+                for (int y = b; y < e; ++y)
+                {
+                    for (int dy = -kCensusR; dy <= kCensusR; ++dy)
+                        rows[dy + kCensusR] = img.data + (size_t)std::clamp(y + dy, 0, h - 1) * img.strideBytes;
+
+                    uint64_t* o = out.data() + (size_t)(y - y0) * w;
+
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        const uint8_t c = rows[kCensusR][x];
+                        const bool inside = x >= kCensusR && x + kCensusR < w;
+                        uint64_t bits = 0;
+
+                        for (int dy = 0; dy < 2 * kCensusR + 1; ++dy)
+                        {
+                            const uint8_t* r = rows[dy];
+                            for (int dx = -kCensusR; dx <= kCensusR; ++dx)
+                            {
+                                if (dy == kCensusR && dx == 0) continue;
+                                const int xx = inside ? x + dx : std::clamp(x + dx, 0, w - 1);
+                                bits = (bits << 1) | (uint64_t)(r[xx] < c);
+                            }
+                        }
+                        o[x] = bits;
+                    }
+                }
+            });
+    }
+
+    // Hamming de a contra cr[xr], cr[xr - 1] ... para k = 0 .. D - 1, coste maximo si xr - k < 0
+    static void HammingRow(uint64_t a, const uint64_t* cr, int xr, int D, uint8_t* c)
+    {
+        int k = 0;
+
+#if defined(BBB_SIMD_SSE2)
+        // dos disparidades por vuelta, popcount por bytes y suma de cada mitad con psadbw
+        const __m128i va = _mm_set1_epi64x((long long)a);
+        const __m128i m1 = _mm_set1_epi8(0x55);
+        const __m128i m2 = _mm_set1_epi8(0x33);
+        const __m128i m4 = _mm_set1_epi8(0x0f);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; k + 2 <= D && xr - k - 1 >= 0; k += 2)
+        {
+            // carril bajo cr[xr - k - 1] para k + 1, alto cr[xr - k] para k
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(cr + xr - k - 1)), va);
+            v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+            v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+            v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+            v = _mm_sad_epu8(v, zero);
+
+            c[k] = (uint8_t)_mm_extract_epi16(v, 4);
+            c[k + 1] = (uint8_t)_mm_cvtsi128_si32(v);
+        }
+#endif
+
+        for (; k < D; ++k)
+            c[k] = xr - k >= 0 ? (uint8_t)Popcount64(a ^ cr[xr - k]) : (uint8_t)kCensusBits;
+    }
+
+    // primer pixel de un camino, L = C
+    static uint16_t StartPath(const uint8_t* C, uint16_t* L, uint16_t* S, int D)
+    {
+        uint16_t mn = kBig;
+        for (int d = 0; d < D; ++d)
+        {
+            L[d] = C[d];
+            S[d] = (uint16_t)(S[d] + C[d]);
+            mn = (std::min)(mn, L[d]);
+        }
+        return mn;
+    }
+
+    // L(d) = C(d) + min(Lp(d), Lp(d - 1) + P1, Lp(d + 1) + P1, min Lp + P2) - min Lp
+    // Lp lleva kBig en Lp[-1] y Lp[D], sumamos L en S y devolvemos min L
+    static uint16_t StepPath(const uint8_t* C, const uint16_t* Lp, uint16_t minLp, uint16_t* L, uint16_t* S, int D, uint16_t P1, uint16_t P2)
+    {
+        int d = 0;
+        uint16_t mn = kBig;
+
+#if defined(BBB_SIMD_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vP1 = _mm_set1_epi16((short)P1);
+        const __m128i vMinP2 = _mm_set1_epi16((short)(minLp + P2));
+        const __m128i vMin = _mm_set1_epi16((short)minLp);
+        __m128i acc = _mm_set1_epi16((short)kBig);
+
+        for (; d + 8 <= D; d += 8)
+        {
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(C + d)), zero);
+            __m128i l0 = _mm_loadu_si128((const __m128i*)(Lp + d));
+            __m128i lm = _mm_loadu_si128((const __m128i*)(Lp + d - 1));
+            __m128i lp = _mm_loadu_si128((const __m128i*)(Lp + d + 1));
+
+            __m128i m = _mm_min_epi16(l0, _mm_min_epi16(_mm_adds_epu16(lm, vP1), _mm_adds_epu16(lp, vP1)));
+            m = _mm_min_epi16(m, vMinP2);
+
+            __m128i l = _mm_add_epi16(c, _mm_sub_epi16(m, vMin));
+            _mm_storeu_si128((__m128i*)(L + d), l);
+
+            __m128i s = _mm_loadu_si128((const __m128i*)(S + d));
+            _mm_storeu_si128((__m128i*)(S + d), _mm_adds_epu16(s, l));
+
+            acc = _mm_min_epi16(acc, l);
+        }
+
+        // minimo de los 8 carriles
+        acc = _mm_min_epi16(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_min_epi16(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        acc = _mm_min_epi16(acc, _mm_srli_epi32(acc, 16));
+        mn = (uint16_t)(_mm_cvtsi128_si32(acc) & 0xffff);
+#endif
+
+        for (; d < D; ++d)
+        {
+            int m = (std::min)({ (int)Lp[d], (int)Lp[d - 1] + P1, (int)Lp[d + 1] + P1, (int)minLp + P2 });
+            L[d] = (uint16_t)(C[d] + m - minLp);
+            S[d] = (uint16_t)(std::min)(65535, (int)S[d] + L[d]);
+            mn = (std::min)(mn, L[d]);
+        }
+
+        return mn;
+    }
+
+    bool StereoMatcher::Compute(
+        const DisparityView& left,
+        const DisparityView& right,
+        const PixelRoi& roi,
+        const StereoParams& prm,
+        DisparityBuffer& out)
+    {
+        if (!left.data || !right.data) return false;
+        if (left.bpp != 8 || right.bpp != 8) return false;
+        if (left.width != right.width || left.height != right.height) return false;
+        if (prm.numDisparities < 8 || prm.numDisparities % 8 != 0 || prm.minDisparity < 0) return false;
+        if (prm.scale <= 1e-9f) return false;
+
+        const int W = left.width;
+        const int H = left.height;
+        const int D = prm.numDisparities;
+        const int minD = prm.minDisparity;
+
+        out.width = W;
+        out.height = H;
+        out.bpp = 16;
+        out.strideBytes = W * (int)sizeof(uint16_t);
+        out.bytes.assign((size_t)W * H * sizeof(uint16_t), 0);
+
+        uint16_t* outPx = (uint16_t*)out.bytes.data();
+        if (prm.invalidValue != 0) std::fill(outPx, outPx + (size_t)W * H, prm.invalidValue);
+
+        const int X0 = std::clamp(roi.x0, 0, W);
+        const int X1 = std::clamp(roi.x1, 0, W);
+        const int Y0 = std::clamp(roi.y0, 0, H);
+        const int Y1 = std::clamp(roi.y1, 0, H);
+
+        const int w = X1 - X0;
+        const int h = Y1 - Y0;
+        if (w <= 0 || h <= 0) return false;
+
+        // la derecha solo hace falta donde caen los candidatos del ROI
+        std::vector<uint64_t> censusL, censusR;
+        Census(left, Y0, Y1, X0, X1, censusL);
+        Census(right, Y0, Y1, (std::max)(0, X0 - minD - D + 1), (std::max)(0, X1 - minD), censusR);
+
+        // volumen de coste por pixel del ROI y D disparidades, Hamming de los census
+        std::vector<uint8_t> cost((size_t)w * h * D);
+        std::vector<uint16_t> sum((size_t)w * h * D, 0);
+
+        auto C = [&](int x, int y) -> const uint8_t* { return cost.data() + ((size_t)y * w + x) * D; };
+        auto S = [&](int x, int y) -> uint16_t* { return sum.data() + ((size_t)y * w + x) * D; };
+
+        Parallel::For(0, h, 4, [&](int b, int e)
+            {
+                for (int y = b; y < e; ++y)
+                {
+                    const uint64_t* cl = censusL.data() + (size_t)y * W;
+                    const uint64_t* cr = censusR.data() + (size_t)y * W;
+
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const int xa = X0 + x;
+                        HammingRow(cl[xa], cr, xa - minD, D, cost.data() + ((size_t)y * w + x) * D);
+                    }
+                }
+            });
+
+        const uint16_t P1 = (uint16_t)std::clamp(prm.p1, 0, 1000);
+        const uint16_t P2 = (uint16_t)std::clamp(prm.p2, (int)P1, 2000);
+        const int stride = D + 2 * kPad;
+
+        // caminos horizontales, cada fila es independiente
+        Parallel::For(0, h, 4, [&](int b, int e)
+            {
+                std::vector<uint16_t> bufA(stride, kBig), bufB(stride, kBig);
+
+                for (int y = b; y < e; ++y)
+                {
+                    for (int dir = -1; dir <= 1; dir += 2)
+                    {
+                        uint16_t* prev = bufA.data() + kPad;
+                        uint16_t* cur = bufB.data() + kPad;
+
+                        int x = dir > 0 ? 0 : w - 1;
+                        uint16_t mn = StartPath(C(x, y), prev, S(x, y), D);
+
+                        for (int i = 1; i < w; ++i)
+                        {
+                            x += dir;
+                            mn = StepPath(C(x, y), prev, mn, cur, S(x, y), D, P1, P2);
+                            std::swap(prev, cur);
+                        }
+                    }
+                }
+            });
+
+        // caminos que bajan o suben, fila a fila y cada fila repartida por tramos de columnas
+        std::vector<int> dxs = { 0 };
+        if (prm.paths >= 8)
+        {
+            dxs.push_back(1);
+            dxs.push_back(-1);
+        }
+
+        const int nd = (int)dxs.size();
+        std::vector<uint16_t> lines((size_t)2 * nd * w * stride, kBig);
+        std::vector<uint16_t> mins((size_t)2 * nd * w, 0);
+
+        auto Line = [&](int buf, int k, int x) -> uint16_t* { return lines.data() + (((size_t)buf * nd + k) * w + x) * stride + kPad; };
+        auto Min = [&](int buf, int k, int x) -> uint16_t& { return mins[((size_t)buf * nd + k) * w + x]; };
+
+        for (int dy = -1; dy <= 1; dy += 2)
+        {
+            int cur = 0;
+            for (int i = 0; i < h; ++i)
+            {
+                const int y = dy > 0 ? i : h - 1 - i;
+
+                Parallel::For(0, w, 64, [&](int b, int e)
+                    {
+                        for (int x = b; x < e; ++x)
+                        {
+                            for (int k = 0; k < nd; ++k)
+                            {
+                                const int xp = x - dxs[k];
+                                if (i == 0 || xp < 0 || xp >= w)
+                                    Min(cur, k, x) = StartPath(C(x, y), Line(cur, k, x), S(x, y), D);
+                                else
+                                    Min(cur, k, x) = StepPath(C(x, y), Line(1 - cur, k, xp), Min(1 - cur, k, xp), Line(cur, k, x), S(x, y), D, P1, P2);
+                            }
+                        }
+                    });
+
+                cur = 1 - cur;
+            }
+        }
+
+        // ganador por pixel, unicidad, parabola y cruce con la disparidad vista desde la derecha
+        const int uniq = (std::max)(0, prm.uniquenessPct);
+
+        Parallel::For(0, h, 4, [&](int b, int e)
+            {
+                // disparidad entera vista desde cada pixel derecho de la fila, en una pasada sobre S
+                std::vector<int> bestR(W);
+                std::vector<uint16_t> bestRS(W);
+
+                for (int y = b; y < e; ++y)
+                {
+                    uint16_t* row = outPx + (size_t)(Y0 + y) * W;
+
+                    if (prm.lrMaxDiff >= 0)
+                    {
+                        std::fill(bestR.begin(), bestR.end(), -1);
+                        std::fill(bestRS.begin(), bestRS.end(), (uint16_t)0xffff);
+
+                        for (int x = 0; x < w; ++x)
+                        {
+                            const uint16_t* s = S(x, y);
+                            const int xr0 = X0 + x - minD;
+                            const int kMax = (std::min)(D, xr0 + 1);
+                            for (int k = 0; k < kMax; ++k)
+                            {
+                                const int j = xr0 - k;
+                                const bool lt = s[k] < bestRS[j];
+                                bestRS[j] = lt ? s[k] : bestRS[j];
+                                bestR[j] = lt ? k : bestR[j];
+                            }
+                        }
+                    }
+
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const int xa = X0 + x;
+                        const int kMax = (std::min)(D, xa - minD + 1);
+                        if (kMax <= 0) continue;
+
+                        const uint16_t* s = S(x, y);
+
+                        // minimo sin saltos para que vectorice y luego su primera posicion
+                        uint16_t bestS = 0xffff;
+                        for (int k = 0; k < kMax; ++k) bestS = (std::min)(bestS, s[k]);
+
+                        int best = 0;
+                        while (s[best] != bestS) best++;
+
+                        if (uniq > 0)
+                        {
+                            // segundo minimo fuera de best - 1 .. best + 1
+                            uint16_t second = 0xffff;
+                            for (int k = 0; k < best - 1; ++k) second = (std::min)(second, s[k]);
+                            for (int k = best + 2; k < kMax; ++k) second = (std::min)(second, s[k]);
+                            if ((int)second * 100 <= (int)bestS * (100 + uniq)) continue;
+                        }
+
+                        if (prm.lrMaxDiff >= 0)
+                        {
+                            const int kr = bestR[xa - minD - best];
+                            if (kr < 0 || std::abs(kr - best) > prm.lrMaxDiff) continue;
+                        }
+
+                        float frac = 0.0f;
+                        if (best > 0 && best + 1 < kMax)
+                        {
+                            const int denom = (int)s[best - 1] + (int)s[best + 1] - 2 * (int)s[best];
+                            if (denom > 0) frac = (float)((int)s[best - 1] - (int)s[best + 1]) / (2.0f * (float)denom);
+                        }
+
+                        const float d = (float)(minD + best) + frac;
+                        const long raw = std::lround((d - prm.offset) / prm.scale);
+                        if (raw <= 0 || raw > 65535 || raw == (long)prm.invalidValue) continue;
+
+                        row[xa] = (uint16_t)raw;
+                    }
+                }
+            });
+
+        return true;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BBBDisparity.h"
+#include "BBBSpeckleFilter.h"
+
+namespace BBB
+{
+    struct StereoParams
+    {
+        // rango de busqueda [minDisparity, minDisparity + numDisparities), numDisparities multiplo de 8
+        int minDisparity = 0;
+        int numDisparities = 128;
+
+        // penalizaciones SGM para salto de 1 y para salto mayor, en unidades de coste census
+        int p1 = 8;
+        int p2 = 96;
+
+        // 4 caminos horizontal y vertical, 8 anade diagonales
+        int paths = 8;
+
+        // comprobacion izquierda derecha en pixeles, negativo la quita
+        int lrMaxDiff = 1;
+
+        // el segundo minimo no vecino tiene que superar al mejor en este porcentaje, 0 sin filtro
+        int uniquenessPct = 5;
+
+        // salida como la camara, disparidad = raw * scale + offset
+        float scale = 1.0f / 64.0f;
+        float offset = 0.0f;
+        uint16_t invalidValue = 0;
+    };
+
+    class StereoMatcher
+    {
+    public:
+        // SGM con census 7x7 sobre el par rectificado, las dos vistas mono de 8 bits
+        // coste por Hamming, agregacion en 16 bits con SSE2 y subpixel por parabola
+        // caminos horizontales repartidos por filas y verticales o diagonales por tramos de columnas
+        // solo calculamos los pixeles izquierdos del ROI, el resto sale invalido
+        // out en Mono16 del tamano de la imagen
+        static bool Compute(
+            const DisparityView& left,
+            const DisparityView& right,
+            const PixelRoi& roi,
+            const StereoParams& prm,
+            DisparityBuffer& out
+        );
+    };
+}
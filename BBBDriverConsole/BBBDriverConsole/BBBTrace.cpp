@@ -0,0 +1,181 @@
+#include "BBBTrace.h"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace BBB
+{
+    static const uint32_t kRingSize = 1u << 16;
+
+    // campos atomicos para poder volcar mientras el hilo sigue escribiendo
+    // con relaxed en x86 son movs normales
+    struct TraceEvent
+    {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<int64_t> startNs{ 0 };
+        std::atomic<int64_t> durNs{ 0 };
+        std::atomic<int> cam{ -1 };
+    };
+
+    struct TraceRing
+    {
+        int tid = 0;
+        std::string threadName;
+        int cam = -1;
+
+        std::unique_ptr<TraceEvent[]> events{ new TraceEvent[kRingSize] };
+        std::atomic<uint64_t> head{ 0 };
+    };
+
+    static std::atomic<bool> gEnabled{ false };
+    static const std::chrono::steady_clock::time_point gOrigin = std::chrono::steady_clock::now();
+
+    static std::mutex& RegistryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::vector<std::unique_ptr<TraceRing>>& Rings()
+    {
+        static std::vector<std::unique_ptr<TraceRing>> r;
+        return r;
+    }
+
+    static std::vector<std::string>& CameraNames()
+    {
+        static std::vector<std::string> n;
+        return n;
+    }
+
+    // el anillo se crea con el primer evento o nombre del hilo, nunca se libera
+    static TraceRing& Mine()
+    {
+        static thread_local TraceRing* mine = nullptr;
+        if (!mine)
+        {
+            auto ring = std::make_unique<TraceRing>();
+            mine = ring.get();
+
+            std::lock_guard<std::mutex> lk(RegistryMutex());
+            ring->tid = (int)Rings().size() + 1;
+            ring->threadName = "hilo " + std::to_string(ring->tid);
+            Rings().push_back(std::move(ring));
+        }
+        return *mine;
+    }
+
+    void Trace::SetEnabled(bool on)
+    {
+        gEnabled.store(on, std::memory_order_relaxed);
+    }
+
+    bool Trace::Enabled()
+    {
+        return gEnabled.load(std::memory_order_relaxed);
+    }
+
+    void Trace::SetThreadName(const std::string& name)
+    {
+        TraceRing& r = Mine();
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        r.threadName = name;
+    }
+
+    void Trace::SetCamera(int camId, const std::string& camName)
+    {
+        TraceRing& r = Mine();
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        r.cam = camId;
+
+        auto& names = CameraNames();
+        if (camId >= 0)
+        {
+            if ((int)names.size() <= camId) names.resize((size_t)camId + 1);
+            names[(size_t)camId] = camName;
+        }
+    }
+
+    void Trace::Complete(const char* name, std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1)
+    {
+        if (!Enabled() || !name) return;
+
+        TraceRing& r = Mine();
+        const uint64_t h = r.head.load(std::memory_order_relaxed);
+        TraceEvent& e = r.events[h & (kRingSize - 1)];
+
+        e.name.store(name, std::memory_order_relaxed);
+        e.startNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(t0 - gOrigin).count(), std::memory_order_relaxed);
+        e.durNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(), std::memory_order_relaxed);
+        e.cam.store(r.cam, std::memory_order_relaxed);
+
+        r.head.store(h + 1, std::memory_order_release);
+    }
+
+    static void WriteJsonString(std::ofstream& f, const std::string& s)
+    {
+        f << '"';
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\') f << '\\' << c;
+            else if ((unsigned char)c < 0x20) f << ' ';
+            else f << c;
+        }
+        f << '"';
+    }
+
+    bool Trace::WriteChromeJson(const std::string& path)
+    {
+        std::ofstream f(path, std::ios::binary);
+        if (!f.is_open()) return false;
+
+        std::lock_guard<std::mutex> lk(RegistryMutex());
+        const auto& names = CameraNames();
+
+        // ts y dur en us con decimales, sin notacion cientifica
+        f << std::fixed << std::setprecision(3);
+        f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"BBBDriverConsole\"}}";
+
+        for (const auto& r : Rings())
+        {
+            f << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid << ",\"args\":{\"name\":";
+            WriteJsonString(f, r->threadName);
+            f << "}}";
+            f << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->tid
+                << ",\"args\":{\"sort_index\":" << (r->cam >= 0 ? r->cam * 16 + r->tid : 4096 + r->tid) << "}}";
+
+            // lo que haya entre head menos el tamano y head, lo mas viejo ya esta pisado
+            const uint64_t head = r->head.load(std::memory_order_acquire);
+            const uint64_t first = head > kRingSize ? head - kRingSize : 0;
+
+            for (uint64_t i = first; i < head; ++i)
+            {
+                const TraceEvent& e = r->events[i & (kRingSize - 1)];
+                const char* name = e.name.load(std::memory_order_relaxed);
+                if (!name) continue;
+
+                const int cam = e.cam.load(std::memory_order_relaxed);
+
+                f << ",\n{\"name\":\"" << name << "\",\"cat\":\"bbb\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->tid
+                    << ",\"ts\":" << (double)e.startNs.load(std::memory_order_relaxed) / 1000.0
+                    << ",\"dur\":" << (double)e.durNs.load(std::memory_order_relaxed) / 1000.0;
+
+                if (cam >= 0)
+                {
+                    f << ",\"args\":{\"cam\":";
+                    WriteJsonString(f, cam < (int)names.size() ? names[(size_t)cam] : std::to_string(cam));
+                    f << "}";
+                }
+                f << "}";
+            }
+        }
+
+        f << "\n]}\n";
+        return f.good();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace BBB
+{
+    // traza de la linea de tiempo para chrome://tracing o ui.perfetto.dev
+    // cada hilo escribe eventos completos, inicio y duracion, en su propio anillo sin locks
+    // apagada cuesta una lectura atomica por etapa, encendida guarda los ultimos 65536 por hilo
+    class Trace
+    {
+    public:
+        static void SetEnabled(bool on);
+        static bool Enabled();
+
+        // nombre del hilo y camara a la que pertenece, se ven como filas en el visor
+        static void SetThreadName(const std::string& name);
+        static void SetCamera(int camId, const std::string& camName);
+
+        // name tiene que vivir todo el proceso, un literal o StageName
+        static void Complete(const char* name, std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1);
+
+        // JSON de Chrome trace con lo que haya en los anillos, se puede llamar con los hilos escribiendo
+        static bool WriteChromeJson(const std::string& path);
+    };
+
+    // tramo con nombre que no es una etapa, por ejemplo el frame entero o una espera
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(const char* name) : name(Trace::Enabled() ? name : nullptr)
+        {
+            if (this->name) t0 = std::chrono::steady_clock::now();
+        }
+
+        ~TraceScope()
+        {
+            if (name) Trace::Complete(name, t0, std::chrono::steady_clock::now());
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char* name;
+        std::chrono::steady_clock::time_point t0;
+    };
+}
@@ -1,77 +1,87 @@
 #include "BBBVisionMath.h"
 
+#include "BBBSimd.h"
+
 #include <algorithm>
 #include <cmath>
 #include <limits>
 
 namespace BBB
 {
-    float VisionMath::Clamp01(float v)
-    {
-        if (v < 0.0f) return 0.0f;
-        if (v > 1.0f) return 1.0f;
-        return v;
-    }
-
-    float VisionMath::DegToRad(float deg)
-    {
-        return deg * 3.14159265358979323846f / 180.0f;
-    }
-
-    float VisionMath::HeightAboveGroundM(float Xc, float Yc, float Zc, float camHeightM, float pitchDownDeg)
+    void VisionMath::HeightAboveGroundBatch(const float* Yc, const float* Zc, int n,
+        float camHeightM, float pitchDownDeg, float* out)
     {
-        // convertimos a eje arriba
-        float yUp = -Yc;
-
-        // deshacemos pitch rotando alrededor de X
-        float p = DegToRad(pitchDownDeg);
-        float cp = std::cos(p);
-        float sp = std::sin(p);
-
-        // rotacion en plano yUp z
-        float yUpWorld = cp * yUp - sp * Zc;
-
-        // altura sobre suelo
-        return camHeightM + yUpWorld;
+        const float p = DegToRad(pitchDownDeg);
+        const float cp = std::cos(p);
+        const float sp = std::sin(p);
+
+        int i = 0;
+
+#if defined(BBB_SIMD_SSE2)
+        const __m128 vh = _mm_set1_ps(camHeightM);
+        const __m128 vc = _mm_set1_ps(cp);
+        const __m128 vs = _mm_set1_ps(sp);
+
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 y = _mm_loadu_ps(Yc + i);
+            __m128 z = _mm_loadu_ps(Zc + i);
+            __m128 h = _mm_sub_ps(_mm_sub_ps(vh, _mm_mul_ps(vc, y)), _mm_mul_ps(vs, z));
+            _mm_storeu_ps(out + i, h);
+        }
+#endif
+
+        for (; i < n; ++i)
+            out[i] = camHeightM - cp * Yc[i] - sp * Zc[i];
     }
 
-    void VisionMath::HsvToRgb(float hDeg, float s, float v, uint8_t& r, uint8_t& g, uint8_t& b)
+    void VisionMath::DepthToHeatBatch(const float* z, int n, float zMin, float zMax, uint8_t* rgb)
     {
-        hDeg = std::fmod(hDeg, 360.0f);
-        if (hDeg < 0.0f) hDeg += 360.0f;
-
-        float c = v * s;
-        float x = c * (1.0f - std::fabs(std::fmod(hDeg / 60.0f, 2.0f) - 1.0f));
-        float m = v - c;
-
-        float rp = 0, gp = 0, bp = 0;
-
-        if (hDeg < 60.0f) { rp = c; gp = x; bp = 0; }
-        else if (hDeg < 120.0f) { rp = x; gp = c; bp = 0; }
-        else if (hDeg < 180.0f) { rp = 0; gp = c; bp = x; }
-        else if (hDeg < 240.0f) { rp = 0; gp = x; bp = c; }
-        else if (hDeg < 300.0f) { rp = x; gp = 0; bp = c; }
-        else { rp = c; gp = 0; bp = x; }
-
-        int R = (int)std::lround((rp + m) * 255.0f);
-        int G = (int)std::lround((gp + m) * 255.0f);
-        int B = (int)std::lround((bp + m) * 255.0f);
-
-        r = (uint8_t)std::clamp(R, 0, 255);
-        g = (uint8_t)std::clamp(G, 0, 255);
-        b = (uint8_t)std::clamp(B, 0, 255);
-    }
-
-    void VisionMath::DepthToHeatRGB(float z, float zMin, float zMax, uint8_t& r, uint8_t& g, uint8_t& b)
-    {
-        float denom = (zMax - zMin);
+        float denom = zMax - zMin;
         if (denom < 1e-6f) denom = 1.0f;
 
-        float t = (z - zMin) / denom;
-        t = Clamp01(t);
-
-        float hue = (1.0f - t) * 240.0f;
-        HsvToRgb(hue, 1.0f, 1.0f, r, g, b);
+        int i = 0;
+
+#if defined(BBB_SIMD_SSE2)
+        const __m128 vMin = _mm_set1_ps(zMin);
+        const __m128 vDen = _mm_set1_ps(denom);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128 four = _mm_set1_ps(4.0f);
+        const __m128 s255 = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 sign = _mm_set1_ps(-0.0f);
+
+        auto Clamp = [&](__m128 v) { return _mm_min_ps(_mm_max_ps(v, zero), one); };
+        auto Abs = [&](__m128 v) { return _mm_andnot_ps(sign, v); };
+        auto ToByte = [&](__m128 v) { return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Clamp(v), s255), half)); };
+
+        alignas(16) int32_t cr[4], cg[4], cb[4];
+
+        for (; i + 4 <= n; i += 4)
+        {
+            // mismas operaciones y en el mismo orden que la version escalar
+            __m128 t = Clamp(_mm_div_ps(_mm_sub_ps(_mm_loadu_ps(z + i), vMin), vDen));
+            __m128 k = _mm_mul_ps(_mm_sub_ps(one, t), four);
+
+            _mm_store_si128((__m128i*)cr, ToByte(_mm_sub_ps(Abs(_mm_sub_ps(k, three)), one)));
+            _mm_store_si128((__m128i*)cg, ToByte(_mm_sub_ps(two, Abs(_mm_sub_ps(k, two)))));
+            _mm_store_si128((__m128i*)cb, ToByte(_mm_sub_ps(two, Abs(_mm_sub_ps(k, four)))));
+
+            uint8_t* o = rgb + (size_t)i * 3;
+            for (int j = 0; j < 4; ++j)
+            {
+                o[j * 3 + 0] = (uint8_t)cr[j];
+                o[j * 3 + 1] = (uint8_t)cg[j];
+                o[j * 3 + 2] = (uint8_t)cb[j];
+            }
+        }
+#endif
+
+        for (; i < n; ++i)
+            DepthToHeatRGB(z[i], zMin, zMax, rgb[(size_t)i * 3 + 0], rgb[(size_t)i * 3 + 1], rgb[(size_t)i * 3 + 2]);
     }
 
     float VisionMath::Percentile(std::vector<float>& v, float q)
@@ -80,13 +90,144 @@ namespace BBB
 
         q = std::clamp(q, 0.0f, 1.0f);
 
-        std::sort(v.begin(), v.end());
         float idx = q * (float)(v.size() - 1);
-
         size_t i0 = (size_t)idx;
         size_t i1 = (std::min)(i0 + 1, v.size() - 1);
 
+        // el vecino de arriba es el minimo de lo que queda a la derecha de i0
+        std::nth_element(v.begin(), v.begin() + i0, v.end());
+        float a = v[i0];
+        float b = (i1 == i0) ? a : *std::min_element(v.begin() + i0 + 1, v.end());
+
         float t = idx - (float)i0;
-        return v[i0] * (1.f - t) + v[i1] * t;
+        return a * (1.f - t) + b * t;
+    }
+
+    void VisionMath::SymEigen3(const double a[6], double evals[3], double evecs[9])
+    {
+        double m[3][3] = {
+            { a[0], a[1], a[2] },
+            { a[1], a[3], a[4] },
+            { a[2], a[4], a[5] }
+        };
+        double v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+        // barridos de Jacobi, en 3x3 converge en pocas vueltas
+        for (int sweep = 0; sweep < 16; ++sweep)
+        {
+            double off = m[0][1] * m[0][1] + m[0][2] * m[0][2] + m[1][2] * m[1][2];
+            if (off < 1e-30) break;
+
+            for (int p = 0; p < 2; ++p)
+            {
+                for (int q = p + 1; q < 3; ++q)
+                {
+                    if (std::fabs(m[p][q]) < 1e-300) continue;
+
+                    double theta = (m[q][q] - m[p][p]) / (2.0 * m[p][q]);
+                    double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                    double c = 1.0 / std::sqrt(t * t + 1.0);
+                    double s = t * c;
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        double mkp = m[k][p];
+                        double mkq = m[k][q];
+                        m[k][p] = c * mkp - s * mkq;
+                        m[k][q] = s * mkp + c * mkq;
+                    }
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        double mpk = m[p][k];
+                        double mqk = m[q][k];
+                        m[p][k] = c * mpk - s * mqk;
+                        m[q][k] = s * mpk + c * mqk;
+                    }
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        double vkp = v[k][p];
+                        double vkq = v[k][q];
+                        v[k][p] = c * vkp - s * vkq;
+                        v[k][q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        // ordenamos de menor a mayor
+        int idx[3] = { 0, 1, 2 };
+        std::sort(idx, idx + 3, [&](int i, int j) { return m[i][i] < m[j][j]; });
+
+        for (int i = 0; i < 3; ++i)
+        {
+            evals[i] = m[idx[i]][idx[i]];
+            for (int k = 0; k < 3; ++k)
+                evecs[3 * i + k] = v[k][idx[i]];
+        }
+    }
+
+    bool VisionMath::SmallestEigenVector3(const double a[6], float n[3], float& lambda0, float& trace)
+    {
+        const double a00 = a[0], a01 = a[1], a02 = a[2];
+        const double a11 = a[3], a12 = a[4], a22 = a[5];
+
+        const double tr = a00 + a11 + a22;
+        trace = (float)tr;
+        if (tr <= 1e-18) return false;
+
+        const double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+        const double q = tr / 3.0;
+
+        double lmin;
+        if (p1 <= 1e-30 * tr * tr)
+        {
+            // diagonal, el menor de la diagonal
+            lmin = (std::min)(a00, (std::min)(a11, a22));
+        }
+        else
+        {
+            const double b00 = a00 - q, b11 = a11 - q, b22 = a22 - q;
+            const double p2 = b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * p1;
+            const double pp = std::sqrt(p2 / 6.0);
+            const double inv = 1.0 / pp;
+
+            // det(B) / 2 con B = (A - qI) / p
+            const double c00 = b00 * inv, c11 = b11 * inv, c22 = b22 * inv;
+            const double c01 = a01 * inv, c02 = a02 * inv, c12 = a12 * inv;
+            double r = 0.5 * (c00 * (c11 * c22 - c12 * c12) - c01 * (c01 * c22 - c12 * c02) + c02 * (c01 * c12 - c11 * c02));
+            r = std::clamp(r, -1.0, 1.0);
+
+            const double phi = std::acos(r) / 3.0;
+            lmin = q + 2.0 * pp * std::cos(phi + 2.0 * 3.14159265358979323846 / 3.0);
+        }
+
+        lambda0 = (float)lmin;
+
+        // filas de A - lmin I, el autovector es el mayor producto cruz entre ellas
+        const double r0[3] = { a00 - lmin, a01, a02 };
+        const double r1[3] = { a01, a11 - lmin, a12 };
+        const double r2[3] = { a02, a12, a22 - lmin };
+
+        double c[3][3] = {
+            { r0[1] * r1[2] - r0[2] * r1[1], r0[2] * r1[0] - r0[0] * r1[2], r0[0] * r1[1] - r0[1] * r1[0] },
+            { r0[1] * r2[2] - r0[2] * r2[1], r0[2] * r2[0] - r0[0] * r2[2], r0[0] * r2[1] - r0[1] * r2[0] },
+            { r1[1] * r2[2] - r1[2] * r2[1], r1[2] * r2[0] - r1[0] * r2[2], r1[0] * r2[1] - r1[1] * r2[0] }
+        };
+
+        int best = 0;
+        double bestN = -1.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            double nn = c[i][0] * c[i][0] + c[i][1] * c[i][1] + c[i][2] * c[i][2];
+            if (nn > bestN) { bestN = nn; best = i; }
+        }
+
+        if (bestN <= 1e-30) return false;
+
+        double inv = 1.0 / std::sqrt(bestN);
+        n[0] = (float)(c[best][0] * inv);
+        n[1] = (float)(c[best][1] * inv);
+        n[2] = (float)(c[best][2] * inv);
+        return true;
     }
 }
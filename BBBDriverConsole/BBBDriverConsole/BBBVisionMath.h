@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <cstdint>
+#include <cmath>
+#include <algorithm>
 
 namespace BBB
 {
@@ -9,24 +11,88 @@ namespace BBB
     {
     public:
         // devolvemos v clamped entre 0 y 1
-        static float Clamp01(float v);
+        static constexpr float Clamp01(float v)
+        {
+            return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+        }
 
         // convertimos grados a radianes
-        static float DegToRad(float deg);
+        static constexpr float DegToRad(float deg)
+        {
+            return deg * 3.14159265358979323846f / 180.0f;
+        }
 
         // calculamos altura sobre el suelo usando geometria
         // sistema camara X derecha Y abajo Z delante
         // altura camara en metros y pitch hacia abajo en grados
-        static float HeightAboveGroundM(float Xc, float Yc, float Zc, float camHeightM, float pitchDownDeg);
+        static inline float HeightAboveGroundM(float Xc, float Yc, float Zc, float camHeightM, float pitchDownDeg)
+        {
+            (void)Xc;
+
+            // deshacemos pitch rotando alrededor de X, en el plano yUp z con yUp = -Y
+            float p = DegToRad(pitchDownDeg);
+            return camHeightM - std::cos(p) * Yc - std::sin(p) * Zc;
+        }
+
+        // lo mismo para n puntos en SoA, X no interviene
+        // el seno y coseno se calculan una vez y el resto va en SSE2 de 4 en 4
+        static void HeightAboveGroundBatch(const float* Yc, const float* Zc, int n,
+            float camHeightM, float pitchDownDeg, float* out);
 
         // pasamos HSV a RGB para pintar por distancia
-        static void HsvToRgb(float hDeg, float s, float v, uint8_t& r, uint8_t& g, uint8_t& b);
+        static inline void HsvToRgb(float hDeg, float s, float v, uint8_t& r, uint8_t& g, uint8_t& b)
+        {
+            hDeg = std::fmod(hDeg, 360.0f);
+            if (hDeg < 0.0f) hDeg += 360.0f;
+
+            float c = v * s;
+            float x = c * (1.0f - std::fabs(std::fmod(hDeg / 60.0f, 2.0f) - 1.0f));
+            float m = v - c;
+
+            float rp = 0, gp = 0, bp = 0;
+
+            if (hDeg < 60.0f) { rp = c; gp = x; bp = 0; }
+            else if (hDeg < 120.0f) { rp = x; gp = c; bp = 0; }
+            else if (hDeg < 180.0f) { rp = 0; gp = c; bp = x; }
+            else if (hDeg < 240.0f) { rp = 0; gp = x; bp = c; }
+            else if (hDeg < 300.0f) { rp = x; gp = 0; bp = c; }
+            else { rp = c; gp = 0; bp = x; }
+
+            r = (uint8_t)std::clamp((int)std::lround((rp + m) * 255.0f), 0, 255);
+            g = (uint8_t)std::clamp((int)std::lround((gp + m) * 255.0f), 0, 255);
+            b = (uint8_t)std::clamp((int)std::lround((bp + m) * 255.0f), 0, 255);
+        }
 
-        // pintamos segun Z con un heatmap
-        static void DepthToHeatRGB(float z, float zMin, float zMax, uint8_t& r, uint8_t& g, uint8_t& b);
+        // pintamos segun Z con un heatmap, azul en zMin y rojo en zMax
+        // con s = v = 1 y tono en [0, 240] HSV queda en tramos lineales sin ramas
+        // k = tono / 60, r = |k - 3| - 1, g = 2 - |k - 2|, b = 2 - |k - 4|, todo recortado a [0, 1]
+        static inline void DepthToHeatRGB(float z, float zMin, float zMax, uint8_t& r, uint8_t& g, uint8_t& b)
+        {
+            float denom = zMax - zMin;
+            if (denom < 1e-6f) denom = 1.0f;
 
-        // calculamos percentil q 0 a 1
-        // ojo modifica el vector porque lo ordenamos
+            float k = (1.0f - Clamp01((z - zMin) / denom)) * 4.0f;
+
+            r = (uint8_t)(int)(Clamp01(std::fabs(k - 3.0f) - 1.0f) * 255.0f + 0.5f);
+            g = (uint8_t)(int)(Clamp01(2.0f - std::fabs(k - 2.0f)) * 255.0f + 0.5f);
+            b = (uint8_t)(int)(Clamp01(2.0f - std::fabs(k - 4.0f)) * 255.0f + 0.5f);
+        }
+
+        // heatmap de n profundidades a rgb entrelazado R G B, mismo resultado que DepthToHeatRGB
+        static void DepthToHeatBatch(const float* z, int n, float zMin, float zMax, uint8_t* rgb);
+
+        // calculamos percentil q 0 a 1 interpolando entre los dos vecinos
+        // ojo modifica el vector, lo reordenamos con nth_element sin ordenarlo entero
         static float Percentile(std::vector<float>& v, float q);
+
+        // autovalores y autovectores de una matriz simetrica 3x3 por Jacobi
+        // a en orden xx xy xz yy yz zz
+        // evals ascendentes y evecs[3 * i + k] componente k del autovector i
+        static void SymEigen3(const double a[6], double evals[3], double evecs[9]);
+
+        // solo el autovector del menor autovalor, forma cerrada sin iterar
+        // pensado para normales por pixel donde Jacobi es demasiado caro
+        // devolvemos false si la matriz es degenerada
+        static bool SmallestEigenVector3(const double a[6], float n[3], float& lambda0, float& trace);
     };
 }
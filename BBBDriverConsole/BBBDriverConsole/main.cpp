@@ -1,5 +1,12 @@
 #include "BBBDriver.h"
 #include "BBBConfig.h"
+#include "BBBCameraWorker.h"
+#include "BBBConfigWatcher.h"
+#include "BBBLatencyHistogram.h"
+#include "BBBMetrics.h"
+#include "BBBProfiler.h"
+#include "BBBRegistration.h"
+#include "BBBTrace.h"
 
 #include <chrono>
 #include <iomanip>
@@ -11,6 +18,8 @@
 #include <algorithm>
 #include <utility>
 #include <cctype>
+#include <memory>
+#include <mutex>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -79,6 +88,13 @@ static void ReleaseImageList(Spinnaker::ImageList& set)
     }
 }
 
+// ARR outputDir vacio o "." es el directorio del exe, al arrancar y al recargar
+static void NormalizeOutputDir(BBBPaths& paths)
+{
+    if (paths.outputDir.empty() || paths.outputDir == ".")
+        paths.outputDir = GetExeDir().string();
+}
+
 static void EnsureBaseDir(const BBBPaths& paths)
 {
     std::filesystem::path base(paths.outputDir);
@@ -140,12 +156,7 @@ static std::string MakeCamPrefix(const BBBAppConfig& cfg, const CameraConfig& c,
         baseName = cfg.namePrefix + std::string("UNASSIGNED") + std::to_string(index0Based + 1);
 
     std::string o = NormalizeOrient(c.orient);
-    if (o.empty())
-    {
-        if (index0Based == 0) o = "izq";
-        else if (index0Based == 1) o = "der";
-        else o = "cenital";
-    }
+    if (o.empty()) o = BBBConfig::DefaultOrientForIndex(index0Based);
 
     return SanitizeFileTag(baseName + "_" + o);
 }
@@ -183,8 +194,13 @@ static void PrintMenu()
     std::cout << " 1 Guardar Disparity (disparidad) PGM y Rectified (rectificada) PNG\n";
     std::cout << " 2 Generar PLY (archivo de nube) filtrado\n";
     std::cout << " 3 Medir distancia\n";
-    std::cout << " 4 Cambiar parametros\n";
+    std::cout << " 4 Recargar parametros del INI\n";
     std::cout << " 5 Releer Scan3D\n";
+    std::cout << " 6 Calibrar extrinsecos (ICP entre camaras)\n";
+    std::cout << " 7 Reprocesar par estereo PGM con SGM en host\n";
+    std::cout << " 8 Estadisticas de latencia por camara\n";
+    std::cout << " 9 Tiempos por etapa\n";
+    std::cout << " 10 Volcar traza de tiempos (Chrome JSON)\n";
     std::cout << " 0 Salir\n";
     std::cout << "Opcion: ";
 }
@@ -195,8 +211,233 @@ struct ActiveCam
     BBBDriver drv;
     Scan3DParams s3d{};
     bool available = false;
+
+    // ARR captura desde el trigger hasta tener el set, y proceso hasta soltarlo
+    BBB::LatencyHistogram acqLatency;
+    BBB::LatencyHistogram procLatency;
+
+    // ARR contadores para Prometheus, reservados al arrancar
+    BBB::CameraMetrics* metrics = nullptr;
 };
 
+// ARR releemos el INI y a cada camara le aplicamos solo lo que cambio
+// ARR control al momento, parametros y montaje valen desde el siguiente frame
+// ARR formatos de stream paran y arrancan solo esa camara, sin volver a descubrir ni Init
+static void ReloadConfig(std::vector<ActiveCam>& act, BBBAppConfig& cfg, const std::string& iniPath)
+{
+    BBBAppConfig fresh;
+    if (!BBBConfig::LoadIni(iniPath, fresh))
+    {
+        std::cout << "INI no se pudo leer, seguimos con los parametros anteriores\n";
+        return;
+    }
+
+    NormalizeOutputDir(fresh.paths);
+    const bool dirsChanged =
+        fresh.paths.outputDir != cfg.paths.outputDir ||
+        fresh.paths.dirPNG != cfg.paths.dirPNG ||
+        fresh.paths.dirPGM != cfg.paths.dirPGM ||
+        fresh.paths.dirPLY != cfg.paths.dirPLY;
+
+    cfg.paths = fresh.paths;
+    if (dirsChanged)
+    {
+        EnsureBaseDir(cfg.paths);
+        EnsureCamDirs(cfg);
+        std::cout << "Salida en " << cfg.paths.outputDir << "\n";
+    }
+
+    cfg.defaultMount = fresh.defaultMount;
+    cfg.defaultParams = fresh.defaultParams;
+    cfg.defaultControl = fresh.defaultControl;
+
+    if (fresh.profileSummarySec != cfg.profileSummarySec)
+    {
+        cfg.profileSummarySec = fresh.profileSummarySec;
+        BBB::Profiler::SetReportInterval(cfg.profileSummarySec);
+    }
+
+    cfg.traceEnabled = fresh.traceEnabled;
+    BBB::Trace::SetEnabled(cfg.traceEnabled);
+
+    cfg.perfCounters = fresh.perfCounters;
+    BBB::PerfCounters::SetEnabled(cfg.perfCounters);
+
+    if (fresh.metricsFile != cfg.metricsFile || fresh.metricsIntervalSec != cfg.metricsIntervalSec)
+    {
+        cfg.metricsFile = fresh.metricsFile;
+        cfg.metricsIntervalSec = fresh.metricsIntervalSec;
+        BBB::Metrics::SetTextfile(cfg.metricsFile, cfg.metricsIntervalSec);
+    }
+
+    int changed = 0;
+
+    for (auto& a : act)
+    {
+        if (!a.cfg) continue;
+
+        // ARR las camaras abiertas se quedan con su serial, las buscamos por el y si no por nombre
+        const CameraConfig* n = nullptr;
+        for (const auto& c : fresh.cameras)
+        {
+            if (!a.cfg->serial.empty() ? c.serial == a.cfg->serial : c.name == a.cfg->name)
+            {
+                n = &c;
+                break;
+            }
+        }
+        if (!n) continue;
+
+        const BBBConfigDiff d = BBBConfig::Diff(*a.cfg, *n);
+        if (!d.Any()) continue;
+
+        a.cfg->params = n->params;
+        a.cfg->control = n->control;
+        a.cfg->mount = n->mount;
+        changed++;
+
+        std::cout << a.cfg->name << " recargado"
+            << (d.params ? " parametros" : "")
+            << (d.control ? " control" : "")
+            << (d.mount ? " montaje" : "") << "\n";
+
+        if (!a.available) continue;
+
+        if (d.control) ApplyControl(a.drv, a.cfg->control);
+
+        if (d.streams)
+        {
+            a.drv.StopAcquisition();
+
+            if (!a.drv.ConfigureStreams_Rectified1_Disparity(a.cfg->params.streamBayer, a.cfg->params.streamCoord3D))
+                std::cout << "AVISO " << a.cfg->name << " no pudo configurar streams\n";
+            if (a.cfg->params.streamBufferCount > 0)
+                a.drv.ConfigureStreamBufferCount(a.cfg->params.streamBufferCount);
+            a.drv.ReadScan3DParams(a.s3d);
+
+            if (!a.drv.StartAcquisition())
+            {
+                std::cout << "AVISO " << a.cfg->name << " no pudo reiniciar adquisicion\n";
+                a.available = false;
+                if (a.metrics) a.metrics->available = false;
+                continue;
+            }
+        }
+
+        if (d.cameraFilters || d.streams) a.drv.ConfigureCameraFilters(a.cfg->params);
+    }
+
+    if (changed == 0) std::cout << "INI releido sin cambios\n";
+}
+
+// ARR capturamos todas las camaras, pasamos cada nube al sistema del arco
+// ARR y alineamos cada una contra la primera con ICP punto a plano
+// ARR si converge guardamos los extrinsecos afinados en el INI
+static void CalibrateExtrinsicsICP(std::vector<ActiveCam>& act, BBBAppConfig& cfg, const std::string& iniPath)
+{
+    struct CamCloud
+    {
+        ActiveCam* cam = nullptr;
+        std::vector<BBB::Pt> pts;
+    };
+
+    std::vector<CamCloud> clouds;
+
+    for (auto& a : act)
+    {
+        if (!a.available) continue;
+
+        Spinnaker::ImageList set;
+        if (!a.drv.CaptureOnceSync(set, cfg.paths.captureTimeoutMs))
+        {
+            std::cout << a.cfg->name << " FAIL no capturamos set\n";
+            ReleaseImageList(set);
+            continue;
+        }
+
+        a.drv.ReadScan3DParams(a.s3d);
+
+        // ARR para calibrar queremos suelo y fondo, nos ayudan a fijar pitch y altura
+        BBBParams p = a.cfg->params;
+        p.enableGroundPlaneFilter = false;
+        p.enableFrontDepthClamp = false;
+        p.keepLargestCluster = false;
+
+        CamCloud cc;
+        cc.cam = &a;
+        float zFront = 0.0f;
+
+        bool ok = a.drv.BuildPointCloud_Filtered(set, a.s3d, p, a.cfg->mount, cc.pts, zFront);
+        ReleaseImageList(set);
+
+        if (!ok)
+        {
+            std::cout << a.cfg->name << " FAIL nube para calibrar\n";
+            continue;
+        }
+
+        BBB::Registration::Apply(BBB::Registration::MountToWorld(a.cfg->mount), cc.pts);
+        clouds.push_back(std::move(cc));
+    }
+
+    if (clouds.size() < 2)
+    {
+        std::cout << "Calibracion ICP necesita al menos 2 camaras con nube\n";
+        return;
+    }
+
+    const CamCloud& ref = clouds[0];
+    std::cout << "Referencia " << ref.cam->cfg->name << " puntos " << ref.pts.size() << "\n";
+
+    // ARR por encima de esto no nos fiamos del ajuste
+    const float maxAcceptRmsM = 0.02f;
+
+    BBB::IcpParams prm;
+    bool changed = false;
+
+    for (size_t i = 1; i < clouds.size(); ++i)
+    {
+        CamCloud& cc = clouds[i];
+        CameraConfig& c = *cc.cam->cfg;
+
+        BBB::IcpResult res;
+        bool ok = BBB::Registration::AlignPointToPlane(cc.pts, ref.pts, BBB::Rigid{}, prm, res);
+
+        std::cout << c.name << " ICP " << (ok ? "OK" : "FAIL")
+            << " iter " << res.iterations
+            << " corr " << res.correspondences
+            << " rms " << res.rmsM << " m"
+            << " tiempo " << res.elapsedMs << " ms\n";
+
+        if (!ok || res.rmsM > maxAcceptRmsM)
+        {
+            std::cout << c.name << " no actualizamos extrinsecos\n";
+            continue;
+        }
+
+        BBB::Rigid camToWorld = BBB::Registration::Compose(res.transform, BBB::Registration::MountToWorld(c.mount));
+
+        BBBCameraMount m = c.mount;
+        BBB::Registration::WorldToMount(camToWorld, m);
+
+        std::cout << c.name
+            << " altura " << c.mount.alturaCamaraM << " -> " << m.alturaCamaraM
+            << " pitch " << c.mount.pitchDeg << " -> " << m.pitchDeg
+            << " yaw " << c.mount.yawDeg << " -> " << m.yawDeg
+            << " roll " << c.mount.rollDeg << " -> " << m.rollDeg
+            << " pos " << m.posXM << " " << m.posZM << "\n";
+
+        c.mount = m;
+        changed = true;
+    }
+
+    if (changed)
+    {
+        BBBConfig::SaveIni(iniPath, cfg);
+        std::cout << "Extrinsecos guardados en " << iniPath << "\n";
+    }
+}
+
 static std::vector<std::string> DetectStereoSerials(Spinnaker::CameraList& cams)
 {
     std::vector<std::string> out;
@@ -224,7 +465,10 @@ static std::vector<std::string> DetectStereoSerials(Spinnaker::CameraList& cams)
 
 int main()
 {
-    std::cout << "=== BBBDriverConsole BBB Spinnaker hasta 3 camaras ===\n";
+    // ARR con un hilo por camara cada linea de consola sale entera y con su camara delante
+    BBB::ConsoleLines::Install();
+
+    std::cout << "=== BBBDriverConsole BBB Spinnaker, una camara por Camera.N del INI ===\n";
     std::cout << "Guardado por camara en outputDir/BBBserial_orient/PNG PGM PLY\n\n";
 
     const std::string iniName = "bbb_config.ini";
@@ -246,11 +490,9 @@ int main()
         BBBConfig::SaveIni(iniPath.string(), cfg);
     }
 
-    if (cfg.maxCameras > 3) cfg.maxCameras = 3;
     if (cfg.maxCameras < 1) cfg.maxCameras = 1;
 
-    if (cfg.paths.outputDir.empty() || cfg.paths.outputDir == ".")
-        cfg.paths.outputDir = exeDir.string();
+    NormalizeOutputDir(cfg.paths);
 
     EnsureBaseDir(cfg.paths);
 
@@ -274,7 +516,10 @@ int main()
     }
 
     bool cfgChanged = false;
+    const int maxBefore = cfg.maxCameras;
     BBBConfig::EnsureDetectedCameras(cfg, detected, cfgChanged);
+    if (cfg.maxCameras > maxBefore)
+        std::cout << "maxCameras sube de " << maxBefore << " a " << cfg.maxCameras << " por las camaras detectadas\n";
 
     if (cfgChanged)
     {
@@ -282,9 +527,18 @@ int main()
         std::cout << "INI actualizado al detectar camaras\n";
     }
 
+    // ARR con autoAddDetectedCameras apagado las que no estan en el INI no se abren, lo decimos
+    for (const auto& s : detected)
+    {
+        bool inIni = false;
+        for (const auto& c : cfg.cameras)
+            if (c.serial == s) { inIni = true; break; }
+        if (!inIni) std::cout << "AVISO camara " << s << " detectada pero no esta en el INI, no se abre\n";
+    }
+
     EnsureCamDirs(cfg);
 
-    // ARR abrimos cada Camera.0..2 una vez sin serial duplicado
+    // ARR abrimos cada Camera.N una vez sin serial duplicado
     std::vector<ActiveCam> act;
     act.reserve((size_t)cfg.maxCameras);
 
@@ -348,12 +602,17 @@ int main()
         a.drv.DisableGVCPHeartbeat(true);
 #endif
 
-        if (!a.drv.ConfigureStreams_Rectified1_Disparity())
+        if (!a.drv.ConfigureStreams_Rectified1_Disparity(a.cfg->params.streamBayer, a.cfg->params.streamCoord3D))
             std::cout << "AVISO " << a.cfg->name << " no pudo configurar streams\n";
 
+        a.drv.ConfigureCameraFilters(a.cfg->params);
+
         if (!a.drv.ConfigureSoftwareTrigger())
             std::cout << "AVISO " << a.cfg->name << " no pudo configurar trigger software\n";
 
+        if (a.cfg->params.streamBufferCount > 0 && !a.drv.ConfigureStreamBufferCount(a.cfg->params.streamBufferCount))
+            std::cout << "AVISO " << a.cfg->name << " no pudo fijar buffers de stream\n";
+
         if (!a.drv.ReadScan3DParams(a.s3d))
             std::cout << "AVISO " << a.cfg->name << " no pudo leer Scan3D\n";
         else
@@ -371,6 +630,73 @@ int main()
         }
     }
 
+    // ARR mlockall es de todo el proceso, basta con que una camara lo pida
+    if (std::any_of(act.begin(), act.end(), [](const ActiveCam& a) { return a.available && a.cfg->lockMemory; }))
+        std::cout << (BBB::CameraWorker::LockProcessMemory() ? "Memoria bloqueada en RAM\n"
+            : "AVISO no se pudo bloquear la memoria, faltan permisos o limite memlock\n");
+
+    // ARR por camara un hilo que espera los frames y otro que los procesa
+    // ARR cada uno fijado a su nucleo y con prioridad tiempo real si el INI lo pide
+    std::vector<std::unique_ptr<BBB::CameraWorker>> acqWorkers;
+    std::vector<std::unique_ptr<BBB::CameraWorker>> workers;
+    acqWorkers.reserve(act.size());
+    workers.reserve(act.size());
+    for (auto& a : act)
+    {
+        acqWorkers.push_back(std::make_unique<BBB::CameraWorker>(a.cfg->name, BBB::ThreadTuning{ a.cfg->acqCore, a.cfg->rtPriority }));
+        workers.push_back(std::make_unique<BBB::CameraWorker>(a.cfg->name, BBB::ThreadTuning{ a.cfg->workerCore, a.cfg->rtPriority }));
+
+        // ARR en la traza cada hilo sale con su camara y su papel
+        const int camId = (int)acqWorkers.size() - 1;
+        const std::string camName = a.cfg->name;
+        acqWorkers.back()->Submit([camId, camName]() { BBB::Trace::SetThreadName(camName + " adquisicion"); BBB::Trace::SetCamera(camId, camName); });
+        workers.back()->Submit([camId, camName]() { BBB::Trace::SetThreadName(camName + " proceso"); BBB::Trace::SetCamera(camId, camName); });
+
+        a.metrics = BBB::Metrics::Camera(camName);
+
+        const BBB::CameraWorker* acqW = acqWorkers.back().get();
+        const BBB::CameraWorker* procW = workers.back().get();
+        BBB::Metrics::AddGauge("bbb_worker_queue_depth", "Trabajos en cola o corriendo por hilo de camara",
+            camName, "worker", "adquisicion", [acqW]() { return (double)acqW->Pending(); });
+        BBB::Metrics::AddGauge("bbb_worker_queue_depth", "Trabajos en cola o corriendo por hilo de camara",
+            camName, "worker", "proceso", [procW]() { return (double)procW->Pending(); });
+
+        // ARR el hilo de metricas no toma frameMutex, lee la copia atomica
+        BBB::CameraMetrics* m = a.metrics;
+        m->available = a.available;
+        BBB::Metrics::AddGauge("bbb_camera_available", "1 si la camara esta abierta y adquiriendo",
+            camName, "", "", [m]() { return m->available ? 1.0 : 0.0; });
+    }
+
+    BBB::Trace::SetThreadName("consola");
+    BBB::Trace::SetEnabled(cfg.traceEnabled);
+    BBB::Profiler::SetReportInterval(cfg.profileSummarySec);
+
+    BBB::Metrics::SetTextfile(cfg.metricsFile, cfg.metricsIntervalSec);
+
+    BBB::PerfCounters::SetEnabled(cfg.perfCounters);
+    if (cfg.perfCounters)
+        std::cout << "Contadores de CPU por etapa " << BBB::PerfCounters::Describe() << "\n";
+
+    auto DumpTrace = [&]()
+        {
+            std::filesystem::path tracePath = std::filesystem::path(cfg.paths.outputDir) / ("bbb_trace_" + NowTag() + ".json");
+            if (BBB::Trace::WriteChromeJson(tracePath.string()))
+                std::cout << "Traza guardada " << tracePath.string() << " abrir en ui.perfetto.dev o chrome://tracing\n";
+            else
+                std::cout << "No se pudo guardar la traza " << tracePath.string() << "\n";
+        };
+
+    // ARR al guardar el INI recargamos sin parar, el lock hace que nunca caiga a mitad de un frame
+    std::mutex frameMutex;
+    BBBConfigWatcher watcher;
+    watcher.Start(iniPath.string(), [&]()
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            std::cout << "\nINI modificado\n";
+            ReloadConfig(act, cfg, iniPath.string());
+        });
+
     while (true)
     {
         PrintMenu();
@@ -379,6 +705,20 @@ int main()
 
         if (opt == "0") break;
 
+        // ARR las rutas de la opcion 7 se piden antes del lock, un INI guardado mientras escribimos no espera
+        std::string leftPath, rightPath, dispPath;
+        if (opt == "7")
+        {
+            std::cout << "PGM izquierda rectificada: ";
+            std::getline(std::cin, leftPath);
+            std::cout << "PGM derecha rectificada: ";
+            std::getline(std::cin, rightPath);
+            std::cout << "PGM disparidad de la camara para comparar (vacio para no comparar): ";
+            std::getline(std::cin, dispPath);
+        }
+
+        std::unique_lock<std::mutex> frameLock(frameMutex);
+
         const std::string tag = NowTag();
         std::filesystem::path base(cfg.paths.outputDir);
 
@@ -400,46 +740,105 @@ int main()
             continue;
         }
 
+        if (opt == "6")
+        {
+            CalibrateExtrinsicsICP(act, cfg, iniPath.string());
+            continue;
+        }
+
+        if (opt == "7")
+        {
+            // ARR usamos parametros y Scan3D de la primera camara disponible para que la salida
+            // ARR tenga la misma codificacion que la disparidad de la camara
+            const ActiveCam* ref = nullptr;
+            for (auto& a : act)
+                if (a.available) { ref = &a; break; }
+
+            const BBBParams& p = ref ? ref->cfg->params : cfg.defaultParams;
+            const Scan3DParams s3d = ref ? ref->s3d : Scan3DParams{};
+
+            std::filesystem::path outPath(leftPath);
+            outPath.replace_filename(outPath.stem().string() + "_sgm.pgm");
+
+            BBBDriver::ReprocessStereoPGM(leftPath, rightPath, dispPath, s3d, p, outPath.string());
+            continue;
+        }
+
         if (opt == "4")
         {
-            std::cout << "\nElegir camara para cambiar parametros\n";
-            for (size_t i = 0; i < act.size(); ++i)
-            {
-                auto& a = act[i];
-                std::cout << " " << (i + 1) << " " << a.cfg->name
-                    << " serial " << (a.cfg->serial.empty() ? "SIN_SERIAL" : a.cfg->serial)
-                    << " " << (a.available ? "OK" : "NO") << "\n";
-            }
-            std::cout << "Opcion: ";
-            std::string sel;
-            std::getline(std::cin, sel);
+            ReloadConfig(act, cfg, iniPath.string());
+            continue;
+        }
 
-            int idx = std::stoi(sel) - 1;
-            if (idx < 0 || idx >= (int)act.size())
-            {
-                std::cout << "Opcion no valida\n";
-                continue;
-            }
+        if (opt == "10")
+        {
+            if (!cfg.traceEnabled) std::cout << "Traza apagada, traceEnabled=true en General para grabar\n";
+            DumpTrace();
+            continue;
+        }
 
-            std::cout << "Editando parametros de " << act[idx].cfg->name << " en INI\n";
-            std::cout << "Hacemos los cambios editando el bbb_config.ini\n";
+        if (opt == "9")
+        {
+            BBB::Profiler::Print(std::cout);
+            continue;
+        }
 
-            BBBConfig::SaveIni(iniPath.string(), cfg);
+        if (opt == "8")
+        {
+            for (auto& a : act)
+            {
+                if (!a.available) continue;
+                std::cout << a.cfg->name << " nucleos adq " << a.cfg->acqCore << " proceso " << a.cfg->workerCore
+                    << " prioridad " << a.cfg->rtPriority << "\n";
+                a.acqLatency.Print(std::cout, " captura", true);
+                a.procLatency.Print(std::cout, " proceso", true);
+            }
             continue;
         }
 
-        auto DoCam = [&](ActiveCam& a)
+        auto DoCam = [&](size_t i)
             {
+                ActiveCam& a = act[i];
                 if (!a.available) return;
 
+                BBB::TraceScope frameScope("frame");
+
+                // ARR la espera del frame va en el hilo de adquisicion de esta camara
                 Spinnaker::ImageList set;
-                if (!a.drv.CaptureOnceSync(set, cfg.paths.captureTimeoutMs))
+                bool captured = false;
+                {
+                    BBB::TraceScope waitScope("espera captura");
+                    acqWorkers[i]->Run([&]()
+                        {
+                            auto t0 = std::chrono::steady_clock::now();
+                            captured = a.drv.CaptureOnceSync(set, cfg.paths.captureTimeoutMs);
+                            if (captured)
+                                a.acqLatency.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+                        });
+                }
+
+                if (!captured)
                 {
+                    BBB::Metrics::Inc(a.metrics->framesDropped);
                     std::cout << a.cfg->name << " FAIL no capturamos set\n";
                     ReleaseImageList(set);
                     return;
                 }
 
+                BBB::Metrics::Inc(a.metrics->framesCaptured);
+
+                // ARR bytes de cada fichero guardado, el tiempo ya lo cuentan las etapas escribir
+                auto CountWrite = [&](const std::string& path)
+                    {
+                        std::error_code fec;
+                        const auto bytes = std::filesystem::file_size(path, fec);
+                        if (fec) return;
+                        BBB::Metrics::Inc(a.metrics->filesWritten);
+                        BBB::Metrics::Inc(a.metrics->bytesWritten, (uint64_t)bytes);
+                    };
+
+                auto tProc = std::chrono::steady_clock::now();
+
                 int camIndex = (int)(a.cfg - cfg.cameras.data());
                 if (camIndex < 0 || camIndex >= (int)cfg.cameras.size()) camIndex = 0;
 
@@ -462,8 +861,11 @@ int main()
                     auto pDisp = (camDirPGM / fDisp).string();
                     auto pRect = (camDirPNG / fRect).string();
 
-                    bool okDisp = a.drv.SaveDisparityPGM(set, pDisp);
-                    bool okRect = a.drv.SaveRectifiedPNG(set, pRect);
+                    bool okDisp = a.drv.SaveDisparityPGM(set, pDisp, a.s3d);
+                    bool okRect = a.drv.SaveRectifiedPNG(set, pRect, a.cfg->params.demosaicEdgeAware);
+
+                    if (okDisp) CountWrite(pDisp);
+                    if (okRect) CountWrite(pRect);
 
                     std::cout << a.cfg->name << " Guardado\n";
                     std::cout << " - " << pDisp << " " << (okDisp ? "OK" : "FAIL") << "\n";
@@ -478,7 +880,12 @@ int main()
 
                     std::cout << "\n--- " << a.cfg->name << " Generar PLY filtrado ---\n";
                     if (a.drv.SavePointCloudPLY_Filtered(set, a.s3d, a.cfg->params, a.cfg->mount, pPly))
+                    {
                         std::cout << a.cfg->name << " OK guardado " << pPly << "\n";
+                        CountWrite(pPly);
+                        if (a.cfg->params.lodLevels > 0)
+                            CountWrite((std::filesystem::path(pPly).replace_extension(".lod")).string());
+                    }
                     else
                         std::cout << a.cfg->name << " FAIL PLY\n";
                 }
@@ -491,17 +898,49 @@ int main()
                     bool okC = a.drv.GetDistanceCentralPointM(set, a.s3d, zCenter);
                     bool okB = a.drv.GetDistanceToBultoM_Debug(set, a.s3d, a.cfg->params, a.cfg->mount, zBulto, used);
 
+                    BBB::Metrics::Inc(okB ? a.metrics->measureOk : a.metrics->measureFail);
+
                     std::cout << a.cfg->name << " Distancias\n";
                     std::cout << " - Centro " << (okC ? std::to_string(zCenter) : std::string("FAIL")) << " m\n";
                     std::cout << " - Cara bulto " << (okB ? std::to_string(zBulto) : std::string("FAIL")) << " m puntos " << used << "\n";
+
+                    // ARR la cenital mide ademas volumen con el mapa de alturas
+                    if (NormalizeOrient(a.cfg->orient) == "cenital" && a.cfg->params.heightMapCellM > 0.0f)
+                    {
+                        BBB::HeightMapStats hm;
+                        if (a.drv.MeasureHeightMap(set, a.s3d, a.cfg->params, a.cfg->mount, hm))
+                            std::cout << " - Mapa alturas huella " << hm.footprintM2 << " m2"
+                            << " ancho X " << hm.widthXM << " m largo Z " << hm.lengthZM << " m"
+                            << " alto max " << hm.maxHeightM << " m"
+                            << " volumen " << hm.volumeM3 << " m3\n";
+                        else
+                            std::cout << " - Mapa alturas FAIL\n";
+                    }
                 }
 
                 ReleaseImageList(set);
+                a.procLatency.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tProc).count());
             };
 
-        for (auto& a : act) DoCam(a);
+        // ARR todas las camaras a la vez, la ronda tarda lo que la mas lenta
+        BBB::TraceScope roundScope("ronda");
+        for (size_t i = 0; i < act.size(); ++i)
+            workers[i]->Submit([&, i]() { DoCam(i); });
+        for (auto& w : workers) w->Wait();
     }
 
+    watcher.Stop();
+    BBB::Profiler::SetReportInterval(0);
+
+    if (cfg.traceEnabled) DumpTrace();
+
+    // ARR ultima foto de las metricas antes de soltar los hilos que leen las gauges
+    BBB::Metrics::SetTextfile("", 0);
+    if (!cfg.metricsFile.empty()) BBB::Metrics::WriteTextfile(cfg.metricsFile);
+
+    workers.clear();
+    acqWorkers.clear();
+
     for (auto& a : act)
     {
         if (!a.available) continue;